@@ -18,17 +18,30 @@ icc /Gn+ /Gy+ /Mc /O+ /Q /Sm /Ss /W3 /Foremap_vac.o /C remap_vac.c
 @ENDLOCAL
 @rem
 @rem GCC: OMF format, Optimized, No-strict-aliasing (to suppress a warning msg),
+@rem      Multithreaded runtime (the report modes use worker threads),
 @rem      Link in libiberty (the gcc3 demangler), Output remap.exe
 @rem
 @SET BEGINLIBPATH=%BEGINSAVE%
 @SETLOCAL
 @call G:\MOZTOOLS\setmoz441.cmd > nul
 @echo on
-gcc -c -Wall -Zomf -O2 -fno-strict-aliasing remap.c
+gcc -c -Wall -Zomf -Zmt -O2 -fno-strict-aliasing remap.c remap_addr.c remap_hash.c remap_thrd.c remap_crash.c remap_prof.c remap_size.c remap_diff.c remap_xref.c remap_cache.c remap_dmgl.c remap_spill.c remap_stats.c remap_trace.c remap_bench.c remap_pipe.c remap_lib.c remap_cli.c
 @IF ERRORLEVEL 1 goto end
-g++ -o remap.exe -s -Zomf -Zmap -Zlinker /EXEPACK:2 remap.o remap_vac.o -llibiberty remap.def
+@rem
+@rem libremap.lib is everything but the commandline;  programs that use it
+@rem also need -llibiberty
+@rem
+@if exist libremap.lib del libremap.lib
+emxomfar r libremap.lib remap.o remap_addr.o remap_hash.o remap_thrd.o remap_crash.o remap_prof.o remap_size.o remap_diff.o remap_xref.o remap_cache.o remap_dmgl.o remap_spill.o remap_stats.o remap_trace.o remap_bench.o remap_pipe.o remap_lib.o remap_vac.o
+@IF ERRORLEVEL 1 goto end
+g++ -o remap.exe -s -Zomf -Zmt -Zmap -Zlinker /EXEPACK:2 remap_cli.o libremap.lib -llibiberty remap.def
 @IF ERRORLEVEL 1 goto end
 mapsym remap
+@rem
+@rem mapbench.exe generates test maps & benchmarks remap;  it only needs the C runtime
+@rem
+gcc -Wall -Zomf -O2 -o mapbench.exe mapbench.c
+@IF ERRORLEVEL 1 goto end
 :end
 @ENDLOCAL
 @SET BEGINLIBPATH=%BEGINSAVE%
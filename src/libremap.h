@@ -0,0 +1,85 @@
+/*****************************************************************************/
+/*  libremap.h                                                               */
+/*****************************************************************************/
+
+#ifndef _libremap_h
+#define _libremap_h
+
+/*****************************************************************************/
+/*  - the interface to libremap.lib, the map reader used by remap.exe        */
+/*  - os2.h must be #included first                                          */
+/*                                                                           */
+/*  A map is read by RmapOpen(), then its symbols can be listed by address   */
+/*  or by name, or looked up, until RmapClose().  Names are demangled when   */
+/*  they're first returned, so the first listing by name is the slowest.     */
+/*  Each map has its own context, so several can be opened & used            */
+/*  concurrently by different threads.  The demangler options are set once   */
+/*  for the process by RmapInit();  the demangler itself is shared by every  */
+/*  map.                                                                     */
+/*****************************************************************************/
+
+/* RmapInit() flags - the same values as remap's own options */
+#define RMAP_NO_DEMANGLE    0x01
+#define RMAP_SHOW_ARGS      0x04    /* keep a method's arguments */
+#define RMAP_WS             0x08    /* keep whitespace in names */
+#define RMAP_GCC            0x20    /* builtin GCC demangler (default) */
+#define RMAP_VAC            0x40    /* VAC's demangl.dll */
+#define RMAP_XXC            0x80    /* an external demangler program */
+#define RMAP_BOTH_ARGS      0x800000 /* keep names with & without arguments */
+
+/* RMAPSYM types - the same values as remap's records */
+#define RMAP_GRP            0x0001
+#define RMAP_IMP            0x0002
+#define RMAP_SEG            0x0004
+#define RMAP_MOD            0x0008
+#define RMAP_EPT            0x0010
+#define RMAP_EXP            0x0020
+#define RMAP_OBJ            0x0040
+#define RMAP_ERR            0x0080
+#define RMAP_TYPE           0x00FF
+
+#define RMAP_ABS            0x0100
+#define RMAP_VTABLE         0x01000
+#define RMAP_THUNK          0x02000
+#define RMAP_TYPEINFO       0x04000
+#define RMAP_TYPENAME       0x08000
+#define RMAP_GUARD          0x10000
+
+/* the orders RmapCount() & RmapGet() list symbols in */
+#define RMAP_BYADDRESS      0   /* every entry, as in a .remap listing */
+#define RMAP_BYNAME         1   /* publics, imports, & exports */
+
+/* One entry of a map.  The strings belong to the map & are valid until
+   it's closed;  the ones an entry doesn't have are empty.
+     publics & entry points:  apszText[0] is the name
+     imports & exports:       the name & the external name
+     segments:                the length in hex, the name, & the class
+     modules:                 the length in hex, the object, & the library
+     groups & errors:         the name or the line that wasn't understood
+   With RMAP_BOTH_ARGS, apszText[2] of a public, import, or export is its
+   name with arguments (the same as its name if it has none).
+*/
+typedef struct _rmapsym {
+    ULONG   type;
+    ULONG   seg;
+    ULONG   offs;
+    char *  apszText[3];
+} RMAPSYM;
+
+typedef struct _rmap RMAP;
+
+int     RmapInit(ULONG flags, char * pszDemangler);
+void    RmapTerm(void);
+RMAP *  RmapOpen(char * pszMap);
+void    RmapClose(RMAP * pMap);
+int     RmapCount(RMAP * pMap, int order);
+int     RmapGet(RMAP * pMap, int order, int ndx, RMAPSYM * pSym);
+int     RmapFindAddress(RMAP * pMap, ULONG seg, ULONG offs, RMAPSYM * pSym);
+int     RmapFindName(RMAP * pMap, char * pszName, RMAPSYM * pSym);
+
+/*****************************************************************************/
+
+#endif /* _libremap_h */
+
+/*****************************************************************************/
+
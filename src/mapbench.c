@@ -0,0 +1,673 @@
+/*****************************************************************************/
+/*  mapbench.c
+ *
+ *  Synthetic maps & a throughput benchmark for remap.
+ *
+ *  'mapbench gen' writes an ilink-style map with as many publics as
+ *  requested:  segments with "at offset" module rows, a group, exports,
+ *  Publics by Name & by Value (including Imp & Abs rows), linker warnings,
+ *  and an entry point.  Most names are Itanium-mangled:  functions,
+ *  constructors, templates, vtables, typeinfo, thunks, guard variables,
+ *  some with the extra leading underscore & some with Mozilla's "$w$"
+ *  suffix.  The same count & seed always produce the same map.
+ *
+ *  Past ILINK_BUG publics, ilink's two listings of publics stop agreeing
+ *  & each is missing some of the symbols the other has;  the generator
+ *  imitates that so remap's handling of it is part of the benchmark.
+ *
+ *  'mapbench run' generates maps of the requested sizes (unless they
+ *  already exist), lists each one with remap's default options, -d, -n,
+ *  & -a using --stats-json, then reports the time, MB/s, & symbols/s of
+ *  each phase.
+ *
+ *  This uses nothing but the C runtime, so it builds the same way on
+ *  any platform remap's benchmarks might be compared on.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+#define ILINK_BUG       54000   /* the listings of publics differ past this */
+#define SYM_PER_MOD     8       /* publics per object module, on average */
+#define CB_NAMEMAX      256
+#define CB_LINE         4096
+#define CB_OUTBUF       0x10000
+#define MAX_PHASES      16
+
+#define SYM_CODE        0
+#define SYM_DATA        1
+#define SYM_BSS         2
+#define SYM_IMP         3
+#define SYM_ABS         4
+
+typedef struct _sym {
+    unsigned long   seg;
+    unsigned long   offs;
+    unsigned long   name;       /* offset in the name pool */
+    int             kind;
+    int             fExport;
+} SYM;
+
+typedef struct _genmap {
+    unsigned long   cSym;
+    SYM *           pSym;
+    char *          pPool;
+    unsigned long   cbPool;
+    unsigned long   cbAlloc;
+    unsigned long   seed;
+} GENMAP;
+
+typedef struct _phase {
+    char            szName[32];
+    double          dMs;
+} PHASE;
+
+int     Generate(unsigned long cSym, unsigned long seed, char * pszFile);
+int     AddSymbols(GENMAP * pMap);
+int     AddName(GENMAP * pMap, SYM * pSym, unsigned long ndx);
+void    WriteMap(GENMAP * pMap, FILE * fp);
+void    WriteSegment(GENMAP * pMap, FILE * fp, unsigned long seg,
+                     char * pszName, char * pszClass);
+void    WritePublic(GENMAP * pMap, FILE * fp, SYM * pSym);
+int     SymByName(const void * key, const void * element);
+unsigned long   Random(GENMAP * pMap);
+
+int     Benchmark(char * pszRemap, unsigned long * pCount, int cCount,
+                  int cRuns);
+int     RunRemap(char * pszRemap, char * pszMode, char * pszMap,
+                 PHASE * pPhase, int * pcPhase);
+int     ParsePhases(char * pLine, PHASE * pPhase, int * pcPhase);
+
+char *  pszUsage =
+      "\n mapbench - synthetic maps & throughput benchmark for remap\n\n"
+        " Usage:  mapbench gen count file.map [seed]\n"
+        "           write a map with count publics\n"
+        "         mapbench run [-r n] remap.exe count [count ...]\n"
+        "           list maps of each size (bench<count>.map, generated if\n"
+        "           missing) with remap's default options, -d, -n, & -a,\n"
+        "           running each n times & keeping the fastest (default: 3)\n"
+        "\n";
+
+/* the modes run for each map */
+char *  apszModes[] = {"", "-d", "-n", "-a", 0};
+
+/* used with the generator's own sort */
+GENMAP *  pSortMap = 0;
+
+/*****************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  int             ctr;
+  int             cRuns = 3;
+  int             cCount;
+  unsigned long * pCount;
+  char *          pEnd;
+
+  if (argc >= 4 && !strcmp(argv[1], "gen")) {
+    return (Generate(strtoul(argv[2], 0, 0),
+                     (argc > 4 ? strtoul(argv[4], 0, 0) : 1),
+                     argv[3]) ? 0 : 1);
+  }
+
+  if (argc < 4 || strcmp(argv[1], "run")) {
+    fputs(pszUsage, stderr);
+    return 1;
+  }
+
+  ctr = 2;
+  if (!strcmp(argv[ctr], "-r") && argc > ctr + 2) {
+    cRuns = atoi(argv[ctr + 1]);
+    if (cRuns < 1)
+      cRuns = 1;
+    ctr += 2;
+  }
+  if (ctr + 1 >= argc) {
+    fputs(pszUsage, stderr);
+    return 1;
+  }
+
+  pCount = (unsigned long*)malloc((argc - ctr) * sizeof(unsigned long));
+  if (!pCount) {
+    fprintf(stderr, "malloc failed for counts\n");
+    return 1;
+  }
+
+  for (cCount = 0; ctr + 1 + cCount < argc; cCount++) {
+    pCount[cCount] = strtoul(argv[ctr + 1 + cCount], &pEnd, 0);
+    if (*pEnd || !pCount[cCount]) {
+      fprintf(stderr, "invalid count - '%s'\n", argv[ctr + 1 + cCount]);
+      free(pCount);
+      return 1;
+    }
+  }
+
+  ctr = Benchmark(argv[ctr], pCount, cCount, cRuns);
+  free(pCount);
+
+  return (ctr ? 0 : 1);
+}
+
+/*****************************************************************************/
+/*  the map generator                                                        */
+/*****************************************************************************/
+
+int     Generate(unsigned long cSym, unsigned long seed, char * pszFile)
+{
+  int     rtn = 0;
+  FILE *  fp = 0;
+  GENMAP  map;
+
+  if (!cSym) {
+    fprintf(stderr, "the count of publics can't be zero\n");
+    return 0;
+  }
+
+  memset(&map, 0, sizeof(map));
+  map.cSym = cSym;
+  map.seed = (seed ? seed : 1);
+
+do {
+  if (!AddSymbols(&map))
+    break;
+
+  fp = fopen(pszFile, "w");
+  if (!fp) {
+    fprintf(stderr, "unable to open output file '%s'\n", pszFile);
+    break;
+  }
+  setvbuf(fp, 0, _IOFBF, CB_OUTBUF);
+
+  WriteMap(&map, fp);
+
+  if (fclose(fp)) {
+    fprintf(stderr, "error writing '%s'\n", pszFile);
+    break;
+  }
+
+  rtn = 1;
+
+} while (0);
+
+  if (map.pSym)
+    free(map.pSym);
+  if (map.pPool)
+    free(map.pPool);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Lay out the publics in address order:  code, then data, then bss;  a
+   few imports & absolute symbols have no address in any segment.
+*/
+
+int     AddSymbols(GENMAP * pMap)
+{
+  unsigned long   ctr;
+  unsigned long   aOffs[3] = {0, 0, 0};
+  unsigned long   r;
+  SYM *           pSym;
+
+  pMap->pSym = (SYM*)calloc(pMap->cSym, sizeof(SYM));
+  if (!pMap->pSym) {
+    fprintf(stderr, "malloc failed for %lu symbols\n", pMap->cSym);
+    return 0;
+  }
+
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    r = Random(pMap) % 1000;
+    if (r < 5)
+      pSym->kind = SYM_IMP;
+    else
+    if (r < 7)
+      pSym->kind = SYM_ABS;
+    else
+    if (r < 700)
+      pSym->kind = SYM_CODE;
+    else
+    if (r < 950)
+      pSym->kind = SYM_DATA;
+    else
+      pSym->kind = SYM_BSS;
+
+    pSym->fExport = (Random(pMap) % 100 == 0);
+
+    if (!AddName(pMap, pSym, ctr))
+      return 0;
+  }
+
+  /* every segment's symbols have ascending offsets */
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (pSym->kind == SYM_IMP)
+      continue;
+    if (pSym->kind == SYM_ABS) {
+      pSym->offs = Random(pMap) % 0x10000;
+      continue;
+    }
+    pSym->seg = pSym->kind + 1;
+    pSym->offs = aOffs[pSym->kind];
+    aOffs[pSym->kind] += 4 + (Random(pMap) % 0x100) * 4;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Give a symbol a name that fits its kind.  ndx makes every name unique. */
+
+int     AddName(GENMAP * pMap, SYM * pSym, unsigned long ndx)
+{
+  int     len;
+  char *  pNew;
+  char    szCls[32];
+  char    szNs[32];
+  char    szName[CB_NAMEMAX];
+  static char * apszArgs[] = {"v", "i", "PKc", "ij", "d", "RKS_", "PvS0_"};
+  static char * apszImport[] = {"DOSCALLS", "PMWIN", "PMGPI", "LIBC066"};
+
+  sprintf(szCls, "Cls%lu", ndx);
+  sprintf(szNs, "ns%lu", ndx % 64);
+
+  switch (pSym->kind) {
+    case SYM_IMP:
+      len = sprintf(szName, "Api%lu%c%s.%lu", ndx, 0,
+                    apszImport[(ndx / 7) % 4], ndx % 1000) + 1;
+      break;
+
+    case SYM_ABS:
+      len = sprintf(szName, "__abs_%lu", ndx) + 1;
+      break;
+
+    case SYM_BSS:
+      /* guard variables & plain C data */
+      if (ndx % 2)
+        len = sprintf(szName, "_ZGVZN%d%s3getEvE8instance",
+                      (int)strlen(szCls), szCls) + 1;
+      else
+        len = sprintf(szName, "g_buffer_%lu", ndx) + 1;
+      break;
+
+    case SYM_DATA:
+      /* vtables, typeinfo, typeinfo names, & plain C data */
+      switch (ndx % 4) {
+        case 0:
+          len = sprintf(szName, "_ZTVN%d%s%d%sE", (int)strlen(szNs), szNs,
+                        (int)strlen(szCls), szCls) + 1;
+          break;
+        case 1:
+          len = sprintf(szName, "_ZTI%d%s", (int)strlen(szCls), szCls) + 1;
+          break;
+        case 2:
+          len = sprintf(szName, "_ZTS%d%s", (int)strlen(szCls), szCls) + 1;
+          break;
+        default:
+          len = sprintf(szName, "g_table_%lu", ndx) + 1;
+          break;
+      }
+      break;
+
+    default:
+      /* functions:  methods, constructors, templates, thunks, free
+         functions, & plain C;  some have gcc's extra underscore or
+         Mozilla's suffix */
+      switch (ndx % 8) {
+        case 0:
+        case 1:
+          len = sprintf(szName, "_ZN%s%d%s%d%s%d%sE%s", (ndx % 5 ? "" : "K"),
+                        (int)strlen(szNs), szNs, (int)strlen(szCls), szCls,
+                        (ndx % 3 ? 6 : 3), (ndx % 3 ? "method" : "run"),
+                        apszArgs[ndx % 7]);
+          break;
+        case 2:
+          len = sprintf(szName, "_ZN%d%sC%dE%s", (int)strlen(szCls), szCls,
+                        (int)(1 + ndx % 2), apszArgs[ndx % 5]);
+          break;
+        case 3:
+          len = sprintf(szName, "_ZN%d%s3TplI%d%sE4callEv",
+                        (int)strlen(szNs), szNs, (int)strlen(szCls), szCls);
+          break;
+        case 4:
+          len = sprintf(szName, "_ZThn%lu_N%d%s6methodEv", (ndx % 4 + 1) * 4,
+                        (int)strlen(szCls), szCls);
+          break;
+        case 5:
+          len = sprintf(szName, "__Z%dfunc%s%s", (int)strlen(szCls) + 4,
+                        szCls, apszArgs[ndx % 5]);
+          break;
+        case 6:
+          len = sprintf(szName, "_ZN%d%s5applyEv$w$%lx",
+                        (int)strlen(szCls), szCls, ndx * 2654435761UL);
+          break;
+        default:
+          len = sprintf(szName, "plain_c_function_%lu", ndx);
+          break;
+      }
+      len++;
+      break;
+  }
+
+  if (pMap->cbPool + len > pMap->cbAlloc) {
+    pMap->cbAlloc = (pMap->cbAlloc ? pMap->cbAlloc * 2 : 0x100000);
+    pNew = (char*)realloc(pMap->pPool, pMap->cbAlloc);
+    if (!pNew) {
+      fprintf(stderr, "malloc failed for names - bytes= %lu\n",
+              pMap->cbAlloc);
+      return 0;
+    }
+    pMap->pPool = pNew;
+  }
+
+  pSym->name = pMap->cbPool;
+  memcpy(&pMap->pPool[pMap->cbPool], szName, len);
+  pMap->cbPool += len;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    WriteMap(GENMAP * pMap, FILE * fp)
+{
+  unsigned long   ctr;
+  SYM **          ppName;
+  SYM *           pSym;
+
+  fputs("\n BENCHMARK\n\n", fp);
+  fputs("obj0_0.obj(bench.cpp) : warning L4036: no automatic data segment\n\n",
+        fp);
+
+  fputs(" Start         Length     Name                   Class\n", fp);
+  WriteSegment(pMap, fp, 1, "CODE32", "CODE");
+  WriteSegment(pMap, fp, 2, "DATA32", "DATA");
+  WriteSegment(pMap, fp, 3, "BSS32", "BSS");
+
+  fputs("\n Origin   Group\n 0002:0   DGROUP\n\n", fp);
+
+  fputs(" Address         Export                  Alias\n\n", fp);
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (pSym->fExport && pSym->seg)
+      fprintf(fp, " %04lX:%08lX  EXP_%lu  %s\n", pSym->seg, pSym->offs,
+              ctr, &pMap->pPool[pSym->name]);
+  }
+
+  /* the listing by name */
+  ppName = (SYM**)malloc(pMap->cSym * sizeof(SYM*));
+  if (ppName) {
+    for (ctr = 0; ctr < pMap->cSym; ctr++)
+      ppName[ctr] = &pMap->pSym[ctr];
+    pSortMap = pMap;
+    qsort(ppName, pMap->cSym, sizeof(SYM*), SymByName);
+
+    fputs("\n\n  Address         Publics by Name\n\n", fp);
+    for (ctr = 0; ctr < pMap->cSym; ctr++) {
+      if (pMap->cSym > ILINK_BUG &&
+          ppName[ctr] - pMap->pSym >= ILINK_BUG &&
+          (ppName[ctr] - pMap->pSym) % 5 == 0)
+        continue;
+      WritePublic(pMap, fp, ppName[ctr]);
+      if (ctr % 10000 == 5000)
+        fputs("obj1_2.obj(bench.cpp) : warning L4038: program has no"
+              " starting address\n", fp);
+    }
+    free(ppName);
+  }
+  else
+    fprintf(stderr, "malloc failed for the listing by name - it's empty\n");
+
+  /* the listing by value:  the imports & absolute symbols come first */
+  fputs("\n\n  Address         Publics by Value\n\n", fp);
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (!pSym->seg)
+      WritePublic(pMap, fp, pSym);
+  }
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (pSym->seg &&
+        !(pMap->cSym > ILINK_BUG && ctr >= ILINK_BUG && ctr % 5 == 1))
+      WritePublic(pMap, fp, pSym);
+  }
+
+  fputs("\nProgram entry point at 0001:00000000\n", fp);
+  fputs("obj2_1.obj(bench.cpp) : warning L4067: module listed as export"
+        " not found\n", fp);
+
+  return;
+}
+
+/*****************************************************************************/
+/* A segment & the modules that make it up, one per SYM_PER_MOD symbols */
+
+void    WriteSegment(GENMAP * pMap, FILE * fp, unsigned long seg,
+                     char * pszName, char * pszClass)
+{
+  unsigned long   ctr;
+  unsigned long   cInSeg = 0;
+  unsigned long   offStart = 0;
+  unsigned long   offEnd = 0;
+  SYM *           pSym;
+
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (pSym->seg == seg)
+      offEnd = pSym->offs + 4;
+  }
+
+  fprintf(fp, " %04lX:00000000 0%08lXH %-22s %s\n",
+          seg, offEnd, pszName, pszClass);
+
+  for (ctr = 0, pSym = pMap->pSym; ctr < pMap->cSym; ctr++, pSym++) {
+    if (pSym->seg != seg)
+      continue;
+    if (++cInSeg % SYM_PER_MOD && pSym->offs + 4 < offEnd)
+      continue;
+    fprintf(fp, "   at offset %08lX %05lXH bytes from lib%lu.lib"
+            " (obj%lu_%lu.obj)\n", offStart, pSym->offs + 4 - offStart,
+            (cInSeg / SYM_PER_MOD) % 16, seg, cInSeg / SYM_PER_MOD);
+    offStart = pSym->offs + 4;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+
+void    WritePublic(GENMAP * pMap, FILE * fp, SYM * pSym)
+{
+  char *  pName = &pMap->pPool[pSym->name];
+
+  if (pSym->kind == SYM_IMP)
+    fprintf(fp, " 0000:00000000  Imp  %-20s (%s)\n",
+            pName, strchr(pName, 0) + 1);
+  else
+  if (pSym->kind == SYM_ABS)
+    fprintf(fp, " 0000:%08lX  Abs  %s\n", pSym->offs, pName);
+  else
+    fprintf(fp, " %04lX:%08lX       %s\n", pSym->seg, pSym->offs, pName);
+
+  return;
+}
+
+/*****************************************************************************/
+
+int     SymByName(const void * key, const void * element)
+{
+  return strcmp(&pSortMap->pPool[(*(SYM**)key)->name],
+                &pSortMap->pPool[(*(SYM**)element)->name]);
+}
+
+/*****************************************************************************/
+/* The C runtime's rand() differs between compilers;  this doesn't. */
+
+unsigned long   Random(GENMAP * pMap)
+{
+  pMap->seed = (pMap->seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+
+  return (pMap->seed >> 8);
+}
+
+/*****************************************************************************/
+/*  the benchmark runner                                                     */
+/*****************************************************************************/
+
+int     Benchmark(char * pszRemap, unsigned long * pCount, int cCount,
+                  int cRuns)
+{
+  int     ndx;
+  int     ctr;
+  int     run;
+  int     cPhase;
+  int     cBest;
+  long    cbMap;
+  double  dMB;
+  double  dTotal;
+  char ** ppMode;
+  FILE *  fp;
+  PHASE   aPhase[MAX_PHASES];
+  PHASE   aBest[MAX_PHASES];
+  char    szMap[64];
+
+  printf("%9s %-4s %-20s %10s %9s %12s\n",
+         "publics", "mode", "phase", "ms", "MB/s", "symbols/s");
+
+  for (ndx = 0; ndx < cCount; ndx++) {
+    sprintf(szMap, "bench%lu.map", pCount[ndx]);
+
+    fp = fopen(szMap, "r");
+    if (!fp) {
+      fprintf(stderr, "generating %s\n", szMap);
+      if (!Generate(pCount[ndx], 1, szMap))
+        return 0;
+      fp = fopen(szMap, "r");
+    }
+    if (!fp || fseek(fp, 0, SEEK_END) || (cbMap = ftell(fp)) <= 0) {
+      fprintf(stderr, "unable to read '%s'\n", szMap);
+      if (fp)
+        fclose(fp);
+      return 0;
+    }
+    fclose(fp);
+    dMB = cbMap / (1024.0 * 1024.0);
+
+    for (ppMode = apszModes; *ppMode; ppMode++) {
+
+      /* keep the fastest time of each phase */
+      cBest = 0;
+      for (run = 0; run < cRuns; run++) {
+        if (!RunRemap(pszRemap, *ppMode, szMap, aPhase, &cPhase))
+          return 0;
+        if (!cBest) {
+          memcpy(aBest, aPhase, sizeof(aBest));
+          cBest = cPhase;
+          continue;
+        }
+        for (ctr = 0; ctr < cPhase && ctr < cBest; ctr++) {
+          if (aPhase[ctr].dMs < aBest[ctr].dMs)
+            aBest[ctr].dMs = aPhase[ctr].dMs;
+        }
+      }
+
+      /* demangling is also counted in the phases that call it */
+      dTotal = 0;
+      for (ctr = 0; ctr < cBest; ctr++) {
+        if (strcmp(aBest[ctr].szName, "demangling"))
+          dTotal += aBest[ctr].dMs;
+        printf("%9lu %-4s %-20s %10.1f %9.1f %12.0f\n",
+               pCount[ndx], (**ppMode ? *ppMode : "-"), aBest[ctr].szName,
+               aBest[ctr].dMs,
+               (aBest[ctr].dMs > 0 ? dMB * 1000.0 / aBest[ctr].dMs : 0.0),
+               (aBest[ctr].dMs > 0 ?
+                pCount[ndx] * 1000.0 / aBest[ctr].dMs : 0.0));
+      }
+      printf("%9lu %-4s %-20s %10.1f %9.1f %12.0f\n\n",
+             pCount[ndx], (**ppMode ? *ppMode : "-"), "total", dTotal,
+             (dTotal > 0 ? dMB * 1000.0 / dTotal : 0.0),
+             (dTotal > 0 ? pCount[ndx] * 1000.0 / dTotal : 0.0));
+      fflush(stdout);
+    }
+  }
+
+  remove("mapbench.out");
+  remove("mapbench.err");
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Run remap once & collect the phase timings it reports on stderr. */
+
+int     RunRemap(char * pszRemap, char * pszMode, char * pszMap,
+                 PHASE * pPhase, int * pcPhase)
+{
+  int     rtn = 0;
+  FILE *  fp;
+  char *  pLine;
+  char    szCmd[CB_LINE];
+
+  sprintf(szCmd, "%.1024s %s --stats-json -o mapbench.out %s 2>mapbench.err",
+          pszRemap, pszMode, pszMap);
+  if (system(szCmd)) {
+    fprintf(stderr, "'%s' failed\n", szCmd);
+    return 0;
+  }
+
+  pLine = (char*)malloc(CB_LINE);
+  fp = fopen("mapbench.err", "r");
+  if (!pLine || !fp) {
+    fprintf(stderr, "unable to read remap's statistics\n");
+    if (fp)
+      fclose(fp);
+    if (pLine)
+      free(pLine);
+    return 0;
+  }
+
+  while (fgets(pLine, CB_LINE, fp)) {
+    if (!strncmp(pLine, "{\"map\"", 6)) {
+      rtn = ParsePhases(pLine, pPhase, pcPhase);
+      break;
+    }
+  }
+  if (!rtn)
+    fprintf(stderr, "remap didn't report its statistics for '%s'\n", pszMap);
+
+  fclose(fp);
+  free(pLine);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Pick the name & wall time of each phase out of --stats-json's output. */
+
+int     ParsePhases(char * pLine, PHASE * pPhase, int * pcPhase)
+{
+  int     cnt = 0;
+  char *  ptr;
+  char *  pEnd;
+
+  for (ptr = strstr(pLine, "{\"name\": \""); ptr && cnt < MAX_PHASES;
+       ptr = strstr(ptr, "{\"name\": \"")) {
+    ptr += 10;
+    pEnd = strchr(ptr, '"');
+    if (!pEnd || pEnd - ptr >= (int)sizeof(pPhase->szName))
+      return 0;
+    memcpy(pPhase[cnt].szName, ptr, pEnd - ptr);
+    pPhase[cnt].szName[pEnd - ptr] = 0;
+
+    ptr = strstr(pEnd, "\"wall_ms\": ");
+    if (!ptr)
+      return 0;
+    pPhase[cnt].dMs = strtod(ptr + 11, 0);
+    cnt++;
+  }
+
+  *pcPhase = cnt;
+
+  return (cnt != 0);
+}
+
+/*****************************************************************************/
+
@@ -40,6 +40,9 @@
  *  situations, Remap's demangle-only listing may be larger than the original
  *  map file.
  *
+ *  The commandline is handled by remap_cli.c;  the rest of Remap is also
+ *  built as libremap.lib so other programs can read maps (see libremap.h).
+ *
  *  Note:  the demangler for gcc is statically linked to the exe while the
  *  vacpp demangler is contained in demangl.dll.  Unfortunately, the dll's
  *  functions have Optlink linkage which gcc 4.xx can't handle.  As a
@@ -62,120 +65,75 @@
 #include <sys\stat.h>
 
 #define INCL_DOS
+#define INCL_LONGLONG
 #include <os2.h>
 
 #include "remap_demangle.h"
+#include "remap.h"
 
 #define INCL_LOADEXCEPTQ
 #include "exceptq.h"
 
 /*****************************************************************************/
 
-#define HFILE_NONE      ((HFILE)-1)
-#define NULLCHAR        ((char)0)
-
-#define OPT_NO_DEMANGLE     0x01
-#define OPT_DEMANGLE_ONLY   0x02
-#define OPT_SHOW_ARGS       0x04
-#define OPT_WS              0x08
-#define OPT_WARNINGS        0x10
-#define OPT_GCC             0x20
-#define OPT_VAC             0x40
-#define OPT_XXC             0x80
-
-#define REMAP_END       0
-#define REMAP_GRP       0x0001
-#define REMAP_IMP       0x0002
-#define REMAP_SEG       0x0004
-#define REMAP_MOD       0x0008
-#define REMAP_EPT       0x0010
-#define REMAP_EXP       0x0020
-#define REMAP_OBJ       0x0040
-#define REMAP_ERR       0x0080
-#define REMAP_TYPE      0x00FF
-
-#define REMAP_ABS       0x0100
-
-#define REMAP_VTABLE    0x01000
-#define REMAP_THUNK     0x02000
-#define REMAP_TYPEINFO  0x04000
-#define REMAP_TYPENAME  0x08000
-#define REMAP_GUARD     0x10000
-#define REMAP_ATTRMASK  0x1F000
-
-#define REMAP_DUP       0x40000000
-#define REMAP_DUP2      0x80000000
-
-#define REMAP_MASK      0x1F1FF
-
-typedef struct _remap {
-    struct _remap*  next;
-    ULONG   type;
-    ULONG   seg;
-    ULONG   offs;
-    char    text[1];
-} REMAP;
-
-/*****************************************************************************/
-
-int     ParseArgs(int argc, char* argv[]);
-int     Init(void);
-int     LoadVacDemangler(void);
 int     StartDemangler(void);
-int     PrintUntil(char ** pArray);
-char ** SeekToHdr(char ** pSeek, char ** pStop);
+int     PrintUntil(REMAPCTX * pCtx, char ** pArray);
+int     SkipUntil(REMAPCTX * pCtx, char ** pArray);
+int     StoreMap(REMAPCTX * pCtx);
+int     RunReport(REMAPCTX * pCtx);
 int     MatchArray(char ** pArray, char * pText);
-int     StoreSegments(char ** pStop);
-int     ParseSegment(char * pData, ULONG * pSeg, ULONG * pOffs);
-int     ParseModule(char * pData, ULONG ulSeg, ULONG ulOffs);
-int     StoreGroups(void);
-int     StoreExports(void);
-int     StorePublics(void);
-int     StoreEntryPoint(void);
-int     StoreError(char * pBuf, REMAP * r);
+int     StoreSegments(REMAPCTX * pCtx, char ** pStop);
+int     StoreGroups(REMAPCTX * pCtx);
+int     StoreExports(REMAPCTX * pCtx);
+int     StoreEntryPoint(REMAPCTX * pCtx);
 char *  Trim(char * pTrim, char** ppNext);
 char *  TrimLine(char * pTrim);
-char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags);
-
-int     MarkDuplicates(void);
-int     PrintEntriesByAddress(void);
-int     PrintPublicsByName(void);
-int     DuplicateSorter(const void *key, const void *element);
-int     AddressSorter(const void *key, const void *element);
-int     NameSorter(const void *key, const void *element);
-int     ImportSorter(char* pk, char* pe);
-void    PrintByAddress(REMAP** pr);
-void    PrintByName(REMAP** pr);
+char *  DemangleSymbol(REMAPCTX * pCtx, char * pIn, char * pOut, ULONG cbOut,
+                       ULONG * pFlags);
+char *  DemangleShared(char * pIn, DMGLOUT * pOut, ULONG * pFlags);
+char *  DemangleOut(char * pIn, DMGLOUT * pOut, ULONG * pFlags);
+void    DmglInit(DMGLOUT * pOut, char * pBuf, ULONG cbBuf, int fGrow);
+int     DmglGrow(DMGLOUT * pOut, ULONG cbNeed);
+int     DmglSplitArgs(DMGLOUT * pOut, ULONG * pFlags);
+void    DmglReplaceWS(DMGLOUT * pOut);
+int     FindArgs(char * pText, ULONG * poffName, ULONG * pcbName);
+
+int     MarkDuplicates(REMAPCTX * pCtx);
+int     PrintEntriesByAddress(REMAPCTX * pCtx);
+int     PrintPublicsByName(REMAPCTX * pCtx);
+void    PrintByAddress(REMAPCTX * pCtx, REMAP** pr);
 char *  DecodeFlags(ULONG flags, char* pszFlags);
 
-int     Copy(void);
-int     CopyExports(void);
-REMAP** SetupPublicsSort(void);
-int     PrintPublics(REMAP** pr);
+int     Copy(REMAPCTX * pCtx);
+int     CopyExports(REMAPCTX * pCtx);
+REMAP** SetupPublicsSort(REMAPCTX * pCtx);
+int     PrintPublics(REMAPCTX * pCtx, REMAP** pr);
 char *  DecodeFlagName(ULONG flags);
 
 /*****************************************************************************/
 
 /** resources that have to be deallocated **/
-FILE *  fi = 0;
-FILE *  fo = 0;
 FILE *  pi = 0;
 FILE *  po = 0;
-char *  buffer = 0;
 ULONG   ulFiltPID = 0;
+HMTX    hmtxDemangle = 0;
 
 /** other globals **/
 int     opts = 0;
 char *  pszDemangler = 0;
 
-char *  pCur = 0;
-int     recCnt = 0;
-
-char    fIn[CCHMAXPATH] = "";
-char    fOut[CCHMAXPATH] = "";
+/** report options **/
+ULONG   cThreads = 0;
+ULONG   cFrames = 5;
+ULONG   cTop = 0;
+ULONG   ulBase = 0x10000;
+char ** apszFiles = 0;
+int     cFiles = 0;
 
-char    bufIn[1024];
-char    buf1[1024];
+/* demangler results kept for reuse;  the table is only set up by the
+   report modes that demangle the same names repeatedly, or when the
+   results are kept between runs (--dmglcache) */
+HASHTBL hashDemangle;
 
 /* these pointers are declared in remap_vac.c */
 extern PFNDEMANGLE  pfnDemangle;
@@ -206,20 +164,23 @@ int     cbAbs = sizeof(szAbs) - 1;
 char    szPgmEP[] = "Program entry point at ";
 int     cbPgmEP = sizeof(szPgmEP) - 1;
 
-char    szVtable[] = "vtable for ";
-int     cbVtable = sizeof(szVtable) - 1;
 char    szThunk[] = "non-virtual thunk to ";
 int     cbThunk = sizeof(szThunk) - 1;
-char    szTypeInfo[] = "typeinfo for ";
-int     cbTypeInfo = sizeof(szTypeInfo) - 1;
-char    szTypeName[] = "typeinfo name for ";
-int     cbTypeName = sizeof(szTypeName) - 1;
 char    szGuard[] = "guard variable for ";
 int     cbGuard = sizeof(szGuard) - 1;
 
 char    szVtableVAC[] = "::virtual-fn-table-ptr";
 int     cbVtableVAC = sizeof(szVtableVAC) - 1;
 
+/* the mangled prefixes of GCC's special names & the flag each one sets */
+char *  apszGccPrefix[] = {"_ZTV", "_ZTI", "_ZTS", "_ZTh", "_ZGV", 0};
+ULONG   aulGccPrefix[] = {REMAP_VTABLE, REMAP_TYPEINFO, REMAP_TYPENAME,
+                          REMAP_THUNK, REMAP_GUARD};
+
+/* how an external GCC demangler starts the names that are only a type */
+char *  apszXxcType[] = {"vtable for ", "typeinfo for ", "typeinfo name for ",
+                         0};
+
 char *  apszModules[] = {"Start", "Length", "Name", "Class", ""};
 char *  apszGroups[] = {"Origin", "Group", ""};
 char *  apszExports[] = {"Address", "Export", "Alias", ""};
@@ -261,326 +222,270 @@ char *  pszLegendXXC = "\n\n";
 
 /*****************************************************************************/
 
-char *  pszHelp =
-      "\n remap v1.02 - (C)2010  R L Walsh\n"
-        " Reformats and demangles IBM-style .map files.\n\n"
-        " Usage:  remap [-options] [optional_files] mapfile[.map]\n"
-        " General options:\n"
-        "   -a  show demangled method arguments\n"
-        "   -d  demangle only, don't reformat\n"
-        "   -n  don't demangle symbols\n"
-        "   -m  include linker warning messages (errors are always displayed)\n"
-        "   -o  specify output file             (default: *.remap or *.demap)\n"
-        "   -w  preserve whitespace in symbols  (default: replace with undersores)\n"
-        " Demangler options:\n"
-        "   -g  use builtin GCC demangler       (default)\n"
-        "   -v  use VAC demangler               (requires demangl.dll)\n"
-        "   -x  use specified demangler         (example: \"myfilt.exe -z -n yyy\")\n"
-        "\n";
+int     Init(void)
+{
+  ULONG   rc;
+
+  /* --both-args supersedes -a;  -d's listing has room for one name */
+  if (opts & OPT_BOTHARGS) {
+    opts &= ~OPT_SHOW_ARGS;
+    if (opts & OPT_DEMANGLE_ONLY)
+      opts &= ~OPT_BOTHARGS;
+  }
 
-/*****************************************************************************/
+  if (pszCacheDir && !CacheInit())
+    return 0;
 
-int main(int argc, char* argv[])
-{
-  EXCEPTIONREGISTRATIONRECORD ExRegRec;
-  int     xq;
-  int     rtn = 1;
-  char ** pArray;
+  if ((opts & (OPT_STATS | OPT_BENCH)) || pszTraceFile)
+    StatsSetup();
 
-  xq = LoadExceptq(&ExRegRec, 0);
+  if (pszTraceFile && !TraceInit())
+    return 0;
 
-  if (!ParseArgs(argc, argv)) {
-    if (xq)
-      UninstallExceptq(&ExRegRec);
+  /* --xref doesn't demangle */
+  if (opts & (OPT_NO_DEMANGLE | OPT_XREF))
     return 1;
-  }
 
-do {
-  if (!Init()) {
-    fprintf(stderr, "Init failed\n");
-    break;
+  if (opts & OPT_XXC) {
+    if (!StartDemangler())
+      return 0;
   }
-
-  if (opts & OPT_DEMANGLE_ONLY) {
-    rtn = (Copy() ? 0 : 1);
-    break;
+  else
+  if (opts & OPT_VAC) {
+    if (!LoadVacDemangler()) {
+      fprintf(stderr, "unable to load VAC demangler 'demangl.dll'\n");
+      return 0;
+    }
   }
 
-  if (!PrintUntil(apszModules)) {
-    fprintf(stderr, "modules header not found\n");
-    break;
+  /* the maps in a batch & the two maps in a diff are read concurrently
+     but share the demangler */
+  rc = DosCreateMutexSem(0, &hmtxDemangle, 0, FALSE);
+  if (rc) {
+    fprintf(stderr, "DosCreateMutexSem - rc= %ld\n", rc);
+    return 0;
   }
 
-  if (!StoreSegments(apszGroups)) {
-    fprintf(stderr, "StoreSegments failed\n");
-    break;
-  }
+  if (pszDmglCache && !DmglCacheLoad())
+    return 0;
 
-  if (!StoreGroups()) {
-    fprintf(stderr, "StoreGroups failed\n");
-    break;
-  }
+  return 1;
+}
 
-  pArray = SeekToHdr(apszExports, apszPubByName);
-  if (!pArray) {
-    fprintf(stderr, "publics by name header not found\n");
-    break;
-  }
+/*****************************************************************************/
+/* Complete the input & output filenames, then record the size of the map.
+   This can be repeated:  batch mode uses the size to order the jobs before
+   any of them are opened.
+*/
 
-  if (pArray == apszExports) {
-    if (!StoreExports()) {
-        fprintf(stderr, "StoreExports failed\n");
-        break;
-    }
+int     SetupNames(REMAPCTX * pCtx)
+{
+  char *  ptr;
+  char    szFile[CCHMAXPATH];
 
-    if (!SeekToHdr(apszPubByName, 0)) {
-        fprintf(stderr, "publics by name header not found\n");
-        break;
-    }
+  if (!*pCtx->fIn) {
+    fprintf(stderr, ".map file not specified\n");
+    return 0;
   }
 
-  if (!StorePublics()) {
-    fprintf(stderr, "StorePublics failed\n");
-    break;
+  ptr = strrchr(pCtx->fIn, '.');
+  if (!ptr) {
+    ptr = strchr(pCtx->fIn, 0);
+    strcpy(ptr, pszSrcExt);
   }
 
-  StoreEntryPoint();
-
-  if (!MarkDuplicates())
-    break;
-
-  if (!PrintEntriesByAddress())
-    break;
-
-  if (!PrintPublicsByName())
-    break;
-
-  if (opts & OPT_WARNINGS)
-    PrintUntil(0);
+  if (DosQueryPathInfo(pCtx->fIn, FIL_QUERYFULLNAME, szFile, sizeof(szFile))) {
+    fprintf(stderr, "invalid input filename or path - '%s'\n", pCtx->fIn);
+    return 0;
+  }
+  strcpy(pCtx->fIn, szFile);
 
-  rtn = 0;
+  if (!*pCtx->fOut && !(opts & (OPT_REPORTS | OPT_BENCH | OPT_ESTIMATE))) {
+    ptr = strrchr(pCtx->fIn, '\\');
+    if (!ptr)
+      ptr = pCtx->fIn - 1;
+    ptr++;
+    strcpy(pCtx->fOut, ptr);
 
-} while (0);
+    ptr = strrchr(pCtx->fOut, '.');
+    if (!ptr)
+      ptr = strchr(pCtx->fOut, 0);
+    strcpy(ptr, (opts & OPT_DEMANGLE_ONLY) ? pszDemapExt : pszRemapExt);
+  }
 
-  /* general cleanup */
-  if (fo)
-    fclose(fo);
-  if (fi)
-    fclose(fi);
-  if (buffer)
-    free(buffer);
+  /* the report modes, benchmarks, & estimates write to stdout by default */
+  if (*pCtx->fOut) {
+    if (DosQueryPathInfo(pCtx->fOut, FIL_QUERYFULLNAME, szFile, sizeof(szFile))) {
+      fprintf(stderr, "invalid output filename or path - '%s'\n", pCtx->fOut);
+      return 0;
+    }
+    strcpy(pCtx->fOut, szFile);
 
-  /* cleanup if we used an external demangler */
-  if (ulFiltPID)
-    DosSendSignalException(ulFiltPID, XCPT_SIGNAL_BREAK);
-  if (po)
-    fclose(po);
-  if (pi)
-    fclose(pi);
+    if (!stricmp(pCtx->fIn, pCtx->fOut)) {
+      fprintf(stderr, "input and output files must have different names or paths\n");
+      return 0;
+    }
+  }
 
-  if (xq)
-    UninstallExceptq(&ExRegRec);
+  /* FIL_STANDARDL reports sizes over 4gb but older kernels lack it */
+  if (!DosQueryPathInfo(pCtx->fIn, FIL_STANDARDL, szFile, sizeof(szFile)))
+    pCtx->cbMap = ((FILESTATUS3L*)szFile)->cbFile;
+  else
+  if (!DosQueryPathInfo(pCtx->fIn, FIL_STANDARD, szFile, sizeof(szFile)))
+    pCtx->cbMap = ((FILESTATUS3*)szFile)->cbFile;
+  else {
+    fprintf(stderr, "unable to find input file '%s'\n", pCtx->fIn);
+    return 0;
+  }
 
-  return rtn;
+  return 1;
 }
 
 /*****************************************************************************/
-/* This lets options & files be specified on the commandline in almost any
-   order.  The only restriction is that optional files be specified in the
-   same order as the options that required them.
-*/
+/* Open a map & its output. */
 
-int     ParseArgs(int argc, char* argv[])
+int     OpenContext(REMAPCTX * pCtx)
 {
-  int     ctr;
-  int     order = 99;
-  int     needInfile = 1;
-  int     needOutfile = 0;
-  int     needDemangler = 0;
-  char *  ptr;
-
-  if (argc < 2) {
-    fprintf(stderr, pszHelp);
+  if (((opts & OPT_STATS) || pszTraceFile) && !StatsInit(pCtx))
     return 0;
-  }
 
-  for (ctr = 1; ctr < argc; ctr++) {
-
-    if (*argv[ctr] == '-' || *argv[ctr] == '/') {
-      ptr = argv[ctr];
-
-      while (*(++ptr)) {
-        switch(*ptr) {
-          case 'a':
-          case 'A':
-            opts |= OPT_SHOW_ARGS;
-            break;
-
-          case 'd':
-          case 'D':
-            opts |= OPT_DEMANGLE_ONLY;
-            break;
-
-          case 'm':
-          case 'M':
-            opts |= OPT_WARNINGS;
-            break;
-
-          case 'w':
-          case 'W':
-            opts |= OPT_WS;
-            break;
-
-          case 'n':
-          case 'N':
-            opts |= OPT_NO_DEMANGLE;
-            break;
-
-          case 'g':
-          case 'G':
-            opts &= ~OPT_VAC;
-            opts |= OPT_GCC;
-            break;
-
-          case 'v':
-          case 'V':
-            opts &= ~OPT_GCC;
-            opts |= OPT_VAC;
-            break;
-
-          case 'o':
-          case 'O':
-            needOutfile = order--;
-            break;
-
-          case 'x':
-          case 'X':
-            opts |= OPT_XXC;
-            needDemangler = order--;
-            break;
-        } /* switch */
-      } /* while */
-
-      continue;
-    } /* if */
-
-    if (needDemangler && needDemangler > needOutfile) {
-      pszDemangler = strdup(argv[ctr]);
-      needDemangler = 0;
-    } else
-    if (needOutfile && needOutfile > needDemangler) {
-      strcpy(fOut, argv[ctr]);
-      needOutfile = 0;
-    } else
-    if (needInfile) {
-      strcpy(fIn, argv[ctr]);
-      needInfile = 0;
-    } else {
-      fprintf(stderr, "extra argument '%s'\n", argv[ctr]);
+  /* --xref reads its maps itself & fIn may be a directory */
+  if (opts & OPT_XREF) {
+    if (!*pCtx->fIn) {
+      fprintf(stderr, ".map file not specified\n");
       return 0;
     }
-  } /* for */
+  }
+  else
+  if (!OpenMap(pCtx))
+    return 0;
 
-  if (needInfile || needOutfile || needDemangler) {
-    fprintf(stderr, "missing argument for %s\n",
-            (needInfile ? "map file" :
-             (needOutfile ? "output file" : "demangler program")));
+  pCtx->fo = (*pCtx->fOut ? fopen(pCtx->fOut, "w") : stdout);
+  if (!pCtx->fo) {
+    fprintf(stderr, "unable to open output file '%s'\n", pCtx->fOut);
     return 0;
   }
-
-  if (!(opts & (OPT_GCC | OPT_VAC | OPT_XXC)))
-    opts |= OPT_GCC;
+  if (pCtx->fo != stdout)
+    MEMADD(MEM_IO, BUFSIZ);
 
   return 1;
 }
 
 /*****************************************************************************/
+/* Open a map for reading & allocate a record buffer the size of the map. */
 
-int     Init(void)
+int     OpenMap(REMAPCTX * pCtx)
 {
   ULONG   ulSize;
-  char *  ptr;
-  char    szFile[CCHMAXPATH];
 
-  if (!*fIn) {
-    fprintf(stderr, ".map file not specified\n");
+  if (!SetupNames(pCtx))
     return 0;
-  }
-
-  ptr = strrchr(fIn, '.');
-  if (!ptr) {
-    ptr = strchr(fIn, 0);
-    strcpy(ptr, pszSrcExt);
-  }
 
-  if (DosQueryPathInfo(fIn, FIL_QUERYFULLNAME, szFile, sizeof(szFile))) {
-    fprintf(stderr, "invalid input filename or path - '%s'\n", fIn);
+  pCtx->fi = fopen(pCtx->fIn, "r");
+  if (!pCtx->fi) {
+    fprintf(stderr, "unable to open input file '%s'\n", pCtx->fIn);
     return 0;
   }
-  strcpy(fIn, szFile);
-
-  if (!*fOut) {
-    ptr = strrchr(fIn, '\\');
-    if (!ptr)
-      ptr = fIn - 1;
-    ptr++;
-    strcpy(fOut, ptr);
+  MEMADD(MEM_IO, BUFSIZ);
 
-    ptr = strrchr(fOut, '.');
-    if (!ptr)
-      ptr = strchr(fOut, 0);
-    strcpy(ptr, (opts & OPT_DEMANGLE_ONLY) ? pszDemapExt : pszRemapExt);
-  }
+  /* a listing that would need more than --max-memory allows is
+     sorted in pieces that are saved in temporary files;  otherwise,
+     the entire map has to fit in memory */
+  ulSize = (pCtx->cbMap > CB_BUFMAX ? CB_BUFMAX : (ULONG)pCtx->cbMap);
+  if (!SpillInit(pCtx, &ulSize))
+    return 0;
 
-  if (DosQueryPathInfo(fOut, FIL_QUERYFULLNAME, szFile, sizeof(szFile))) {
-    fprintf(stderr, "invalid output filename or path - '%s'\n", fOut);
+  if (!pCtx->pSpill && pCtx->cbMap > CB_BUFMAX) {
+    fprintf(stderr, "'%s' is too large to read into memory%s\n", pCtx->fIn,
+            ((opts & (OPT_REPORTS | OPT_DEMANGLE_ONLY | OPT_BENCH)) ?
+             "" : " - use --max-memory"));
     return 0;
   }
-  strcpy(fOut, szFile);
 
-  if (!stricmp(fIn, fOut)) {
-    fprintf(stderr, "input and output files must have different names or paths\n");
+  pCtx->buffer = malloc(ulSize);
+  if (!pCtx->buffer) {
+    fprintf(stderr, "malloc for main buffer failed - size= %ld\n", ulSize);
     return 0;
   }
+  memset(pCtx->buffer, 0, ulSize);
+  pCtx->cbBuffer = ulSize;
+  MEMADD(MEM_RECORDS, ulSize);
+  pCtx->pCur = pCtx->buffer;
+  pCtx->recCnt = 0;
 
-  if (DosQueryPathInfo(fIn, FIL_STANDARD, szFile, sizeof(szFile))) {
-    fprintf(stderr, "unable to find input file '%s'\n", fIn);
-    return 0;
+  return 1;
+}
+
+/*****************************************************************************/
+/* Release whatever OpenContext() acquired;  the names are kept. */
+
+void    CloseContext(REMAPCTX * pCtx)
+{
+  if (pCtx->fo && pCtx->fo != stdout) {
+    fclose(pCtx->fo);
+    MEMADD(MEM_IO, -BUFSIZ);
+  }
+  if (pCtx->fi) {
+    fclose(pCtx->fi);
+    MEMADD(MEM_IO, -BUFSIZ);
   }
-  ulSize = ((FILESTATUS3*)szFile)->cbFile;
+  if (pCtx->buffer) {
+    free(pCtx->buffer);
+    MEMADD(MEM_RECORDS, -(long)pCtx->cbBuffer);
+  }
+  if (pCtx->pSpill)
+    SpillFree(pCtx);
+  if (pCtx->pStats)
+    StatsFree(pCtx);
+
+  pCtx->fo = 0;
+  pCtx->fi = 0;
+  pCtx->buffer = 0;
+  pCtx->pCur = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Produce whichever listing or report was requested for an open map. */
+
+int     ProcessMap(REMAPCTX * pCtx)
+{
+  int     rtn;
+
+  if (opts & OPT_DEMANGLE_ONLY)
+    return Copy(pCtx);
 
-  fi = fopen(fIn, "r");
-  if (!fi) {
-    fprintf(stderr, "unable to open input file '%s'\n", fIn);
+  if (opts & OPT_REPORTS)
+    return RunReport(pCtx);
+
+  if (opts & OPT_BENCHDMGL)
+    return DemangleBench(pCtx);
+
+  if (opts & OPT_BENCH)
+    return MicroBench(pCtx);
+
+  STATSBEGIN(pCtx, PH_HEADER);
+  rtn = PrintUntil(pCtx, apszModules);
+  STATSEND(pCtx, PH_HEADER);
+  if (!rtn) {
+    fprintf(stderr, "modules header not found\n");
     return 0;
   }
 
-  if (!(opts & OPT_NO_DEMANGLE)) {
-    if (opts & OPT_XXC) {
-      if (!StartDemangler())
-        return 0;
-    }
-    else
-    if (opts & OPT_VAC) {
-      if (!LoadVacDemangler()) {
-        fprintf(stderr, "unable to load VAC demangler 'demangl.dll'\n");
-        return 0;
-      }
-    }
-  }
+  if (!StoreMap(pCtx))
+    return 0;
 
-  buffer = malloc(ulSize);
-  if (!buffer) {
-    fprintf(stderr, "malloc for main buffer failed - size= %ld\n", ulSize);
+  if (!PrintEntriesByAddress(pCtx))
     return 0;
-  }
-  memset(buffer, 0, ulSize);
-  pCur = buffer;
 
-  fo = fopen(fOut, "w");
-  if (!fo) {
-    fprintf(stderr, "unable to open output file '%s'\n", fOut);
+  if (!PrintPublicsByName(pCtx))
     return 0;
+
+  if (opts & OPT_WARNINGS) {
+    STATSBEGIN(pCtx, PH_TRAILER);
+    PrintUntil(pCtx, 0);
+    STATSEND(pCtx, PH_TRAILER);
   }
 
   return 1;
@@ -599,16 +504,17 @@ int     LoadVacDemangler(void)
   PTIB      ptib;
   char *    ptr;
   char      szFailName[16];
+  char      szPath[CCHMAXPATH];
 
   *szFailName = 0;
   if (DosLoadModule(szFailName, sizeof(szFailName), "DEMANGL", &hmod)) {
     DosGetInfoBlocks(&ptib, &ppib);
-    if (DosQueryModuleName(ppib->pib_hmte, CCHMAXPATH, buf1) ||
-        (ptr = strrchr(buf1, '\\')) == 0)
+    if (DosQueryModuleName(ppib->pib_hmte, CCHMAXPATH, szPath) ||
+        (ptr = strrchr(szPath, '\\')) == 0)
       return 0;
 
     strcpy(&ptr[1], "DEMANGL.DLL");
-    if (DosLoadModule(szFailName, sizeof(szFailName), buf1, &hmod))
+    if (DosLoadModule(szFailName, sizeof(szFailName), szPath, &hmod))
       return 0;
   }
 
@@ -645,12 +551,13 @@ int     StartDemangler(void)
   char *  pExe;
   char *  pArgs;
   char    szErr[32];
+  char    szCmd[1024];
 
-  strcpy(buf1, pszDemangler);
-  pExe = strchr(buf1, 0) + 1;
+  strcpy(szCmd, pszDemangler);
+  pExe = strchr(szCmd, 0) + 1;
   *pExe++ = 0;
 
-  pArgs = Trim(buf1, 0);
+  pArgs = Trim(szCmd, 0);
   if (!pArgs) {
     fprintf(stderr, "no demangler program name\n");
     return 0;
@@ -738,18 +645,18 @@ int     StartDemangler(void)
 /*****************************************************************************/
 /* Copy from input to output until a specified header is reached. */
 
-int     PrintUntil(char ** pArray)
+int     PrintUntil(REMAPCTX * pCtx, char ** pArray)
 {
   int     found = 0;
   int     blank = 0;
   char *  ptr;
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
 
-    ptr = bufIn + strspn(bufIn, pszWS);
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
     if (!*ptr) {
       if (!blank)
-        fputs(bufIn, fo);
+        fputs(pCtx->bufIn, pCtx->fo);
       blank = 1;
       continue;
     }
@@ -764,27 +671,52 @@ int     PrintUntil(char ** pArray)
     if (!(opts & OPT_WARNINGS) && strstr(ptr, pszWarningL))
       continue;
 
-    fputs(bufIn, fo);
+    fputs(pCtx->bufIn, pCtx->fo);
   }
 
   return found;
 }
 
+/*****************************************************************************/
+/* Like PrintUntil() but nothing is copied.  The first non-blank line is
+   the name of the module the map describes;  it's saved in szMapName.
+*/
+
+int     SkipUntil(REMAPCTX * pCtx, char ** pArray)
+{
+  char *  ptr;
+
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+
+    ptr = TrimLine(pCtx->bufIn);
+    if (!ptr)
+      continue;
+
+    if (MatchArray(pArray, ptr))
+      return 1;
+
+    if (!*pCtx->szMapName)
+      strcpy(pCtx->szMapName, ptr);
+  }
+
+  return 0;
+}
+
 /*****************************************************************************/
 /* Read lines until either the "seek" or "stop" string is found */
 
-char ** SeekToHdr(char ** pSeek, char ** pStop)
+char ** SeekToHdr(REMAPCTX * pCtx, char ** pSeek, char ** pStop)
 {
   char ** pRtn = 0;
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
-    if (MatchArray(pSeek, bufIn)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+    if (MatchArray(pSeek, pCtx->bufIn)) {
       pRtn = pSeek;
       break;
     }
 
     if (pStop) {
-      if (MatchArray(pStop, bufIn)) {
+      if (MatchArray(pStop, pCtx->bufIn)) {
         pRtn = pStop;
         break;
       }
@@ -794,6 +726,160 @@ char ** SeekToHdr(char ** pSeek, char ** pStop)
   return pRtn;
 }
 
+/*****************************************************************************/
+/* Parse & store every section that follows the modules header, then mark
+   the duplicates that result from reading both listings of publics.
+*/
+
+int     StoreMap(REMAPCTX * pCtx)
+{
+  int     rtn;
+  char ** pArray;
+
+  STATSBEGIN(pCtx, PH_SEGMENTS);
+  rtn = StoreSegments(pCtx, apszGroups);
+  STATSEND(pCtx, PH_SEGMENTS);
+  if (!rtn) {
+    fprintf(stderr, "StoreSegments failed\n");
+    return 0;
+  }
+
+  STATSBEGIN(pCtx, PH_GROUPS);
+  rtn = StoreGroups(pCtx);
+  STATSEND(pCtx, PH_GROUPS);
+  if (!rtn) {
+    fprintf(stderr, "StoreGroups failed\n");
+    return 0;
+  }
+
+  pArray = SeekToHdr(pCtx, apszExports, apszPubByName);
+  if (!pArray) {
+    fprintf(stderr, "publics by name header not found\n");
+    return 0;
+  }
+
+  if (pArray == apszExports) {
+    STATSBEGIN(pCtx, PH_EXPORTS);
+    rtn = StoreExports(pCtx);
+    STATSEND(pCtx, PH_EXPORTS);
+    if (!rtn) {
+        fprintf(stderr, "StoreExports failed\n");
+        return 0;
+    }
+
+    if (!SeekToHdr(pCtx, apszPubByName, 0)) {
+        fprintf(stderr, "publics by name header not found\n");
+        return 0;
+    }
+  }
+
+  STATSBEGIN(pCtx, PH_PUBLICS);
+  rtn = PipePublics(pCtx);
+  if (rtn)
+    StoreEntryPoint(pCtx);
+  STATSEND(pCtx, PH_PUBLICS);
+  if (!rtn) {
+    fprintf(stderr, "StorePublics failed\n");
+    return 0;
+  }
+
+  /* with --max-memory, the last of the records are written out too */
+  if (pCtx->pSpill)
+    return SpillRecords(pCtx);
+
+  if (pCtx->pStats)
+    StatsRecords(pCtx);
+
+  STATSBEGIN(pCtx, PH_DUPS);
+  rtn = MarkDuplicates(pCtx);
+  STATSEND(pCtx, PH_DUPS);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Hand the map to the selected report.  Most of them need its records
+   stored first;  the diff & cross-reference read their own maps.
+*/
+
+int     RunReport(REMAPCTX * pCtx)
+{
+  int     rtn = 0;
+
+  /* this reads its own maps */
+  if (opts & OPT_XREF)
+    return CrossReference(pCtx);
+
+  /* a linker needs the names as they appear in the object files */
+  if (opts & OPT_LINKORDER)
+    opts |= OPT_NO_DEMANGLE;
+
+  /* every name appears in both listings of publics & most appear in
+     both maps, so a diff only needs to demangle each one once */
+  if ((opts & OPT_DIFF) && !(opts & OPT_NO_DEMANGLE) &&
+      !hashDemangle.ppSlot)
+    HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO));
+
+  /* these only need the names of the symbols they print, so the rest
+     are never demangled;  the names that are, are kept in the memo table.
+     The listing, '-d' & '--templates' stay eager:  the listing sorts &
+     prints every distinct name, '-d' rewrites every line, and templates
+     are grouped by name.  They'd demangle the same names, only later. */
+  if ((opts & (OPT_BUCKETS | OPT_PROFILE | OPT_SIZES | OPT_MODSIZES)) &&
+      !(opts & OPT_NO_DEMANGLE)) {
+    if (!hashDemangle.ppSlot &&
+        !HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO)))
+      return 0;
+    pCtx->fLazy = 1;
+  }
+
+  /* this reads the old & new maps concurrently */
+  if (opts & OPT_DIFF)
+    rtn = MapDiff(pCtx);
+  else
+  if (ReadMap(pCtx)) {
+    if (opts & OPT_BUCKETS)
+      rtn = CrashBuckets(pCtx);
+    else
+    if (opts & OPT_PROFILE)
+      rtn = FlatProfile(pCtx);
+    else
+    if (opts & OPT_LINKORDER)
+      rtn = LinkOrder(pCtx);
+    else
+    if (opts & OPT_SIZES)
+      rtn = SizeReport(pCtx);
+    else
+    if (opts & OPT_MODSIZES)
+      rtn = ModuleSizeReport(pCtx);
+    else
+    if (opts & OPT_TEMPLATES)
+      rtn = TemplateReport(pCtx);
+  }
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* The report modes read & store the map without echoing any of it.  The
+   first non-blank line, the name of the module, is saved in szMapName.
+*/
+
+int     ReadMap(REMAPCTX * pCtx)
+{
+  int     rtn;
+
+  STATSBEGIN(pCtx, PH_HEADER);
+  rtn = SkipUntil(pCtx, apszModules);
+  STATSEND(pCtx, PH_HEADER);
+  if (!rtn) {
+    fprintf(stderr, "modules header not found in '%s'\n", pCtx->fIn);
+    return 0;
+  }
+
+  return StoreMap(pCtx);
+}
+
 /*****************************************************************************/
 /* Match individual words in a string - this reduces the chance that a
    string will be missed due to formatting variations.
@@ -816,22 +902,26 @@ int     MatchArray(char ** pArray, char * pText)
 /*****************************************************************************/
 /* This parses and save module & segment info */
 
-int     StoreSegments(char ** pStop)
+int     StoreSegments(REMAPCTX * pCtx, char ** pStop)
 {
   ULONG   seg = 0;
   ULONG   offs = 0;
   char *  ptr;
   char *  pErr = "unexpected end of file";
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+
+    /* make sure there's room for a record */
+    if (!NextRecord(pCtx))
+      return 0;
 
-    ptr = bufIn + strspn(bufIn, pszWS);
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
 
     if (!*ptr)
       continue;
 
     if (ptr[4] == ':' && ptr[13] == ' ' && ptr[23] == 'H') {
-      if (!ParseSegment(ptr, &seg, &offs)) {
+      if (!ParseSegment(pCtx, ptr, &seg, &offs)) {
         pErr = "malformed segment header";
         break;
       }
@@ -840,7 +930,7 @@ int     StoreSegments(char ** pStop)
 
     if (!strncmp(ptr, szModule, cbModule)) {
       ptr += cbModule;
-      if (!ParseModule(ptr, seg, offs)) {
+      if (!ParseModule(pCtx, ptr, seg, offs)) {
         pErr = "malformed module listing";
         break;
       }
@@ -861,14 +951,14 @@ int     StoreSegments(char ** pStop)
 
 /*****************************************************************************/
 
-int     ParseSegment(char * pData, ULONG * pSeg, ULONG * pOffs)
+int     ParseSegment(REMAPCTX * pCtx, char * pData, ULONG * pSeg, ULONG * pOffs)
 {
   ULONG   lth;
   char *  pEnd;
   char *  pLth;
   char *  pName;
   char *  pClass;
-  REMAP * r = (REMAP*)pCur;
+  REMAP * r = (REMAP*)pCtx->pCur;
 
   pData = Trim(pData, &pLth);
   pLth = Trim(pLth, &pName);
@@ -876,7 +966,7 @@ int     ParseSegment(char * pData, ULONG * pSeg, ULONG * pOffs)
     return 0;
 
   *pSeg = strtoul(pData, &pEnd, 16);
-  if (!*pSeg || *pSeg > 255 || *pEnd != ':')
+  if (!*pSeg || *pSeg > SEG_MAX || *pEnd != ':')
     return 0;
 
   *pOffs = strtoul(&pEnd[1], 0, 16);
@@ -890,18 +980,18 @@ int     ParseSegment(char * pData, ULONG * pSeg, ULONG * pOffs)
   r->type |= REMAP_SEG;
   r->seg  = *pSeg;
   r->offs = *pOffs;
-  pCur += sprintf(r->text, "%05lX%c%s%c%s",
+  pCtx->pCur += sprintf(r->text, "%05lX%c%s%c%s",
                   lth, NULLCHAR, pName, NULLCHAR, pClass);
-  pCur += sizeof(REMAP);
-  r->next = (REMAP*)pCur;
-  recCnt++;
+  pCtx->pCur += sizeof(REMAP);
+  r->next = (REMAP*)pCtx->pCur;
+  pCtx->recCnt++;
 
   return 1;
 }
 
 /*****************************************************************************/
 
-int     ParseModule(char * pData, ULONG ulSeg, ULONG ulOffs)
+int     ParseModule(REMAPCTX * pCtx, char * pData, ULONG ulSeg, ULONG ulOffs)
 {
   ULONG   offs;
   ULONG   lth;
@@ -909,7 +999,7 @@ int     ParseModule(char * pData, ULONG ulSeg, ULONG ulOffs)
   char *  pEnd;
   char *  pLib;
   char *  pSrc;
-  REMAP * r = (REMAP*)pCur;
+  REMAP * r = (REMAP*)pCtx->pCur;
 
   offs = strtoul(pData, &ptr, 16);
   if (*ptr != ' ') {
@@ -951,11 +1041,11 @@ int     ParseModule(char * pData, ULONG ulSeg, ULONG ulOffs)
   r->type |= REMAP_MOD;
   r->seg  = ulSeg;
   r->offs = ulOffs + offs;
-  pCur += sprintf(r->text, "%05lX%c%s%c%s",
+  pCtx->pCur += sprintf(r->text, "%05lX%c%s%c%s",
                   lth, NULLCHAR, pSrc, NULLCHAR, pLib);
-  pCur += sizeof(REMAP);
-  r->next = (REMAP*)pCur;
-  recCnt++;
+  pCtx->pCur += sizeof(REMAP);
+  r->next = (REMAP*)pCtx->pCur;
+  pCtx->recCnt++;
 
   return 1;
 }
@@ -963,21 +1053,23 @@ int     ParseModule(char * pData, ULONG ulSeg, ULONG ulOffs)
 /*****************************************************************************/
 /* Parse & store the Groups section */
 
-int     StoreGroups(void)
+int     StoreGroups(REMAPCTX * pCtx)
 {
   char *  pSegOffs;
   char *  pGroup;
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
 
-    REMAP * r = (REMAP*)pCur;
+    REMAP * r = NextRecord(pCtx);
+    if (!r)
+      return 0;
 
-    pSegOffs = Trim(bufIn, &pGroup);
+    pSegOffs = Trim(pCtx->bufIn, &pGroup);
     if (!pSegOffs)
       break;
 
     r->seg = strtoul(pSegOffs, &pSegOffs, 16);
-    if (r->seg > 255 || *pSegOffs != ':')
+    if (r->seg > SEG_MAX || *pSegOffs != ':')
       return 0;
     r->offs = strtoul(&pSegOffs[1], 0, 16);
 
@@ -987,9 +1079,9 @@ int     StoreGroups(void)
 
     r->type |= REMAP_GRP;
     strcpy(r->text, pGroup);
-    pCur = strchr(r->text, 0) + 1;
-    r->next = (REMAP*)pCur;
-    recCnt++;
+    pCtx->pCur = strchr(r->text, 0) + 1;
+    r->next = (REMAP*)pCtx->pCur;
+    pCtx->recCnt++;
   }
 
   return 1;
@@ -1000,18 +1092,21 @@ int     StoreGroups(void)
    the external name is left as-is so it can be matched to other listings.
 */
 
-int     StoreExports(void)
+int     StoreExports(REMAPCTX * pCtx)
 {
   int     skip = 0;
   char *  pSegOffs;
   char *  pExport;
   char *  pAlias;
+  char *  ptr;
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
 
-    REMAP * r = (REMAP*)pCur;
+    REMAP * r = NextRecord(pCtx);
+    if (!r)
+      return 0;
 
-    pSegOffs = Trim(bufIn, &pExport);
+    pSegOffs = Trim(pCtx->bufIn, &pExport);
     if (!pSegOffs) {
       if (!skip) {
         skip = 1;
@@ -1021,7 +1116,7 @@ int     StoreExports(void)
     }
 
     r->seg = strtoul(pSegOffs, &pSegOffs, 16);
-    if (r->seg > 255 || *pSegOffs != ':') {
+    if (r->seg > SEG_MAX || *pSegOffs != ':') {
       fprintf(stderr, "r->seg failed - r->seg= %lx  *pSegOffs= '%c'\n",
               r->seg, *pSegOffs);
       return 0;
@@ -1036,18 +1131,31 @@ int     StoreExports(void)
       return 0;
     }
 
-    pAlias = Demangle(pAlias, buf1, sizeof(buf1), &r->type);
+    if (!pCtx->fLazy)
+      pAlias = DemangleSymbol(pCtx, pAlias, r->text, RecordSpace(pCtx, r),
+                              &r->type);
+    else
+    if (ClassifyName(pAlias, 0, 0) != NAME_PLAIN)
+      r->type |= REMAP_LAZY;
     if (!pAlias) {
       fprintf(stderr, "Demangle failed for alias\n");
       return 0;
     }
 
+    /* the alias was usually demangled in place;  if it wasn't, it has
+       no arguments to keep */
+    if (pAlias != r->text)
+      r->type &= ~REMAP_ARGS;
     r->type |= REMAP_EXP;
-    pCur += sprintf(r->text, "%s%c%s",
-                    pAlias, NULLCHAR, pExport);
-    pCur += sizeof(REMAP);
-    r->next = (REMAP*)pCur;
-    recCnt++;
+    ptr = StoreNames(pCtx, r, pAlias, pExport);
+    if (!ptr) {
+      fprintf(stderr, "export '%s' is too long to store\n", pExport);
+      return 0;
+    }
+    pCtx->pCur += (ptr - 1) - r->text;
+    pCtx->pCur += sizeof(REMAP);
+    r->next = (REMAP*)pCtx->pCur;
+    pCtx->recCnt++;
   }
 
   return 1;
@@ -1061,7 +1169,7 @@ int     StoreExports(void)
 */
 
 
-int     StorePublics(void)
+int     StorePublics(REMAPCTX * pCtx)
 {
   int     skip = 0;
   int     byValue = 0;
@@ -1072,11 +1180,13 @@ int     StorePublics(void)
   char *  pImport;
 
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
 
-    REMAP * r = (REMAP*)pCur;
+    REMAP * r = NextRecord(pCtx);
+    if (!r)
+      return 0;
 
-    ptr = bufIn + strspn(bufIn, pszWS);
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
 
     if (!*ptr) {
       if (!skip) {
@@ -1087,7 +1197,7 @@ int     StorePublics(void)
       if (byValue)
         break;
 
-      if (!SeekToHdr(apszPubByValue, 0)) {
+      if (!SeekToHdr(pCtx, apszPubByValue, 0)) {
         fprintf(stderr, "publics by value header not found\n");
         return 0;
       }
@@ -1098,8 +1208,8 @@ int     StorePublics(void)
     skip = 1;
 
     r->seg = strtoul(ptr, &pEnd, 16);
-    if (r->seg > 255 || *pEnd != ':') {
-      StoreError(bufIn, r);
+    if (r->seg > SEG_MAX || *pEnd != ':') {
+      StoreError(pCtx, pCtx->bufIn, r);
       continue;
     }
 
@@ -1113,7 +1223,7 @@ int     StorePublics(void)
     }
 
     if (!ctr) {
-      StoreError(bufIn, r);
+      StoreError(pCtx, pCtx->bufIn, r);
       continue;
     }
     ptr += strspn(ptr, pszWS);
@@ -1129,38 +1239,25 @@ int     StorePublics(void)
       ptr += cbAbs;
     } else
     if (ctr != 1) {
-      StoreError(bufIn, r);
+      StoreError(pCtx, pCtx->bufIn, r);
       continue;
     }
 
     pSymbol = Trim(ptr, &ptr);
     if (!pSymbol) {
       fprintf(stderr, "symbol name not found\n");
-      StoreError(bufIn, r);
-      continue;
-    }
-
-    pSymbol = Demangle(pSymbol, buf1, sizeof(buf1), &r->type);
-    if (!pSymbol) {
-      fprintf(stderr, "Demangle failed for symbol name\n");
-      StoreError(bufIn, r);
+      StoreError(pCtx, pCtx->bufIn, r);
       continue;
     }
 
-    /* Mapsym can't handle names over 255 characters long. */
-    if (opts & OPT_DEMANGLE_ONLY) {
-      if (strlen(pSymbol) > 255)
-        strcpy(&pSymbol[252], "...");
-    }
-
-    strcpy(r->text, pSymbol);
-    pCur = strchr(r->text, 0) + 1;
-
+    /* the import is found first, so nothing fails once the name has
+       been demangled into the record */
+    pImport = 0;
     if (ctr == 2) {
       pImport = Trim(ptr, 0);
       if (!pImport) {
         fprintf(stderr, "import name not found\n");
-        StoreError(bufIn, r);
+        StoreError(pCtx, pCtx->bufIn, r);
         continue;
       }
 
@@ -1170,30 +1267,103 @@ int     StorePublics(void)
         if (*ptr == ')')
           *ptr = 0;
       }
+    }
 
-      strcpy(pCur, pImport);
-      pCur = strchr(pCur, 0) + 1;
+    if (!pCtx->fLazy)
+      pSymbol = DemangleSymbol(pCtx, pSymbol, r->text, RecordSpace(pCtx, r),
+                               &r->type);
+    else
+    if (ClassifyName(pSymbol, 0, 0) != NAME_PLAIN)
+      r->type |= REMAP_LAZY;
+    if (!pSymbol) {
+      fprintf(stderr, "Demangle failed for symbol name\n");
+      StoreError(pCtx, pCtx->bufIn, r);
+      continue;
     }
 
-    if (!(r->type & REMAP_IMP))
-      r->type |= REMAP_OBJ;
-    r->next = (REMAP*)pCur;
-    recCnt++;
+    /* Mapsym can't handle names over 255 characters long.  If the name
+       is already in the record, the rest of it has to be cleared. */
+    if (opts & OPT_DEMANGLE_ONLY) {
+      pEnd = strchr(pSymbol, 0);
+      if (pEnd - pSymbol > 255) {
+        strcpy(&pSymbol[252], "...");
+        if (pSymbol == r->text)
+          memset(&pSymbol[256], 0, pEnd - &pSymbol[255]);
+      }
+    }
+
+    if (pSymbol != r->text)
+      r->type &= ~REMAP_ARGS;
+    ptr = StoreNames(pCtx, r, pSymbol, pImport);
+    if (!ptr) {
+      StoreError(pCtx, pCtx->bufIn, r);
+      continue;
+    }
+    pCtx->pCur = ptr;
+
+    if (!(r->type & REMAP_IMP))
+      r->type |= REMAP_OBJ;
+    r->next = (REMAP*)pCtx->pCur;
+    pCtx->recCnt++;
   }
 
   return 1;
 }
 
 /*****************************************************************************/
+/* Finish a record's text:  its name, unless it was demangled in place,
+   then an import's or export's external name, then the name with its
+   arguments if r->type has REMAP_ARGS (it's moved to make room).  Returns
+   the end of the text, or null if it won't fit in the record;  a name
+   already in it is then cleared, since the records end where the
+   buffer's still zeroed.
+*/
 
-int     StoreEntryPoint(void)
+char *  StoreNames(REMAPCTX * pCtx, REMAP * r, char * pName, char * pExt)
+{
+  ULONG   cbName;
+  ULONG   cbExt = 0;
+  ULONG   cbArgs = 0;
+
+  cbName = NameLength(pName, r->type);
+  if (pExt)
+    cbExt = strlen(pExt) + 1;
+
+  if (cbName > RecordSpace(pCtx, r) || cbExt > sizeof(pCtx->bufIn)) {
+    if (pName == r->text)
+      memset(r->text, 0, cbName);
+    return 0;
+  }
+
+  if (pName != r->text)
+    memcpy(r->text, pName, cbName);
+  cbName = strlen(r->text) + 1;
+  if (r->type & REMAP_ARGS)
+    cbArgs = strlen(&r->text[cbName]) + 1;
+
+  if (pExt) {
+    if (cbArgs)
+      memmove(&r->text[cbName + cbExt], &r->text[cbName], cbArgs);
+    memcpy(&r->text[cbName], pExt, cbExt);
+    cbName += cbExt;
+  }
+
+  return &r->text[cbName + cbArgs];
+}
+
+/*****************************************************************************/
+
+int     StoreEntryPoint(REMAPCTX * pCtx)
 {
   int       skip = 0;
   char *    ptr;
-  REMAP *   r = (REMAP*)pCur;
+  REMAP *   r = NextRecord(pCtx);
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
-    ptr = bufIn + strspn(bufIn, pszWS);
+  if (!r)
+    return 0;
+
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
 
     if (!*ptr) {
       if (!skip) {
@@ -1210,11 +1380,11 @@ int     StoreEntryPoint(void)
     r->seg  = strtoul(ptr, &ptr, 16);
     r->offs = strtoul(&ptr[1], 0, 16);
     strcpy(r->text, pszEntryPoint);
-    pCur = strchr(r->text, 0) + 1;        
+    pCtx->pCur = strchr(r->text, 0) + 1;        
 
     r->type |= REMAP_EPT;
-    r->next = (REMAP*)pCur;
-    recCnt++;
+    r->next = (REMAP*)pCtx->pCur;
+    pCtx->recCnt++;
     return 1;
   }
 
@@ -1228,28 +1398,30 @@ int     StoreEntryPoint(void)
    Publics are listed.
 */
 
-int     StoreError(char * pBuf, REMAP * r)
+int     StoreError(REMAPCTX * pCtx, char * pBuf, REMAP * r)
 {
   char *  ptr;
 
   if (strstr(pBuf, pszWarningL)) {
     if (opts & OPT_WARNINGS)
-      fputs(pBuf, fo);
+      fputs(pBuf, pCtx->fo);
     return 1;
   }
 
   r->type = REMAP_ERR;
-  r->seg  = 0xffff;
+  r->seg  = SEG_ERR;
   r->offs = 0xffffffff;
 
   ptr = strchr(pBuf, 0) - 1;
   while (ptr > pBuf && strchr(pszWS, *ptr))
     ptr--;
   *(++ptr) = 0;
+  if (ptr - pBuf >= RecordSpace(pCtx, r))
+    pBuf[RecordSpace(pCtx, r) - 1] = 0;
   strcpy(r->text, pBuf);
-  pCur = strchr(r->text, 0) + 1;
-  r->next = (REMAP*)pCur;
-  recCnt++;
+  pCtx->pCur = strchr(r->text, 0) + 1;
+  r->next = (REMAP*)pCtx->pCur;
+  pCtx->recCnt++;
 
   return 1;
 }
@@ -1308,60 +1480,595 @@ char *  TrimLine(char * pTrim)
 }
 
 /*****************************************************************************/
-/* Called by the GCC demangler one or more times to copy the pieces
-   of a demangled method to an output buffer.  pv is actually a ptr
-   to the pOut & cbOut arguments to Demangle() - cheesy, huh?
+/* Start an empty name in the caller's buffer.  If fGrow is set, it's
+   moved to the heap if it outgrows the buffer;  otherwise, a name that
+   doesn't fit isn't demangled.  Either way, nothing is truncated.
+*/
+
+void    DmglInit(DMGLOUT * pOut, char * pBuf, ULONG cbBuf, int fGrow)
+{
+  memset(pOut, 0, sizeof(DMGLOUT));
+  pOut->pBuf  = pBuf;
+  pOut->cbBuf = cbBuf;
+  pOut->fGrow = fGrow;
+  pOut->fKeepWS = ((opts & (OPT_WS | OPT_BOTHARGS)) != 0);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Called by the GCC demangler one or more times with the pieces of a
+   name;  the other demanglers use it too.  pv is the DMGLOUT they're
+   appended to.  Unless whitespace is wanted, it's replaced as it's
+   copied, & trailing whitespace is tracked so it can be dropped.
 */
 
 void    DemangleCallback(const char* pSrc, size_t cbSrc, void * pv)
 {
-  struct ptr_lth {
-    char *  pbuf;
-    ULONG   cbbuf;
-  } * p;
-  size_t  cnt;
+  char *    ptr;
+  char *    pEnd;
+  DMGLOUT * pOut = (DMGLOUT*)pv;
+
+  if (pOut->fFull)
+    return;
 
-  p = (struct ptr_lth*)pv;
-  cnt = strlen(p->pbuf);
-  if (cnt + cbSrc + 1 < p->cbbuf)
-    strcpy(p->pbuf + cnt, pSrc);
+  if (pOut->cb + cbSrc >= pOut->cbBuf &&
+      !DmglGrow(pOut, pOut->cb + cbSrc + 1)) {
+    pOut->fFull = 1;
+    return;
+  }
+
+  ptr = &pOut->pBuf[pOut->cb];
+  for (pEnd = ptr + cbSrc; ptr < pEnd; ptr++, pSrc++) {
+    if (*pSrc == ' ' || *pSrc == '\t' || *pSrc == '\r' || *pSrc == '\n')
+      *ptr = (pOut->fKeepWS ? *pSrc : '_');
+    else {
+      *ptr = *pSrc;
+      pOut->cbText = ptr - pOut->pBuf + 1;
+    }
+  }
+  pOut->cb += cbSrc;
+  *ptr = 0;
+  if (pOut->cbUsed < pOut->cb + 1)
+    pOut->cbUsed = pOut->cb + 1;
 
   return;
 }
 
 /*****************************************************************************/
-/* This handles demangling by all 3 demanglers:  an external process;
-   VAC via demangl.dll; and the builtin GCC demangler.
+/* Make room for at least cbNeed bytes by doubling the buffer. */
+
+int     DmglGrow(DMGLOUT * pOut, ULONG cbNeed)
+{
+  ULONG   cb;
+  char *  ptr;
+
+  if (!pOut->fGrow)
+    return 0;
+
+  for (cb = (pOut->cbBuf ? pOut->cbBuf * 2 : 256); cb < cbNeed; cb *= 2)
+    ;
+
+  ptr = (char*)realloc(pOut->pHeap, cb);
+  if (!ptr)
+    return 0;
+  if (!pOut->pHeap)
+    memcpy(ptr, pOut->pBuf, pOut->cb + 1);
+
+  pOut->pHeap = ptr;
+  pOut->pBuf  = ptr;
+  pOut->cbBuf = cb;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* For --both-args:  the name was demangled with its arguments;  this puts
+   the name without them in front, so pOut holds "name\0name(args)" &
+   REMAP_ARGS is set.  If they're the same, there's just the one.  The
+   whitespace was kept until now because it's needed to find the name.
+*/
+
+int     DmglSplitArgs(DMGLOUT * pOut, ULONG * pFlags)
+{
+  ULONG   offName;
+  ULONG   cbName;
+  ULONG   cbNeed;
+
+  FindArgs(pOut->pBuf, &offName, &cbName);
+  if (cbName && cbName < pOut->cb) {
+    cbNeed = cbName + 1 + pOut->cb + 1;
+    if (cbNeed > pOut->cbBuf && !DmglGrow(pOut, cbNeed))
+      return 0;
+
+    memmove(&pOut->pBuf[cbName + 1], pOut->pBuf, pOut->cb + 1);
+    memcpy(pOut->pBuf, &pOut->pBuf[cbName + 1 + offName], cbName);
+    pOut->pBuf[cbName] = 0;
+    pOut->cb += cbName + 1;
+    if (pOut->cbUsed < pOut->cb + 1)
+      pOut->cbUsed = pOut->cb + 1;
+    *pFlags |= REMAP_ARGS;
+  }
+
+  DmglReplaceWS(pOut);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Replace the whitespace that DemangleCallback() kept, unless it's wanted.
+   Both of a name's forms are done.
+*/
+
+void    DmglReplaceWS(DMGLOUT * pOut)
+{
+  char *  ptr;
+  char *  pEnd;
+
+  if (opts & OPT_WS)
+    return;
+
+  for (ptr = pOut->pBuf, pEnd = ptr + pOut->cb; ptr < pEnd; ptr++) {
+    if (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n')
+      *ptr = '_';
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Find the part of a demangled name that's left when its arguments are
+   removed:  whatever precedes its last parameter list, less the return
+   type a template function has.  A list followed by '::' belongs to the
+   function a local name is in, & is kept as the demangler keeps it.
+   Returns 0 if the name has no arguments.
+*/
+
+int     FindArgs(char * pText, ULONG * poffName, ULONG * pcbName)
+{
+  int     depth = 0;
+  char *  ptr;
+  char *  pOp;
+  char *  pOpen = 0;
+  char *  pArgs = 0;
+
+  *poffName = 0;
+  *pcbName = 0;
+
+  for (ptr = pText; *ptr; ptr++) {
+    if (*ptr == '(') {
+      if (!depth++)
+        pOpen = ptr;
+    }
+    else
+    if (*ptr == ')') {
+      if (depth && !--depth)
+        pArgs = pOpen;
+    }
+    else
+    if (!depth && ptr[0] == ':' && ptr[1] == ':')
+      pArgs = 0;
+  }
+
+  if (!pArgs || pArgs == pText)
+    return 0;
+
+  /* only a template function's name ends in '>' & has a return type in
+     front, separated by the first space that isn't inside its brackets;
+     "operator< <int>" has a space of its own */
+  ptr = pText;
+  if (pArgs[-1] == '>') {
+    for (depth = 0, ptr = pArgs; ptr > pText; ptr--) {
+      if (ptr[-1] == '>' || ptr[-1] == ')')
+        depth++;
+      else
+      if ((ptr[-1] == '<' || ptr[-1] == '(') && depth)
+        depth--;
+      else
+      if (ptr[-1] == ' ' && !depth) {
+        for (pOp = ptr - 1; pOp > pText && strchr("<>=!+-*/%^&|~,", pOp[-1]);
+             pOp--)
+          ;
+        if (pOp - pText < 8 || memcmp(pOp - 8, "operator", 8))
+          break;
+        ptr = pOp - 7;
+      }
+    }
+  }
+
+  *poffName = ptr - pText;
+  *pcbName = pArgs - ptr;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* The bytes a demangled name takes, including the name with its
+   arguments that --both-args puts after it.
+*/
+
+ULONG   NameLength(char * pName, ULONG flags)
+{
+  ULONG   cb;
+
+  cb = strlen(pName) + 1;
+  if (flags & REMAP_ARGS)
+    cb += strlen(&pName[cb]) + 1;
+
+  return cb;
+}
+
+/*****************************************************************************/
+/* Demangle a name into pOut, which is usually where its record goes;
+   --stats times each call.
+*/
+
+char *  DemangleSymbol(REMAPCTX * pCtx, char * pIn, char * pOut, ULONG cbOut,
+                       ULONG * pFlags)
+{
+  char *  ptr;
+
+  if (!pCtx->pStats)
+    return Demangle(pIn, pOut, cbOut, pFlags);
+
+  StatsBegin(pCtx->pStats, PH_DEMANGLE);
+  ptr = Demangle(pIn, pOut, cbOut, pFlags);
+  StatsEnd(pCtx->pStats, PH_DEMANGLE);
+  pCtx->pStats->cDemangle++;
+
+  return ptr;
+}
+
+/*****************************************************************************/
+/* If the memo table has been set up, return the saved result for a name
+   that's already been demangled;  otherwise, demangle it & save it.  If
+   the result doesn't fit in pOut, the name is returned unchanged.
 */
 
 char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags)
+{
+  ULONG     cb;
+  char *    ptr;
+  DMGLMEMO* pMemo = 0;
+  DMGLOUT   out;
+
+  if ((opts & OPT_NO_DEMANGLE) || ClassifyName(pIn, 0, 0) == NAME_PLAIN)
+    return pIn;
+
+  if (hashDemangle.ppSlot)
+    pMemo = DemangleMemo(pIn);
+
+  /* pOut is often the next record;  the records end where the buffer's
+     still zeroed, so whatever's left past the name is cleared */
+  if (!pMemo) {
+    DmglInit(&out, pOut, cbOut, 0);
+    ptr = DemangleShared(pIn, &out, pFlags);
+    cb = (ptr == pOut ? NameLength(pOut, *pFlags) : 0);
+    if (out.cbUsed > cb)
+      memset(&pOut[cb], 0, out.cbUsed - cb);
+    return ptr;
+  }
+
+  cb = NameLength(pMemo->pText, pMemo->flags);
+  if (cb > cbOut)
+    return pIn;
+
+  *pFlags |= pMemo->flags;
+  memcpy(pOut, pMemo->pText, cb);
+
+  return pOut;
+}
+
+/*****************************************************************************/
+/* Return the memo table's entry for a name, demangling it first if it's
+   new.  Maps may be read concurrently, so access to the table is
+   serialized.  If the name can't be demangled or saved, null is returned.
+*/
+
+DMGLMEMO *  DemangleMemo(char * pIn)
+{
+  ULONG     flags = 0;
+  ULONG     cb = 0;
+  char *    ptr;
+  char *    pCopy;
+  char *    pText = 0;
+  HASHENT * pEnt;
+  DMGLMEMO* pMemo;
+  DMGLOUT   out;
+  char      szOut[512];
+
+  DosRequestMutexSem(hmtxDemangle, SEM_INDEFINITE_WAIT);
+  pEnt = HashFind(&hashDemangle, pIn, 1);
+  cDmglLookups++;
+  if (pEnt && ((DMGLMEMO*)pEnt->pv)->pText) {
+    cDmglHits++;
+    DosReleaseMutexSem(hmtxDemangle);
+    return (DMGLMEMO*)pEnt->pv;
+  }
+  DosReleaseMutexSem(hmtxDemangle);
+
+  if (!pEnt)
+    return 0;
+
+  /* the demangler may shorten its input, which may be a record's text,
+     so it gets a copy */
+  pCopy = strdup(pIn);
+  if (!pCopy)
+    return 0;
+
+  /* entries never move, so the name can be demangled without holding
+     the table;  a long name's heap buffer becomes the entry's text */
+  DmglInit(&out, szOut, sizeof(szOut), 1);
+  ptr = DemangleShared(pCopy, &out, &flags);
+  if (ptr)
+    cb = NameLength(ptr, flags);
+  if (ptr && ptr == out.pHeap) {
+    pText = (char*)realloc(out.pHeap, cb);
+    if (pText)
+      out.pHeap = 0;
+  }
+  else
+  if (ptr && (pText = (char*)malloc(cb)) != 0)
+    memcpy(pText, ptr, cb);
+  if (out.pHeap)
+    free(out.pHeap);
+  free(pCopy);
+
+  /* if another thread saved it meanwhile, its copy is kept */
+  pMemo = (DMGLMEMO*)pEnt->pv;
+  DosRequestMutexSem(hmtxDemangle, SEM_INDEFINITE_WAIT);
+  if (pText && !pMemo->pText) {
+    pMemo->pText = pText;
+    pMemo->flags = flags;
+    pMemo->fNew = 1;
+    MEMADD(MEM_STRINGS, cb);
+    pText = 0;
+  }
+  DosReleaseMutexSem(hmtxDemangle);
+  if (pText)
+    free(pText);
+
+  return (pMemo->pText ? pMemo : 0);
+}
+
+/*****************************************************************************/
+/* A record stored lazily (REMAP_LAZY) keeps its mangled name until it's
+   needed;  this returns the demangled name, saved in the memo table.  If
+   it can't be demangled, the mangled name is used.  Other records are
+   returned as-is.
+*/
+
+char *  RecordName(REMAP * r)
+{
+  DMGLMEMO* pMemo;
+
+  if (!(r->type & REMAP_LAZY))
+    return r->text;
+
+  pMemo = DemangleMemo(r->text);
+
+  return (pMemo ? pMemo->pText : r->text);
+}
+
+/*****************************************************************************/
+/* With --both-args, a public's, import's, or export's name is also kept
+   with its arguments (REMAP_ARGS);  this returns that form, or the name
+   if they're the same.  It follows an import's or export's external name.
+*/
+
+char *  RecordArgs(REMAP * r)
+{
+  DMGLMEMO* pMemo;
+  char *    ptr;
+
+  if (r->type & REMAP_LAZY) {
+    pMemo = DemangleMemo(r->text);
+    if (!pMemo)
+      return r->text;
+    if (!(pMemo->flags & REMAP_ARGS))
+      return pMemo->pText;
+    return strchr(pMemo->pText, 0) + 1;
+  }
+
+  if (!(r->type & REMAP_ARGS))
+    return r->text;
+
+  ptr = strchr(r->text, 0) + 1;
+  if (r->type & (REMAP_IMP | REMAP_EXP))
+    ptr = strchr(ptr, 0) + 1;
+
+  return ptr;
+}
+
+/*****************************************************************************/
+/* A lazy record's type lacks the flags that demangling adds (REMAP_VTABLE
+   etc.) until they're looked up here.
+*/
+
+ULONG   RecordType(REMAP * r)
+{
+  DMGLMEMO* pMemo;
+
+  if (!(r->type & REMAP_LAZY))
+    return r->type;
+
+  pMemo = DemangleMemo(r->text);
+
+  return (pMemo ? (r->type | pMemo->flags) : r->type);
+}
+
+/*****************************************************************************/
+/* The builtin GCC demangler is reentrant;  the VAC demangler & the pipes
+   to an external one have to be used by one thread at a time.
+*/
+
+char *  DemangleShared(char * pIn, DMGLOUT * pOut, ULONG * pFlags)
+{
+  int     kind;
+  char *  ptr;
+  double  dStart = 0;
+
+  kind = ClassifyName(pIn, 0, 0);
+  if (kind != NAME_VAC && kind != NAME_XXC)
+    return DemangleOut(pIn, pOut, pFlags);
+
+  if (pszTraceFile)
+    dStart = StatsNow();
+  DosRequestMutexSem(hmtxDemangle, SEM_INDEFINITE_WAIT);
+  if (pszTraceFile)
+    TraceSpan("demangler wait", dStart, TRACE_DETAIL);
+
+  ptr = DemangleOut(pIn, pOut, pFlags);
+  DosReleaseMutexSem(hmtxDemangle);
+
+  return ptr;
+}
+
+/*****************************************************************************/
+/* Entries loaded from the demangle cache point into its buffer. */
+
+void    FreeDemangleMemo(void)
+{
+  HASHENT** ppArr;
+  HASHENT** ppEnt;
+  DMGLMEMO* pMemo;
+
+  if (!hashDemangle.ppSlot)
+    return;
+
+  ppArr = HashToArray(&hashDemangle);
+  if (ppArr) {
+    for (ppEnt = ppArr; *ppEnt; ppEnt++) {
+      pMemo = (DMGLMEMO*)(*ppEnt)->pv;
+      if (pMemo->fNew && pMemo->pText) {
+        MEMADD(MEM_STRINGS, -(long)NameLength(pMemo->pText, pMemo->flags));
+        free(pMemo->pText);
+      }
+    }
+    free(ppArr);
+  }
+
+  HashFree(&hashDemangle);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Decide which demangler a name needs from its prefix, without calling
+   any of them.  Names that aren't mangled are used as-is.  GCC's names
+   go to the builtin demangler even when VAC's was chosen, so a map with
+   code from both is demangled completely.  The external demangler's
+   scheme is unknown, so it gets every name.
+
+   For GCC, *pSkip is the offset of "_Z".  A special name's flag goes in
+   *pFlags;  a vtable's or typeinfo's flag says all the demangler would
+   add, so only the type after its prefix has to be demangled.  pSkip &
+   pFlags may be null.
+*/
+
+int     ClassifyName(char * pIn, int * pSkip, ULONG * pFlags)
 {
   int     ndx;
+  int     ctr;
+
+  if (opts & OPT_XXC)
+    return NAME_XXC;
+
+  /* some tools add an underscore or '@' in front of GCC's '_Z' */
+  ndx = ((*pIn == '_' || *pIn == '@') && pIn[1] == '_' && pIn[2] == 'Z');
+  if (pIn[ndx] == '_' && pIn[ndx + 1] == 'Z') {
+    if (pSkip)
+      *pSkip = ndx;
+    if (pIn[ndx + 2] != 'T' && pIn[ndx + 2] != 'G')
+      return NAME_GCC;
+
+    for (ctr = 0; apszGccPrefix[ctr]; ctr++) {
+      if (!memcmp(&pIn[ndx], apszGccPrefix[ctr], 4)) {
+        if (pFlags)
+          *pFlags = aulGccPrefix[ctr];
+        return ((aulGccPrefix[ctr] & (REMAP_THUNK | REMAP_GUARD)) ?
+                NAME_GCC : NAME_GCCTYPE);
+      }
+    }
+    return NAME_GCC;
+  }
+
+  /* everything VAC mangles contains a double underscore, e.g.
+     'func__Fi', '__ct__3FooFv', & '__vft3Foo' */
+  if ((opts & OPT_VAC) && strstr(pIn, "__"))
+    return NAME_VAC;
+
+  return NAME_PLAIN;
+}
+
+/*****************************************************************************/
+/* This handles demangling by all 3 demanglers:  an external process;
+   VAC via demangl.dll; and the builtin GCC demangler.  The name is
+   appended to pOut;  if it doesn't fit, pIn is returned.
+*/
+
+char *  DemangleOut(char * pIn, DMGLOUT * pOut, ULONG * pFlags)
+{
+  int     ndx = 0;
+  int     kind;
+  int     cb;
+  int     ctr;
+  ULONG   flags = 0;
   char *  ptr;
+  double  dStart = 0;
+
+  if (!pOut->cbBuf)
+    return pIn;
+  *pOut->pBuf = 0;
 
-  if (opts & OPT_NO_DEMANGLE)
+  kind = ClassifyName(pIn, &ndx, &flags);
+  if (kind == NAME_PLAIN)
     return pIn;
 
-  *pOut = 0;
+  /* the reply is read in pieces until its newline, so a long one
+     can't leave the rest of it in the pipe */
+  if (kind == NAME_XXC) {
+    char    szReply[256];
 
-  if (opts & OPT_XXC) {
+    if (pszTraceFile)
+      dStart = StatsNow();
     fprintf(po, "%s\n", pIn);
-    fgets(pOut, cbOut, pi);
+    while (fgets(szReply, sizeof(szReply), pi)) {
+      cb = strlen(szReply);
+      DemangleCallback(szReply, cb, pOut);
+      if (cb && szReply[cb - 1] == '\n')
+        break;
+    }
+    if (pszTraceFile)
+      TraceSpan("external demangler", dStart, TRACE_DETAIL);
 
-    if (!(opts & OPT_WS)) {
-      ptr = pOut;
-      while ((ptr = strpbrk(ptr, pszWS)) != 0)
-        *ptr++ = '_';
+    if (pOut->fFull)
+      return pIn;
+
+    /* the reply's newline isn't part of either form of the name;  a
+       vtable's or typeinfo's type has no arguments to remove */
+    if (opts & OPT_BOTHARGS) {
+      pOut->cb = pOut->cbText;
+      pOut->pBuf[pOut->cb] = 0;
+      for (ctr = 0; apszXxcType[ctr]; ctr++) {
+        if (!strncmp(pOut->pBuf, apszXxcType[ctr], strlen(apszXxcType[ctr])))
+          break;
+      }
+      if (apszXxcType[ctr])
+        DmglReplaceWS(pOut);
+      else
+      if (!DmglSplitArgs(pOut, pFlags))
+        return pIn;
     }
 
-    return pOut;
+    return pOut->pBuf;
   }
 
   /* The functions in demangl.dll all use Optlink which gcc 4.x can't handle,
      so they're invoked via wrapper functions in remap_vac.c.  Each wrapper
      has '_vac' appended to the function's original name.
   */
-  if (opts & OPT_VAC) {
+  if (kind == NAME_VAC) {
     Name *    nm;
     NameKind  nk;
 
@@ -1377,58 +2084,66 @@ char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags)
       if (nk == MemberFunction) {
         ptr = qualifier_vac(nm);
         if (ptr) {
-          strcpy(pOut, ptr);
-          strcat(pOut, "::");
+          DemangleCallback(ptr, strlen(ptr), pOut);
+          DemangleCallback("::", 2, pOut);
         }
       }
       ptr = functionName_vac(nm);
       if (ptr)
-        strcat(pOut, ptr);
+        DemangleCallback(ptr, strlen(ptr), pOut);
+
+      /* --both-args adds the full text after the name */
+      if ((opts & OPT_BOTHARGS) && (ptr = text_vac(nm)) != 0) {
+        cb = pOut->cb;
+        DemangleCallback("", 1, pOut);
+        DemangleCallback(ptr, strlen(ptr), pOut);
+        if (strcmp(pOut->pBuf, &pOut->pBuf[cb + 1]))
+          flags |= REMAP_ARGS;
+        else
+          pOut->cb = cb;
+      }
     }
     else {
       ptr = text_vac(nm);
-      if (!ptr)
+      if (!ptr) {
+        erase_vac(nm);
         return pIn;
-      strcpy(pOut, ptr);
+      }
+      DemangleCallback(ptr, strlen(ptr), pOut);
     }
+    erase_vac(nm);
+
+    if (pOut->fFull)
+      return pIn;
 
-    if (nk == Special && (ptr = strstr(pOut, szVtableVAC)) != 0) {
+    if (nk == Special && (ptr = strstr(pOut->pBuf, szVtableVAC)) != 0) {
       char *  pEnd;
 
       *pFlags |= REMAP_VTABLE;
       *ptr = 0;
+      pOut->cb = ptr - pOut->pBuf;
 
       /* vtable entries for subclasses are formatted '{subclass}class';
        * this reformats it as 'class::subclass'
       */
-      if (*pOut == '{' && (pEnd = strchr(pOut, '}')) != 0) {
+      if (*pOut->pBuf == '{' && (pEnd = strchr(pOut->pBuf, '}')) != 0) {
         *pEnd++ = 0;
         *ptr++ = ':';
         *ptr++ = ':';
-        strcpy(ptr, &pOut[1]);
-        strcpy(pOut, pEnd);
+        strcpy(ptr, &pOut->pBuf[1]);
+        memmove(pOut->pBuf, pEnd, strlen(pEnd) + 1);
+        pOut->cb = strlen(pOut->pBuf);
       }
     }
 
-    erase_vac(nm);
-
-    if (!(opts & OPT_WS)) {
-      ptr = pOut;
-      while ((ptr = strpbrk(ptr, pszWS)) != 0)
-        *ptr++ = '_';
-    }
+    if (opts & OPT_BOTHARGS)
+      DmglReplaceWS(pOut);
+    *pFlags |= flags;
 
-    return pOut;
+    return pOut->pBuf;
   }
 
-  /* OPT_GCC */
-  if (!memcmp(pIn, "__Z", 3) || !memcmp(pIn, "@_Z", 3))
-    ndx = 1;
-  else
-  if (!memcmp(pIn, "_Z", 2))
-    ndx = 0;
-  else
-    return pIn;
+  /* NAME_GCC & NAME_GCCTYPE */
 
   /* Mozilla (at least) appends a unique identifier to many symbols
      that the demangler can't handle.  If the leading characters of
@@ -1438,59 +2153,79 @@ char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags)
   if (ptr)
     *ptr = 0;
 
-  *pOut = 0;
+  /* a vtable's or typeinfo's flag stands for the text the demangler
+     would put in front of its type, so only the type is demangled */
+  if (kind == NAME_GCCTYPE) {
+    if (!cplus_demangle_v3_callback(&pIn[ndx + 4], DMGL_TYPES,
+                                    &DemangleCallback, pOut))
+      return pIn;
+  }
+  else
   if (!cplus_demangle_v3_callback(&pIn[ndx],
-                                  ((opts & OPT_SHOW_ARGS) ? DMGL_PARAMS : 0),
-                                  &DemangleCallback, &pOut))
+                                  ((opts & (OPT_SHOW_ARGS | OPT_BOTHARGS)) ?
+                                   DMGL_PARAMS : 0),
+                                  &DemangleCallback, pOut))
     return pIn;
 
-  ptr = strchr(pOut, 0) - 1;
-  while (ptr > pOut && strchr(pszWS, *ptr))
-    ptr--;
-  *(++ptr) = 0;
+  if (pOut->fFull)
+    return pIn;
 
-  /* Convert metadata generated by the demangler into flags,
-     then remove the metadata.
-  */
-  if (strchr(pOut, ' ')) {
-    if (!strncmp(pOut, szVtable, cbVtable)) {
-      *pFlags |= REMAP_VTABLE;
-      strcpy(pOut, pOut + cbVtable);
+  /* trailing whitespace may have been replaced, so it's dropped by length */
+  pOut->cb = pOut->cbText;
+  pOut->pBuf[pOut->cb] = 0;
+
+  /* a thunk's or guard variable's text is replaced by its flag */
+  if (flags & (REMAP_THUNK | REMAP_GUARD)) {
+    ptr = ((flags & REMAP_THUNK) ? szThunk : szGuard);
+    cb  = ((flags & REMAP_THUNK) ? cbThunk : cbGuard);
+
+    /* its spaces may have been replaced already */
+    for (ctr = 0; ctr < cb; ctr++) {
+      if (pOut->pBuf[ctr] != ptr[ctr] &&
+          (ptr[ctr] != ' ' || pOut->pBuf[ctr] != '_'))
+        break;
     }
-    else
-    if (!strncmp(pOut, szThunk, cbThunk)) {
-      *pFlags |= REMAP_THUNK;
-      strcpy(pOut, pOut + cbThunk);
+    if (ctr < cb)
+      flags = 0;
+    else {
+      pOut->cb -= cb;
+      memmove(pOut->pBuf, pOut->pBuf + cb, pOut->cb + 1);
 
       /* remove the argument list that gets included for thunks */
-      if (!(opts & OPT_SHOW_ARGS) &&
-          (ptr = strchr(pOut, '(')) != 0)
+      if ((flags & REMAP_THUNK) &&
+          !(opts & (OPT_SHOW_ARGS | OPT_BOTHARGS)) &&
+          (ptr = strchr(pOut->pBuf, '(')) != 0) {
         *ptr = 0;
-    }
-    else
-    if (!strncmp(pOut, szTypeInfo, cbTypeInfo)) {
-      *pFlags |= REMAP_TYPEINFO;
-      strcpy(pOut, pOut + cbTypeInfo);
-    }
-    else
-    if (!strncmp(pOut, szTypeName, cbTypeName)) {
-      *pFlags |= REMAP_TYPENAME;
-      strcpy(pOut, pOut + cbTypeName);
-    }
-    else
-    if (!strncmp(pOut, szGuard, cbGuard)) {
-      *pFlags |= REMAP_GUARD;
-      strcpy(pOut, pOut + cbGuard);
+        pOut->cb = ptr - pOut->pBuf;
+      }
     }
   }
 
-  if (!(opts & OPT_WS)) {
-    ptr = pOut;
-    while ((ptr = strpbrk(ptr, pszWS)) != 0)
-        *ptr++ = '_';
+  /* a vtable's or typeinfo's type has no arguments to remove */
+  if (opts & OPT_BOTHARGS) {
+    if (kind == NAME_GCCTYPE)
+      DmglReplaceWS(pOut);
+    else
+    if (!DmglSplitArgs(pOut, &flags))
+      return pIn;
   }
+  *pFlags |= flags;
 
-  return pOut;
+  return pOut->pBuf;
+}
+
+/*****************************************************************************/
+/* Demangle a name into a fixed buffer;  a name that doesn't fit isn't
+   demangled.
+*/
+
+char *  DemangleName(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags)
+{
+  DMGLOUT out;
+
+  DmglInit(&out, pOut, cbOut, 0);
+
+  return DemangleOut(pIn, &out, pFlags);
 }
 
 /*****************************************************************************/
@@ -1498,26 +2233,27 @@ char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags)
    Publics by Name and Publics by value.
 */
 
-int     MarkDuplicates(void)
+int     MarkDuplicates(REMAPCTX * pCtx)
 {
   int     ctr;
   REMAP** pr;
   REMAP** pArr;
   REMAP * pRec;
 
-  if (!recCnt) {
+  if (!pCtx->recCnt) {
     fprintf(stderr, "no records to sort\n");
     return 0;
   }
 
-  pr = (REMAP**)malloc((recCnt + 1) * sizeof(REMAP*));
+  pr = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
   if (!pr) {
     fprintf(stderr, "malloc failed for MarkDuplicates - bytes= %d\n",
-            recCnt * sizeof(REMAP*));
+            pCtx->recCnt * sizeof(REMAP*));
     return 0;
   }
+  MEMADD(MEM_SORT, (pCtx->recCnt + 1) * sizeof(REMAP*));
 
-  pRec = (REMAP*)buffer;
+  pRec = (REMAP*)pCtx->buffer;
   pArr = pr;
   ctr = 0;
   while (pRec->next) {
@@ -1527,14 +2263,15 @@ int     MarkDuplicates(void)
   }
   *pArr = 0;
 
-  if (ctr != recCnt) {
+  if (ctr != pCtx->recCnt) {
     fprintf(stderr, "invalid record count:  cnt= %d  recCnt= %d\n",
-            ctr, recCnt);
+            ctr, pCtx->recCnt);
     return 0;
   }
 
-  qsort(pr, recCnt, sizeof(REMAP*), DuplicateSorter);
+  qsort(pr, pCtx->recCnt, sizeof(REMAP*), DuplicateSorter);
   free(pr);
+  MEMADD(MEM_SORT, -(long)((pCtx->recCnt + 1) * sizeof(REMAP*)));
 
   return 1;
 }
@@ -1542,21 +2279,32 @@ int     MarkDuplicates(void)
 /*****************************************************************************/
 /* Sort then print all entries by address. */
 
-int     PrintEntriesByAddress(void)
+int     PrintEntriesByAddress(REMAPCTX * pCtx)
 {
   int     ctr;
   REMAP** pr;
   REMAP** pArr;
   REMAP * pRec;
 
-  pr = (REMAP**)malloc((recCnt + 1) * sizeof(REMAP*));
+  /* the runs are merged as the listing is printed */
+  if (pCtx->pSpill) {
+    STATSBEGIN(pCtx, PH_PRINTADDR);
+    ctr = MergeByAddress(pCtx);
+    STATSEND(pCtx, PH_PRINTADDR);
+    return ctr;
+  }
+
+  STATSBEGIN(pCtx, PH_SORTADDR);
+
+  pr = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
   if (!pr) {
     fprintf(stderr, "malloc failed for PrintEntriesByAddress - bytes= %d\n",
-            recCnt * sizeof(REMAP*));
+            pCtx->recCnt * sizeof(REMAP*));
     return 0;
   }
+  MEMADD(MEM_SORT, (pCtx->recCnt + 1) * sizeof(REMAP*));
 
-  pRec = (REMAP*)buffer;
+  pRec = (REMAP*)pCtx->buffer;
   pArr = pr;
   ctr  = 0;
   while (pRec->next) {
@@ -1569,9 +2317,13 @@ int     PrintEntriesByAddress(void)
   *pArr = 0;
 
   qsort(pr, ctr, sizeof(REMAP*), AddressSorter);
+  STATSEND(pCtx, PH_SORTADDR);
 
-  PrintByAddress(pr);
+  STATSBEGIN(pCtx, PH_PRINTADDR);
+  PrintByAddress(pCtx, pr);
+  STATSEND(pCtx, PH_PRINTADDR);
   free(pr);
+  MEMADD(MEM_SORT, -(long)((pCtx->recCnt + 1) * sizeof(REMAP*)));
 
   return 1;
 }
@@ -1580,21 +2332,31 @@ int     PrintEntriesByAddress(void)
 /* Sort then print publics by address. */
 
 
-int     PrintPublicsByName(void)
+int     PrintPublicsByName(REMAPCTX * pCtx)
 {
   int     ctr;
   REMAP** pr;
   REMAP** pArr;
   REMAP * pRec;
 
-  pr = (REMAP**)malloc((recCnt + 1) * sizeof(REMAP*));
+  if (pCtx->pSpill) {
+    STATSBEGIN(pCtx, PH_PRINTNAME);
+    ctr = MergeByName(pCtx);
+    STATSEND(pCtx, PH_PRINTNAME);
+    return ctr;
+  }
+
+  STATSBEGIN(pCtx, PH_SORTNAME);
+
+  pr = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
   if (!pr) {
     fprintf(stderr, "malloc failed for PublicsByName - bytes= %d\n",
-            recCnt * sizeof(REMAP*));
+            pCtx->recCnt * sizeof(REMAP*));
     return 0;
   }
+  MEMADD(MEM_SORT, (pCtx->recCnt + 1) * sizeof(REMAP*));
 
-  pRec = (REMAP*)buffer;
+  pRec = (REMAP*)pCtx->buffer;
   pArr = pr;
   ctr  = 0;
   while (pRec->next) {
@@ -1610,13 +2372,33 @@ int     PrintPublicsByName(void)
   *pArr = 0;
 
   qsort(pr, ctr, sizeof(REMAP*), NameSorter);
+  STATSEND(pCtx, PH_SORTNAME);
 
-  PrintByName(pr);
+  STATSBEGIN(pCtx, PH_PRINTNAME);
+  PrintByName(pCtx, pr);
+  STATSEND(pCtx, PH_PRINTNAME);
   free(pr);
+  MEMADD(MEM_SORT, -(long)((pCtx->recCnt + 1) * sizeof(REMAP*)));
 
   return 1;
 }
 
+/*****************************************************************************/
+/* Order two records by address.  Offsets can be more than 2gb apart,
+   so the difference between them won't fit in an int.
+*/
+
+int     CompareAddress(REMAP * pk, REMAP * pe)
+{
+  if (pk->seg != pe->seg)
+    return (pk->seg < pe->seg ? -1 : 1);
+
+  if (pk->offs != pe->offs)
+    return (pk->offs < pe->offs ? -1 : 1);
+
+  return 0;
+}
+
 /*****************************************************************************/
 /* qsort callback for identifying duplicates */
 
@@ -1626,24 +2408,29 @@ int     DuplicateSorter(const void *key, const void *element)
   ULONG   kType;
   ULONG   eType;
 
-  res = (*(REMAP**)key)->seg - (*(REMAP**)element)->seg;
-  if (res)
-    return res;
-
-  res = (*(REMAP**)key)->offs - (*(REMAP**)element)->offs;
+  res = CompareAddress(*(REMAP**)key, *(REMAP**)element);
   if (res)
     return res;
 
   kType = (*(REMAP**)key)->type;
   eType = (*(REMAP**)element)->type;
 
-  res = (kType & REMAP_MASK) - (eType & REMAP_MASK);
-  if (res)
-    return res;
+  /* lazy records with the same mangled name are identical, so neither
+     has to be demangled;  otherwise, their types & names are compared */
+  if (!(kType & eType & REMAP_LAZY) ||
+      (kType & REMAP_MASK) != (eType & REMAP_MASK) ||
+      strcmp((*(REMAP**)key)->text, (*(REMAP**)element)->text)) {
+    kType = RecordType(*(REMAP**)key);
+    eType = RecordType(*(REMAP**)element);
 
-  res = strcmp((*(REMAP**)key)->text, (*(REMAP**)element)->text);
-  if (res)
-    return res;
+    res = (kType & REMAP_MASK) - (eType & REMAP_MASK);
+    if (res)
+      return res;
+
+    res = strcmp(RecordName(*(REMAP**)key), RecordName(*(REMAP**)element));
+    if (res)
+      return res;
+  }
 
   if (kType & REMAP_IMP) {
     res = ImportSorter((*(REMAP**)key)->text, (*(REMAP**)element)->text);
@@ -1666,11 +2453,7 @@ int     AddressSorter(const void *key, const void *element)
   ULONG   kType;
   ULONG   eType;
 
-  res = (*(REMAP**)key)->seg - (*(REMAP**)element)->seg;
-  if (res)
-    return res;
-
-  res = (*(REMAP**)key)->offs - (*(REMAP**)element)->offs;
+  res = CompareAddress(*(REMAP**)key, *(REMAP**)element);
   if (res)
     return res;
 
@@ -1694,17 +2477,33 @@ int     AddressSorter(const void *key, const void *element)
       return res;
   }
 
-  return stricmp((*(REMAP**)key)->text, (*(REMAP**)element)->text);
+  if ((kType & eType & REMAP_LAZY) &&
+      !strcmp((*(REMAP**)key)->text, (*(REMAP**)element)->text))
+    return 0;
+
+  return stricmp(RecordName(*(REMAP**)key), RecordName(*(REMAP**)element));
 }
 
 /*****************************************************************************/
 /* qsort callback for sorting by name */
 
 int     NameSorter(const void *key, const void *element)
+{
+  return CompareNames(RecordName(*(REMAP**)key), *(REMAP**)key,
+                      RecordName(*(REMAP**)element), *(REMAP**)element);
+}
+
+/*****************************************************************************/
+/* The order of the listing by name:  leading underscores are ignored,
+   then same-named symbols are ordered by address.  The names are passed
+   separately so a caller can supply ones it's already demangled.
+*/
+
+int     CompareNames(char * pk, REMAP * rk, char * pe, REMAP * re)
 {
   int     res;
-  char *  pk = (*(REMAP**)key)->text;
-  char *  pe = (*(REMAP**)element)->text;
+  char *  pkName = pk;
+  char *  peName = pe;
 
   while (*pk && *pk == '_')
     pk++;
@@ -1715,19 +2514,14 @@ int     NameSorter(const void *key, const void *element)
   if (res)
     return res;
 
-  res = (*(REMAP**)key)->seg - (*(REMAP**)element)->seg;
+  res = CompareAddress(rk, re);
   if (res)
     return res;
 
-  res = (*(REMAP**)key)->offs - (*(REMAP**)element)->offs;
-  if (res)
-    return res;
-
-  if (((*(REMAP**)key)->type & REMAP_IMP) &&
-      ((*(REMAP**)element)->type & REMAP_IMP))
-    return ImportSorter(pk, pe);
+  if ((rk->type & REMAP_IMP) && (re->type & REMAP_IMP))
+    return ImportSorter(rk->text, re->text);
 
-  return stricmp((*(REMAP**)key)->text, (*(REMAP**)element)->text);
+  return stricmp(pkName, peName);
 }
 
 /*****************************************************************************/
@@ -1764,194 +2558,240 @@ int     ImportSorter(char* pk, char* pe)
 /*****************************************************************************/
 /* Print the unified listing by address. */
 
-void    PrintByAddress(REMAP** pr)
+void    PrintByAddress(REMAPCTX * pCtx, REMAP** pr)
+{
+  LISTSTATE state;
+
+  memset(&state, 0, sizeof(state));
+
+  fputs(pszAddressHdr, pCtx->fo);
+  fputs(pszColumnHdr, pCtx->fo);
+
+  while (*pr) {
+    PrintAddressEntry(pCtx, pr[0], pr[1], &state);
+    pr++;
+  }
+
+  PrintLegend(pCtx);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Print one entry of the listing by address.  The entry that follows it
+   (if any) determines whether a module listing is set off by a blank line.
+*/
+
+void    PrintAddressEntry(REMAPCTX * pCtx, REMAP * r, REMAP * pNext,
+                          LISTSTATE * pState)
 {
-  int     errhdr = 0;
-  int     last   = 0;
   char *  p0;
   char *  p1;
   char *  p2;
   char *  pNL;
-  REMAP * r;
   char    szFlags[16];
 
-  r = *pr;
+  switch (r->type & REMAP_TYPE) {
+    case REMAP_GRP:
+      p0 = r->text;
+      fprintf(pCtx->fo, "%s G %04lX:%08lX         %s\n",
+              (pState->last ? "\n" : ""),
+              r->seg, r->offs, p0);
+      pState->last = REMAP_GRP;
+      break;
 
-  fputs(pszAddressHdr, fo);
-  fputs(pszColumnHdr, fo);
+    case REMAP_SEG:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
+      p2 = strchr(p1, 0) + 1;
+      fprintf(pCtx->fo, "%s S %04lX:%08lX  %-5s  %-24s  %s\n",
+              (pState->last == REMAP_SEG ? "" : "\n"),
+              r->seg, r->offs, p0, p1, p2);
+      pState->last = REMAP_SEG;
+      break;
 
-  while (r) {
+    case REMAP_MOD:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
+      p2 = strchr(p1, 0) + 1;
 
-    switch (r->type & REMAP_TYPE) {
-      case REMAP_GRP:
-        p0 = r->text;
-        fprintf(fo, "%s G %04lX:%08lX         %s\n",
-                (last ? "\n" : ""),
-                r->seg, r->offs, p0);
-        last = REMAP_GRP;
-        break;
+      pNL = "\n";
+      if (pState->last == REMAP_SEG || pState->last == REMAP_MOD) {
+          if (pNext && (pNext->type & (REMAP_SEG | REMAP_MOD)))
+              pNL = "";
+      }
 
-      case REMAP_SEG:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
-        p2 = strchr(p1, 0) + 1;
-        fprintf(fo, "%s S %04lX:%08lX  %-5s  %-24s  %s\n",
-                (last == REMAP_SEG ? "" : "\n"),
-                r->seg, r->offs, p0, p1, p2);
-        last = REMAP_SEG;
-        break;
+      fprintf(pCtx->fo, "%s M %04lX:%08lX  %-5s  %-24s  (%s)\n",
+              pNL, r->seg, r->offs, p0, p1, p2);
+      pState->last = REMAP_MOD;
+      break;
 
-      case REMAP_MOD:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
-        p2 = strchr(p1, 0) + 1;
+    case REMAP_IMP:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
 
-        pNL = "\n";
-        if (last == REMAP_SEG || last == REMAP_MOD) {
-            if (pr[1] && (pr[1]->type & (REMAP_SEG | REMAP_MOD)))
-                pNL = "";
-        }
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %-24s  [%s]  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %-24s  [%s]\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
+      pState->last = REMAP_IMP;
+      break;
 
-        fprintf(fo, "%s M %04lX:%08lX  %-5s  %-24s  (%s)\n",
-                pNL, r->seg, r->offs, p0, p1, p2);
-        last = REMAP_MOD;
-        break;
+    case REMAP_EXP:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
 
-      case REMAP_IMP:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %-24s  [%s]  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %-24s  [%s]\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
+      pState->last = REMAP_EXP;
+      break;
 
-        fprintf(fo, " . %04lX:%08lX  %-5s  %-24s  [%s]\n",
-            r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
-        last = REMAP_IMP;
+    case REMAP_OBJ:
+      if (r->type & REMAP_DUP)
         break;
 
-      case REMAP_EXP:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
+      p0 = r->text;
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %-24s  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, " . %04lX:%08lX  %-5s  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
+      pState->last = REMAP_OBJ;
+      break;
 
-        fprintf(fo, " . %04lX:%08lX  %-5s  %-24s  [%s]\n",
-                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
-        last = REMAP_EXP;
-        break;
+    case REMAP_EPT:
+      p0 = r->text;
+      fprintf(pCtx->fo, " E %04lX:%08lX  %-5s  <%s>\n",
+              r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
+      pState->last = REMAP_EPT;
+      break;
 
-      case REMAP_OBJ:
-        if (r->type & REMAP_DUP)
-          break;
+    case REMAP_ERR:
+      if (!pState->errhdr) {
+          pState->errhdr = 1;
+          fprintf(pCtx->fo, "\n Type  Mapfile lines that couldn't be parsed\n");
+      }
+      p0 = r->text;
+      fprintf(pCtx->fo, " ? %s\n", p0);
+      pState->last = REMAP_ERR;
+      break;
 
-        p0 = r->text;
-        fprintf(fo, " . %04lX:%08lX  %-5s  %s\n",
-                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
-        last = REMAP_OBJ;
-        break;
+    default:
+      fprintf(pCtx->fo, " ERROR:  unknown type= %lu\n",
+              (r->type & REMAP_TYPE));
+      pState->last = REMAP_ERR;
+      break;
+  }
 
-      case REMAP_EPT:
-        p0 = r->text;
-        fprintf(fo, " E %04lX:%08lX  %-5s  <%s>\n",
-                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
-        last = REMAP_EPT;
-        break;
+  return;
+}
 
-      case REMAP_ERR:
-        if (!errhdr) {
-            errhdr = 1;
-            fprintf(fo, "\n Type  Mapfile lines that couldn't be parsed\n");
-        }
-        p0 = r->text;
-        fprintf(fo, " ? %s\n", p0);
-        last = REMAP_ERR;
-        break;
+/*****************************************************************************/
+/* Print the publics listing by name. */
 
-      default:
-        fprintf(fo, " ERROR:  unknown type= %lu\n", (r->type & REMAP_TYPE));
-        last = REMAP_ERR;
-        break;
-    }
+void    PrintByName(REMAPCTX * pCtx, REMAP** pr)
+{
+  fputs(pszNameHdr, pCtx->fo);
+  fputs(pszColumnHdr, pCtx->fo);
 
+  while (*pr) {
+    PrintNameEntry(pCtx, *pr);
     pr++;
-    r = *pr;
   }
 
-  fputs(pszLegend, fo);
-  if (opts & OPT_GCC)
-    fputs(pszLegendGCC, fo);
-  else
-  if (opts & OPT_VAC)
-    fputs(pszLegendVAC, fo);
-  else
-    fputs(pszLegendXXC, fo);
+  PrintLegend(pCtx);
 
   return;
 }
 
 /*****************************************************************************/
-/* Print the publics listing by name. */
+/* Print one entry of the publics listing by name. */
 
-void    PrintByName(REMAP** pr)
+void    PrintNameEntry(REMAPCTX * pCtx, REMAP * r)
 {
   char *  p0;
   char *  p1;
-  REMAP * r;
   char    szFlags[16];
 
-  r = *pr;
-
-  fputs(pszNameHdr, fo);
-  fputs(pszColumnHdr, fo);
-
-  while (r) {
-
-    switch (r->type & REMAP_TYPE) {
-
-      case REMAP_IMP:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
-        fprintf(fo, "   %04lX:%08lX  %-5s  %-24s  [%s]\n",
+  switch (r->type & REMAP_TYPE) {
+
+    case REMAP_IMP:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %-24s  [%s]  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %-24s  [%s]\n",
                 r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
-        break;
+      break;
 
-      case REMAP_EXP:
-        p0 = r->text;
-        p1 = strchr(p0, 0) + 1;
-        fprintf(fo, "   %04lX:%08lX  %-5s  %-24s  [%s]\n",
+    case REMAP_EXP:
+      p0 = r->text;
+      p1 = strchr(p0, 0) + 1;
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %-24s  [%s]  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %-24s  [%s]\n",
                 r->seg, r->offs, DecodeFlags(r->type, szFlags), p0, p1);
-        break;
-
-      case REMAP_OBJ:
-        if (r->type & REMAP_DUP) {
-          fprintf(fo, " ERROR:  found REMAP_DUP\n");
-          break;
-        }
+      break;
 
-        p0 = r->text;
-        fprintf(fo, "   %04lX:%08lX  %-5s  %s\n",
-                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
+    case REMAP_OBJ:
+      if (r->type & REMAP_DUP) {
+        fprintf(pCtx->fo, " ERROR:  found REMAP_DUP\n");
         break;
+      }
 
-      case REMAP_EPT:
-        p0 = r->text;
-        fprintf(fo, " E %04lX:%08lX  %-5s  <%s>\n",
+      p0 = r->text;
+      if (r->type & REMAP_ARGS)
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %-24s  %s\n",
+                r->seg, r->offs, DecodeFlags(r->type, szFlags), p0,
+                RecordArgs(r));
+      else
+        fprintf(pCtx->fo, "   %04lX:%08lX  %-5s  %s\n",
                 r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
-        break;
+      break;
 
-      default:
-        fprintf(fo, " ERROR:  unexpected type= %lu\n",
-                (r->type & REMAP_TYPE));
-        break;
-    }
+    case REMAP_EPT:
+      p0 = r->text;
+      fprintf(pCtx->fo, " E %04lX:%08lX  %-5s  <%s>\n",
+              r->seg, r->offs, DecodeFlags(r->type, szFlags), p0);
+      break;
 
-    pr++;
-    r = *pr;
+    default:
+      fprintf(pCtx->fo, " ERROR:  unexpected type= %lu\n",
+              (r->type & REMAP_TYPE));
+      break;
   }
 
-  fputs(pszLegend, fo);
+  return;
+}
+
+/*****************************************************************************/
+
+void    PrintLegend(REMAPCTX * pCtx)
+{
+  fputs(pszLegend, pCtx->fo);
   if (opts & OPT_GCC)
-    fputs(pszLegendGCC, fo);
+    fputs(pszLegendGCC, pCtx->fo);
   else
   if (opts & OPT_VAC)
-    fputs(pszLegendVAC, fo);
+    fputs(pszLegendVAC, pCtx->fo);
   else
-    fputs(pszLegendXXC, fo);
+    fputs(pszLegendXXC, pCtx->fo);
 
   return;
 }
@@ -1993,7 +2833,7 @@ char *  DecodeFlags(ULONG flags, char* pszFlags)
   if (flags & REMAP_DUP2)
     pszFlags[ctr++] = '2';
 
-  if (flags & ~REMAP_MASK)
+  if (flags & ~(REMAP_MASK | REMAP_ARGS))
     pszFlags[ctr++] = '?';
 
   pszFlags[ctr] = 0;
@@ -2005,65 +2845,90 @@ char *  DecodeFlags(ULONG flags, char* pszFlags)
 /*  code used to when -d (demangle-only) option is selected                  */
 /*****************************************************************************/
 
-int     Copy(void)
+int     Copy(REMAPCTX * pCtx)
 {
+  int     rtn;
   char ** pSeek = 0;
   REMAP** pArr;
 
   /* copy lines until either the exports or publics section is encountered */
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  STATSBEGIN(pCtx, PH_HEADER);
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
     pSeek = apszExports;
-    if (MatchArray(pSeek, bufIn)) {
-      fputs(bufIn, fo);
+    if (MatchArray(pSeek, pCtx->bufIn)) {
+      fputs(pCtx->bufIn, pCtx->fo);
       break;
     }
     pSeek = apszPubByName;
-    if (MatchArray(pSeek, bufIn)) {
-      fputs(bufIn, fo);
+    if (MatchArray(pSeek, pCtx->bufIn)) {
+      fputs(pCtx->bufIn, pCtx->fo);
       break;
     }
-    if (!(opts & OPT_WARNINGS) && strstr(bufIn, pszWarningL))
+    if (!(opts & OPT_WARNINGS) && strstr(pCtx->bufIn, pszWarningL))
       continue;
 
-    fputs(bufIn, fo);
+    fputs(pCtx->bufIn, pCtx->fo);
   }
+  STATSEND(pCtx, PH_HEADER);
 
   /* if there are exports, demangle & reprint them */
   if (pSeek == apszExports) {
-    if (!CopyExports())
+    STATSBEGIN(pCtx, PH_EXPORTS);
+    rtn = CopyExports(pCtx);
+    STATSEND(pCtx, PH_EXPORTS);
+    if (!rtn)
       return 0;
   }
 
   /* read & store both Pubs by Name & Pubs by Value */
-  if (!StorePublics()) {
+  STATSBEGIN(pCtx, PH_PUBLICS);
+  rtn = PipePublics(pCtx);
+  STATSEND(pCtx, PH_PUBLICS);
+  if (!rtn) {
     fprintf(stderr, "StorePublics failed\n");
     return 0;
   }
 
+  if (pCtx->pStats)
+    StatsRecords(pCtx);
+
   /* sort the publics and eliminate dups */
-  pArr = SetupPublicsSort();
+  STATSBEGIN(pCtx, PH_DUPS);
+  pArr = SetupPublicsSort(pCtx);
+  STATSEND(pCtx, PH_DUPS);
   if (!pArr)
     return 0;
 
   /* sort by name & print */
-  qsort(pArr, recCnt, sizeof(REMAP*), NameSorter);
-  PrintPublics(pArr);
+  STATSBEGIN(pCtx, PH_SORTNAME);
+  qsort(pArr, pCtx->recCnt, sizeof(REMAP*), NameSorter);
+  STATSEND(pCtx, PH_SORTNAME);
+  STATSBEGIN(pCtx, PH_PRINTNAME);
+  PrintPublics(pCtx, pArr);
+  STATSEND(pCtx, PH_PRINTNAME);
 
   /* sort by value & print */
-  qsort(pArr, recCnt, sizeof(REMAP*), AddressSorter);
-  fprintf(fo, "\n\n %s\n", pszPubByVal);
-  PrintPublics(pArr);
+  STATSBEGIN(pCtx, PH_SORTADDR);
+  qsort(pArr, pCtx->recCnt, sizeof(REMAP*), AddressSorter);
+  STATSEND(pCtx, PH_SORTADDR);
+  STATSBEGIN(pCtx, PH_PRINTADDR);
+  fprintf(pCtx->fo, "\n\n %s\n", pszPubByVal);
+  PrintPublics(pCtx, pArr);
+  STATSEND(pCtx, PH_PRINTADDR);
 
   /* free the array of public entries */
   free(pArr);
+  MEMADD(MEM_SORT, -(long)((pCtx->recCnt + 1) * sizeof(REMAP*)));
 
   /* copy whatever remains (entrypoint & trailing linker messages) */
-  fputs("\n", fo);
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
-    if (!(opts & OPT_WARNINGS) && strstr(bufIn, pszWarningL))
+  STATSBEGIN(pCtx, PH_TRAILER);
+  fputs("\n", pCtx->fo);
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+    if (!(opts & OPT_WARNINGS) && strstr(pCtx->bufIn, pszWarningL))
       continue;
-    fputs(bufIn, fo);
+    fputs(pCtx->bufIn, pCtx->fo);
   }
+  STATSEND(pCtx, PH_TRAILER);
 
   return 1;
 }
@@ -2071,7 +2936,7 @@ int     Copy(void)
 /*****************************************************************************/
 /* Demangle & reprint Exports */
 
-int     CopyExports(void)
+int     CopyExports(REMAPCTX * pCtx)
 {
   int     blank = 0;
   ULONG   flags;
@@ -2079,19 +2944,19 @@ int     CopyExports(void)
   char *  p1;
   char *  p2;
 
-  while (fgets(bufIn, sizeof(bufIn), fi)) {
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
 
-    p0 = bufIn + strspn(bufIn, pszWS);
+    p0 = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
     if (!*p0) {
       blank = 1;
-      fputs(bufIn, fo);
+      fputs(pCtx->bufIn, pCtx->fo);
       continue;
     }
 
     if (blank) {
       blank = 0;
       if (MatchArray(apszPubByName, p0)) {
-        fputs(bufIn, fo);
+        fputs(pCtx->bufIn, pCtx->fo);
         break;
       }
     }
@@ -2105,8 +2970,8 @@ int     CopyExports(void)
     }
 
     flags = 0;
-    p2 = Demangle(p2, buf1, sizeof(buf1), &flags);
-    fprintf(fo, " %s %22s  %s%s\n", p0, p1, p2, DecodeFlagName(flags));
+    p2 = DemangleSymbol(pCtx, p2, pCtx->buf1, sizeof(pCtx->buf1), &flags);
+    fprintf(pCtx->fo, " %s %22s  %s%s\n", p0, p1, p2, DecodeFlagName(flags));
   }
 
   return 1;
@@ -2115,24 +2980,25 @@ int     CopyExports(void)
 /*****************************************************************************/
 /* Identify duplicates, then copy non-duplicate entries to a new array. */
 
-REMAP** SetupPublicsSort(void)
+REMAP** SetupPublicsSort(REMAPCTX * pCtx)
 {
   int     ctr;
   REMAP** pRtn;
   REMAP** pArr;
   REMAP * pRec;
 
-  if (!MarkDuplicates())
+  if (!MarkDuplicates(pCtx))
     return 0;
 
-  pRtn = (REMAP**)malloc((recCnt + 1) * sizeof(REMAP*));
+  pRtn = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
   if (!pRtn) {
     fprintf(stderr, "malloc failed for SetupPublicsSort - bytes= %d\n",
-            recCnt * sizeof(REMAP*));
+            pCtx->recCnt * sizeof(REMAP*));
     return 0;
   }
+  MEMADD(MEM_SORT, (pCtx->recCnt + 1) * sizeof(REMAP*));
 
-  pRec = (REMAP*)buffer;
+  pRec = (REMAP*)pCtx->buffer;
   pArr = pRtn;
   ctr = 0;
   while (pRec->next) {
@@ -2144,7 +3010,9 @@ REMAP** SetupPublicsSort(void)
   }
   *pArr = 0;
 
-  recCnt = ctr;
+  /* Copy() accounts for the array's release using the new count */
+  MEMADD(MEM_SORT, -(long)((pCtx->recCnt - ctr) * sizeof(REMAP*)));
+  pCtx->recCnt = ctr;
 
   return pRtn;
 }
@@ -2152,8 +3020,9 @@ REMAP** SetupPublicsSort(void)
 /*****************************************************************************/
 /* Print publics by name or value in the same format as the original file. */
 
-int     PrintPublics(REMAP** pr)
+int     PrintPublics(REMAPCTX * pCtx, REMAP** pr)
 {
+  int     cb;
   char *  p0;
   char *  p1;
   REMAP * r;
@@ -2164,29 +3033,26 @@ int     PrintPublics(REMAP** pr)
 
     switch (r->type & REMAP_TYPE) {
 
+      /* the name & its flag are padded together */
       case REMAP_IMP:
-        if (r->type & REMAP_ATTRMASK) {
-          strcpy(buf1, r->text);
-          strcat(buf1, DecodeFlagName(r->type));
-          p0 = buf1;
-        }
-        else
-          p0 = r->text;
+        p0 = DecodeFlagName(r->type);
         p1 = strchr(r->text, 0) + 1;
-        fprintf(fo, " %04lX:%08lX  Imp  %-20s (%s)\n",
-                r->seg, r->offs, p0, p1);
+        cb = strlen(r->text) + strlen(p0);
+        fprintf(pCtx->fo, " %04lX:%08lX  Imp  %s%s%*s (%s)\n",
+                r->seg, r->offs, r->text, p0, (cb < 20 ? 20 - cb : 0), "",
+                p1);
         break;
 
       case REMAP_OBJ:
         p0 = r->text;
-        fprintf(fo, " %04lX:%08lX  %s  %s%s\n",
+        fprintf(pCtx->fo, " %04lX:%08lX  %s  %s%s\n",
                 r->seg, r->offs,
                 ((r->type & REMAP_ABS) ? "Abs" : "   "),
                 p0, DecodeFlagName(r->type));
         break;
 
       default:
-        fprintf(fo, " %s\n", r->text);
+        fprintf(pCtx->fo, " %s\n", r->text);
         break;
     }
 
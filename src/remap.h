@@ -0,0 +1,451 @@
+/*****************************************************************************/
+/*  remap.h                                                                  */
+/*****************************************************************************/
+
+#ifndef _remap_h
+#define _remap_h
+
+/*****************************************************************************/
+/*  - used by remap.c & the other modules (remap_*.c)                        */
+/*  - os2.h & stdio.h must be #included first                                */
+/*****************************************************************************/
+
+#define HFILE_NONE      ((HFILE)-1)
+#define NULLCHAR        ((char)0)
+
+#define OPT_NO_DEMANGLE     0x01
+#define OPT_DEMANGLE_ONLY   0x02
+#define OPT_SHOW_ARGS       0x04
+#define OPT_WS              0x08
+#define OPT_WARNINGS        0x10
+#define OPT_GCC             0x20
+#define OPT_VAC             0x40
+#define OPT_XXC             0x80
+
+/* report modes - these read the map but don't reformat it */
+#define OPT_BUCKETS         0x0100
+#define OPT_PROFILE         0x0200
+#define OPT_LINKORDER       0x0400
+#define OPT_SIZES           0x0800
+#define OPT_DIFF            0x1000
+#define OPT_MODSIZES        0x2000
+#define OPT_TEMPLATES       0x4000
+#define OPT_XREF            0x8000
+#define OPT_REPORTS         0xFF00
+
+/* report modifiers */
+#define OPT_CSV             0x10000
+
+/* batch mode - list several maps concurrently, each to its own file */
+#define OPT_BATCH           0x20000
+
+/* phase timings & counters on stderr, as text or json */
+#define OPT_STATS           0x40000
+#define OPT_STATSJSON       0x80000
+
+/* time the functions that do most of the work, using the map as input */
+#define OPT_BENCH           0x100000
+#define OPT_BENCHDMGL       0x200000    /* compare the demanglers instead */
+
+/* predict the memory a listing will need without producing it */
+#define OPT_ESTIMATE        0x400000
+
+/* demangle names once, with their arguments, & keep them both ways */
+#define OPT_BOTHARGS        0x800000
+
+/* report modes that take a list of files after the map file */
+#define OPT_FILELIST        0x1700
+
+#define REMAP_END       0
+#define REMAP_GRP       0x0001
+#define REMAP_IMP       0x0002
+#define REMAP_SEG       0x0004
+#define REMAP_MOD       0x0008
+#define REMAP_EPT       0x0010
+#define REMAP_EXP       0x0020
+#define REMAP_OBJ       0x0040
+#define REMAP_ERR       0x0080
+#define REMAP_TYPE      0x00FF
+
+#define REMAP_ABS       0x0100
+
+#define REMAP_VTABLE    0x01000
+#define REMAP_THUNK     0x02000
+#define REMAP_TYPEINFO  0x04000
+#define REMAP_TYPENAME  0x08000
+#define REMAP_GUARD     0x10000
+#define REMAP_ATTRMASK  0x1F000
+
+/* the name with its arguments follows the record's other text - see
+   RecordArgs() */
+#define REMAP_ARGS      0x10000000
+
+/* the name hasn't been demangled yet - see RecordName() */
+#define REMAP_LAZY      0x20000000
+
+#define REMAP_DUP       0x40000000
+#define REMAP_DUP2      0x80000000
+
+#define REMAP_MASK      0x1F1FF
+
+/* segment numbers are 16 bits;  lines that couldn't be parsed are given
+   a higher one so they're listed last */
+#define SEG_MAX         0xFFFF
+#define SEG_ERR         0x10000
+
+/* the largest map that can be read into memory */
+#define CB_BUFMAX       0x7FFFFFFF
+
+/* the longest demangled name a record can hold, including the form with
+   its arguments;  a longer one is kept mangled */
+#define CB_MAXNAME      0x4000
+
+typedef struct _remap {
+    struct _remap*  next;
+    ULONG   type;
+    ULONG   seg;
+    ULONG   offs;
+    char    text[1];
+} REMAP;
+
+/* Everything needed to read one map & write its listing.  Batch mode
+   (-b) processes several maps at once, so each gets its own context;
+   the options & the demangler are shared by all of them.
+*/
+typedef struct _remapctx {
+    FILE *  fi;
+    FILE *  fo;
+    char *  buffer;     /* the records */
+    ULONG   cbBuffer;
+    char *  pCur;       /* where the next record goes */
+    int     recCnt;
+    struct _spill * pSpill;     /* set when --max-memory is in effect */
+    struct _stats * pStats;     /* set when --stats or --trace is used */
+    unsigned long long  cbMap;  /* size of the map file */
+    char    szMapName[CCHMAXPATH];
+    char    fIn[CCHMAXPATH];
+    char    fOut[CCHMAXPATH];
+    char    bufIn[1024];
+    char    buf1[1024];
+    char    szCacheHdr[CCHMAXPATH]; /* identifies the map in the cache */
+    int     fLazy;      /* publics & exports are demangled when used */
+} REMAPCTX;
+
+/*****************************************************************************/
+/*  remap_addr.c - publics, modules, & segments sorted by address           */
+/*****************************************************************************/
+
+typedef struct _addrtbl {
+    REMAP** ppSym;      /* publics & exports */
+    int     cSym;
+    REMAP** ppMod;      /* modules */
+    int     cMod;
+    REMAP** ppSeg;      /* segments */
+    int     cSeg;
+} ADDRTBL;
+
+int     BuildAddressTable(ADDRTBL * pTbl, char * pBuf);
+void    FreeAddressTable(ADDRTBL * pTbl);
+REMAP * FindByAddress(REMAP** ppArr, int cArr, ULONG seg, ULONG offs);
+REMAP * MergeFind(REMAP** ppArr, int cArr, int * pNdx,
+                  ULONG seg, ULONG offs);
+ULONG * InferSizes(ADDRTBL * pTbl);
+ULONG   RecordLength(REMAP * r);
+char *  StripArgs(char * pName, char * pOut, int cbOut);
+int     TemplateShape(char * pName, char * pOut, int cbOut);
+
+/*****************************************************************************/
+/*  remap_hash.c - string-keyed hash table                                   */
+/*****************************************************************************/
+
+typedef struct _hashent {
+    struct _hashent* next;
+    ULONG   hash;
+    char *  key;
+    void *  pv;         /* cbData bytes of zeroed, caller-defined data */
+} HASHENT;
+
+typedef struct _hashtbl {
+    HASHENT** ppSlot;
+    ULONG   cSlot;
+    ULONG   cEnt;
+    ULONG   cbData;
+} HASHTBL;
+
+int       HashInit(HASHTBL * pHash, ULONG cSlot, ULONG cbData);
+HASHENT * HashFind(HASHTBL * pHash, char * pKey, int fAdd);
+HASHENT** HashToArray(HASHTBL * pHash);
+void      HashFree(HASHTBL * pHash);
+ULONG     HashString(char * pKey);
+
+/*****************************************************************************/
+/*  remap_thrd.c - worker threads                                            */
+/*****************************************************************************/
+
+typedef void THREADPROC(void * pv);
+
+typedef struct _thrdarg {
+    THREADPROC* pfn;
+    void *      pv;
+} THRDARG;
+
+int     QueryThreadCount(void);
+int     RunThreads(THREADPROC * pfn, void * pv, int cThrd);
+int     StartThread(THRDARG * pArg, TID * pTid);
+
+/*****************************************************************************/
+/*  remap_cache.c - listings of unchanged maps                               */
+/*****************************************************************************/
+
+extern char *   pszCacheDir;
+extern ULONG    cCacheMB;
+
+int     CacheInit(void);
+int     CacheLookup(REMAPCTX * pCtx);
+void    CacheStore(REMAPCTX * pCtx);
+
+/*****************************************************************************/
+/*  remap_dmgl.c - demangler results kept between runs                       */
+/*****************************************************************************/
+
+/* an entry in the memo table used by Demangle() */
+typedef struct _dmglmemo {
+    ULONG   flags;
+    char *  pText;
+    ULONG   fNew;       /* pText was allocated during this run */
+} DMGLMEMO;
+
+/* where the demangler callback appends a name - see DmglInit() */
+typedef struct _dmglout {
+    char *  pBuf;
+    ULONG   cbBuf;
+    ULONG   cb;
+    ULONG   cbText;     /* cb without trailing whitespace */
+    ULONG   cbUsed;     /* the most of pBuf that's been written */
+    int     fKeepWS;    /* whitespace is replaced later, if at all */
+    int     fGrow;      /* pBuf may be replaced by pHeap */
+    int     fFull;      /* the name didn't fit */
+    char *  pHeap;
+} DMGLOUT;
+
+extern HASHTBL  hashDemangle;       /* remap.c */
+extern char *   pszDmglCache;
+extern ULONG    cDmglLookups;
+extern ULONG    cDmglHits;
+
+int     DmglCacheLoad(void);
+void    DmglCacheSave(void);
+void    DmglCacheFree(void);
+DMGLMEMO *  DemangleMemo(char * pIn);
+char *  RecordName(REMAP * r);
+ULONG   RecordType(REMAP * r);
+char *  RecordArgs(REMAP * r);
+ULONG   NameLength(char * pName, ULONG flags);
+char *  StoreNames(REMAPCTX * pCtx, REMAP * r, char * pName, char * pExt);
+
+/*****************************************************************************/
+/*  remap_spill.c - listings sorted in pieces to limit memory use            */
+/*****************************************************************************/
+
+extern ULONG    cMaxMemMB;
+
+int     SpillInit(REMAPCTX * pCtx, ULONG * pcbBuf);
+REMAP * NextRecord(REMAPCTX * pCtx);
+ULONG   RecordSpace(REMAPCTX * pCtx, REMAP * r);
+int     SpillRecords(REMAPCTX * pCtx);
+int     MergeByAddress(REMAPCTX * pCtx);
+int     MergeByName(REMAPCTX * pCtx);
+void    SpillFree(REMAPCTX * pCtx);
+
+/*****************************************************************************/
+/*  remap_stats.c - phase timings & counters                                 */
+/*****************************************************************************/
+
+#define PH_HEADER       0
+#define PH_SEGMENTS     1
+#define PH_GROUPS       2
+#define PH_EXPORTS      3
+#define PH_PUBLICS      4
+#define PH_DEMANGLE     5
+#define PH_DUPS         6
+#define PH_SPILL        7
+#define PH_SORTADDR     8
+#define PH_PRINTADDR    9
+#define PH_SORTNAME     10
+#define PH_PRINTNAME    11
+#define PH_TRAILER      12
+#define PH_COUNT        13
+
+typedef struct _phase {
+    ULONG   cCalls;
+    double  dWall;      /* milliseconds */
+    double  dCpu;
+    double  dWallStart;
+    double  dCpuStart;
+} PHASE;
+
+/* what memory is used for */
+#define MEM_RECORDS     0
+#define MEM_SORT        1       /* arrays of record pointers */
+#define MEM_IO          2       /* file & temporary-file buffers */
+#define MEM_STRINGS     3       /* demangled names & the demangle cache */
+#define MEM_HASH        4
+#define MEM_COUNT       5
+
+typedef struct _stats {
+    PHASE   aPhase[PH_COUNT];
+    ULONG   aRecs[8];   /* records of each REMAP_TYPE */
+    ULONG   cDemangle;
+    ULONG   cbPeak;     /* the most of the record buffer used */
+    double  dOpen;      /* when the map was opened */
+} STATS;
+
+/* without --stats or --trace, these only test a pointer */
+#define STATSBEGIN(pCtx, ph) \
+        ((pCtx)->pStats ? StatsBegin((pCtx)->pStats, (ph)) : (void)0)
+#define STATSEND(pCtx, ph) \
+        ((pCtx)->pStats ? StatsEnd((pCtx)->pStats, (ph)) : (void)0)
+
+/* memory is only counted with --stats;  cb is negative when it's freed */
+#define MEMADD(mem, cb) \
+        (fMemStats ? MemAdd((mem), (long)(cb)) : (void)0)
+
+extern int      fMemStats;
+
+void    StatsSetup(void);
+int     StatsInit(REMAPCTX * pCtx);
+void    StatsFree(REMAPCTX * pCtx);
+void    StatsBegin(STATS * pStats, int ph);
+void    StatsEnd(STATS * pStats, int ph);
+void    StatsRecords(REMAPCTX * pCtx);
+void    StatsPrint(REMAPCTX * pCtx);
+double  StatsNow(void);
+void    MemAdd(int mem, long cb);
+int     EstimateMemory(REMAPCTX * pCtx);
+char *  JsonString(char * pIn, char * pOut, int cbOut);
+
+/*****************************************************************************/
+/*  remap_trace.c - timeline of each thread's work                           */
+/*****************************************************************************/
+
+#define TRACE_DETAIL    1       /* a demangler call or wait */
+#define TRACE_COPY      2       /* the name has to be copied */
+
+extern char *   pszTraceFile;
+
+int     TraceInit(void);
+void    TraceSpan(char * pszName, double dStart, int flags);
+void    TraceWrite(void);
+
+/*****************************************************************************/
+/*  remap_pipe.c - publics parsed, demangled, & stored concurrently          */
+/*****************************************************************************/
+
+int     PipePublics(REMAPCTX * pCtx);
+
+/*****************************************************************************/
+/*  remap_bench.c - microbenchmarks                                          */
+/*****************************************************************************/
+
+int     MicroBench(REMAPCTX * pCtx);
+int     DemangleBench(REMAPCTX * pCtx);
+
+/*****************************************************************************/
+/*  report modes                                                             */
+/*****************************************************************************/
+
+int     CrashBuckets(REMAPCTX * pCtx);      /* remap_crash.c */
+int     FlatProfile(REMAPCTX * pCtx);       /* remap_prof.c */
+int     LinkOrder(REMAPCTX * pCtx);         /* remap_prof.c */
+int     SizeReport(REMAPCTX * pCtx);        /* remap_size.c */
+int     ModuleSizeReport(REMAPCTX * pCtx);  /* remap_size.c */
+int     TemplateReport(REMAPCTX * pCtx);    /* remap_size.c */
+int     CrossReference(REMAPCTX * pCtx);    /* remap_xref.c */
+int     MapDiff(REMAPCTX * pCtx);           /* remap_diff.c */
+
+/*****************************************************************************/
+/*  remap.c                                                                  */
+/*****************************************************************************/
+
+extern int      opts;
+extern char *   pszDemangler;
+extern ULONG    cThreads;
+extern ULONG    cFrames;
+extern ULONG    cTop;
+extern ULONG    ulBase;
+extern char **  apszFiles;
+extern int      cFiles;
+
+extern char *   pszWS;
+extern char *   pszTrouble;
+extern char     szModule[];
+extern int      cbModule;
+extern char     szImp[];
+extern int      cbImp;
+extern char     szAbs[];
+extern int      cbAbs;
+extern char *   apszModules[];
+extern char *   apszGroups[];
+extern char *   apszExports[];
+extern char *   apszPubByName[];
+extern char *   apszPubByValue[];
+extern char *   pszAddressHdr;
+extern char *   pszNameHdr;
+extern char *   pszColumnHdr;
+
+/* what the listing by address remembers from one entry to the next */
+typedef struct _liststate {
+    int     last;       /* the type of the last entry printed */
+    int     errhdr;
+} LISTSTATE;
+
+/* ClassifyName() - the demangler a name needs */
+#define NAME_PLAIN      0   /* not mangled, so it's used as-is */
+#define NAME_GCC        1
+#define NAME_GCCTYPE    2   /* a vtable or typeinfo - just its type */
+#define NAME_VAC        3
+#define NAME_XXC        4   /* the external demangler gets every name */
+
+int     MatchArray(char ** pArray, char * pText);
+char *  Trim(char * pTrim, char** ppNext);
+char *  TrimLine(char * pTrim);
+char *  DecodeFlagName(ULONG flags);
+int     Init(void);
+int     SetupNames(REMAPCTX * pCtx);
+int     OpenContext(REMAPCTX * pCtx);
+int     OpenMap(REMAPCTX * pCtx);
+void    CloseContext(REMAPCTX * pCtx);
+int     ProcessMap(REMAPCTX * pCtx);
+int     ReadMap(REMAPCTX * pCtx);
+int     ParseSegment(REMAPCTX * pCtx, char * pData,
+                     ULONG * pSeg, ULONG * pOffs);
+int     ParseModule(REMAPCTX * pCtx, char * pData, ULONG ulSeg, ULONG ulOffs);
+int     StorePublics(REMAPCTX * pCtx);
+int     StoreError(REMAPCTX * pCtx, char * pBuf, REMAP * r);
+char ** SeekToHdr(REMAPCTX * pCtx, char ** pSeek, char ** pStop);
+int     LoadVacDemangler(void);
+char *  Demangle(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags);
+char *  DemangleName(char * pIn, char * pOut, ULONG cbOut, ULONG * pFlags);
+int     ClassifyName(char * pIn, int * pSkip, ULONG * pFlags);
+void    FreeDemangleMemo(void);
+int     CompareAddress(REMAP * pk, REMAP * pe);
+int     AddressSorter(const void *key, const void *element);
+int     DuplicateSorter(const void *key, const void *element);
+int     NameSorter(const void *key, const void *element);
+int     CompareNames(char * pk, REMAP * rk, char * pe, REMAP * re);
+int     ImportSorter(char* pk, char* pe);
+void    PrintAddressEntry(REMAPCTX * pCtx, REMAP * r, REMAP * pNext,
+                          LISTSTATE * pState);
+void    PrintByName(REMAPCTX * pCtx, REMAP** pr);
+void    PrintNameEntry(REMAPCTX * pCtx, REMAP * r);
+void    PrintLegend(REMAPCTX * pCtx);
+
+/* exceptq.h only defines this when INCL_LOADEXCEPTQ is #defined */
+BOOL    LoadExceptq(EXCEPTIONREGISTRATIONRECORD* pExRegRec, char* pOpts);
+
+/*****************************************************************************/
+
+#endif /* _remap_h */
+
+/*****************************************************************************/
+
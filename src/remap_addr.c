@@ -0,0 +1,392 @@
+/*****************************************************************************/
+/*  remap_addr.c
+ *
+ *  Builds arrays of publics, modules, & segments sorted by address so the
+ *  report modes can map an address to the symbol, object module, and
+ *  segment that contain it.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+int     AddrSorter(const void *key, const void *element);
+
+char    szOperator[] = "operator";
+int     cbOperator = sizeof(szOperator) - 1;
+char    szAnonNS[] = "(anonymous namespace)";
+int     cbAnonNS = sizeof(szAnonNS) - 1;
+
+/*****************************************************************************/
+/* Collect the records in pBuf that have a usable address into 3 arrays,
+   then sort each of them.  Imports, absolute symbols, and duplicates are
+   omitted.
+*/
+
+int     BuildAddressTable(ADDRTBL * pTbl, char * pBuf)
+{
+  int     cSym = 0;
+  int     cMod = 0;
+  int     cSeg = 0;
+  REMAP * pRec;
+
+  memset(pTbl, 0, sizeof(ADDRTBL));
+
+  for (pRec = (REMAP*)pBuf; pRec->next; pRec = pRec->next) {
+    if (pRec->type & (REMAP_DUP2 | REMAP_ABS))
+      continue;
+
+    switch (pRec->type & REMAP_TYPE) {
+      case REMAP_OBJ:
+      case REMAP_EXP:
+        cSym++;
+        break;
+      case REMAP_MOD:
+        cMod++;
+        break;
+      case REMAP_SEG:
+        cSeg++;
+        break;
+    }
+  }
+
+  pTbl->ppSym = (REMAP**)malloc((cSym + cMod + cSeg + 3) * sizeof(REMAP*));
+  if (!pTbl->ppSym) {
+    fprintf(stderr, "malloc failed for BuildAddressTable - bytes= %d\n",
+            (cSym + cMod + cSeg + 3) * sizeof(REMAP*));
+    return 0;
+  }
+  pTbl->ppMod = &pTbl->ppSym[cSym + 1];
+  pTbl->ppSeg = &pTbl->ppMod[cMod + 1];
+
+  for (pRec = (REMAP*)pBuf; pRec->next; pRec = pRec->next) {
+    if (pRec->type & (REMAP_DUP2 | REMAP_ABS))
+      continue;
+
+    switch (pRec->type & REMAP_TYPE) {
+      case REMAP_OBJ:
+      case REMAP_EXP:
+        pTbl->ppSym[pTbl->cSym++] = pRec;
+        break;
+      case REMAP_MOD:
+        pTbl->ppMod[pTbl->cMod++] = pRec;
+        break;
+      case REMAP_SEG:
+        pTbl->ppSeg[pTbl->cSeg++] = pRec;
+        break;
+    }
+  }
+  pTbl->ppSym[pTbl->cSym] = 0;
+  pTbl->ppMod[pTbl->cMod] = 0;
+  pTbl->ppSeg[pTbl->cSeg] = 0;
+
+  qsort(pTbl->ppSym, pTbl->cSym, sizeof(REMAP*), AddrSorter);
+  qsort(pTbl->ppMod, pTbl->cMod, sizeof(REMAP*), AddrSorter);
+  qsort(pTbl->ppSeg, pTbl->cSeg, sizeof(REMAP*), AddrSorter);
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    FreeAddressTable(ADDRTBL * pTbl)
+{
+  if (pTbl->ppSym)
+    free(pTbl->ppSym);
+
+  memset(pTbl, 0, sizeof(ADDRTBL));
+
+  return;
+}
+
+/*****************************************************************************/
+/* Binary search for the last entry at or below seg:offs.  Entries in other
+   segments never match, so an address below the first symbol in its
+   segment returns null.
+*/
+
+REMAP * FindByAddress(REMAP** ppArr, int cArr, ULONG seg, ULONG offs)
+{
+  int     lo = 0;
+  int     hi = cArr;
+  int     mid;
+  REMAP * r;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    r = ppArr[mid];
+    if (r->seg < seg || (r->seg == seg && r->offs <= offs))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (!lo)
+    return 0;
+
+  r = ppArr[lo - 1];
+  if (r->seg != seg)
+    return 0;
+
+  return r;
+}
+
+/*****************************************************************************/
+/* Advance *pNdx past every entry at or below seg:offs, then return the
+   last of them if it's in the same segment.
+*/
+
+REMAP * MergeFind(REMAP** ppArr, int cArr, int * pNdx,
+                  ULONG seg, ULONG offs)
+{
+  REMAP * r;
+
+  while (*pNdx < cArr) {
+    r = ppArr[*pNdx];
+    if (r->seg > seg || (r->seg == seg && r->offs > offs))
+      break;
+    (*pNdx)++;
+  }
+
+  if (!*pNdx)
+    return 0;
+
+  r = ppArr[*pNdx - 1];
+  if (r->seg != seg)
+    return 0;
+
+  return r;
+}
+
+/*****************************************************************************/
+/* Infer each public's size from the address of the next public in the
+   same segment.  The size is bounded by the end of the public's module
+   (or its segment if it isn't in a module) so the last public in a module
+   doesn't absorb whatever follows it.  Publics that share an address all
+   get the same size.  The caller must free the array.
+*/
+
+ULONG * InferSizes(ADDRTBL * pTbl)
+{
+  int     ctr;
+  int     run;
+  int     iMod = 0;
+  int     iSeg = 0;
+  ULONG   end;
+  ULONG * pSize;
+  REMAP * r;
+  REMAP * pMod;
+  REMAP * pSeg;
+
+  pSize = (ULONG*)malloc((pTbl->cSym + 1) * sizeof(ULONG));
+  if (!pSize) {
+    fprintf(stderr, "malloc failed for InferSizes - bytes= %d\n",
+            (pTbl->cSym + 1) * sizeof(ULONG));
+    return 0;
+  }
+
+  for (ctr = 0; ctr < pTbl->cSym; ) {
+    r = pTbl->ppSym[ctr];
+
+    for (run = ctr + 1; run < pTbl->cSym; run++) {
+      if (pTbl->ppSym[run]->seg != r->seg ||
+          pTbl->ppSym[run]->offs != r->offs)
+        break;
+    }
+
+    pMod = MergeFind(pTbl->ppMod, pTbl->cMod, &iMod, r->seg, r->offs);
+    pSeg = MergeFind(pTbl->ppSeg, pTbl->cSeg, &iSeg, r->seg, r->offs);
+
+    if (pMod && r->offs - pMod->offs < RecordLength(pMod))
+      end = pMod->offs + RecordLength(pMod);
+    else
+    if (pSeg && r->offs - pSeg->offs < RecordLength(pSeg))
+      end = pSeg->offs + RecordLength(pSeg);
+    else
+      end = 0xFFFFFFFF;
+
+    if (run < pTbl->cSym && pTbl->ppSym[run]->seg == r->seg &&
+        pTbl->ppSym[run]->offs < end)
+      end = pTbl->ppSym[run]->offs;
+
+    /* with nothing to bound it, the size is unknown */
+    if (end == 0xFFFFFFFF)
+      end = r->offs;
+
+    while (ctr < run)
+      pSize[ctr++] = end - r->offs;
+  }
+
+  return pSize;
+}
+
+/*****************************************************************************/
+/* Segment & module records begin with their length as 5 hex digits. */
+
+ULONG   RecordLength(REMAP * r)
+{
+  if (!(r->type & (REMAP_SEG | REMAP_MOD)))
+    return 0;
+
+  return strtoul(r->text, 0, 16);
+}
+
+/*****************************************************************************/
+/* Copy a demangled name without its argument list, i.e. the way it's
+   displayed without the -a option.  Parentheses that are part of the name
+   (operator() & "(anonymous namespace)") or are nested inside template
+   arguments are kept.
+*/
+
+char *  StripArgs(char * pName, char * pOut, int cbOut)
+{
+  int     depth = 0;
+  char *  pDst = pOut;
+  char *  pMax = pOut + cbOut - 1;
+
+  while (*pName && pDst < pMax) {
+
+    if (!strncmp(pName, szAnonNS, cbAnonNS) && pDst + cbAnonNS < pMax) {
+      memcpy(pDst, pName, cbAnonNS);
+      pDst  += cbAnonNS;
+      pName += cbAnonNS;
+      continue;
+    }
+
+    /* copy an operator's name in one piece so its characters
+       don't affect the nesting depth */
+    if (!strncmp(pName, szOperator, cbOperator)) {
+      int   cnt = cbOperator;
+
+      if (pName[cnt] == '(' && pName[cnt + 1] == ')')
+        cnt += 2;
+      else
+        while (pName[cnt] && strchr("<>=!+-*/%^&|~[],", pName[cnt]))
+          cnt++;
+
+      if (pDst + cnt >= pMax)
+        break;
+      memcpy(pDst, pName, cnt);
+      pDst  += cnt;
+      pName += cnt;
+      continue;
+    }
+
+    if (*pName == '<')
+      depth++;
+    else
+    if (*pName == '>' && depth)
+      depth--;
+    else
+    if (*pName == '(' && !depth)
+      break;
+
+    *pDst++ = *pName++;
+  }
+
+  *pDst = 0;
+
+  return pOut;
+}
+
+/*****************************************************************************/
+/* Copy a demangled name without its arguments & with the contents of each
+   outermost template argument list removed, e.g. "ns::Tpl<int>::get(int)"
+   becomes "ns::Tpl<>::get".  This makes a single pass over the name.
+   Returns the number of template argument lists that were collapsed.
+*/
+
+int     TemplateShape(char * pName, char * pOut, int cbOut)
+{
+  int     depth = 0;
+  int     cnt = 0;
+  char *  pDst = pOut;
+  char *  pMax = pOut + cbOut - 1;
+
+  while (*pName && pDst < pMax) {
+
+    if (!strncmp(pName, szAnonNS, cbAnonNS)) {
+      if (!depth) {
+        if (pDst + cbAnonNS >= pMax)
+          break;
+        memcpy(pDst, pName, cbAnonNS);
+        pDst += cbAnonNS;
+      }
+      pName += cbAnonNS;
+      continue;
+    }
+
+    if (!strncmp(pName, szOperator, cbOperator)) {
+      int   op = cbOperator;
+
+      if (pName[op] == '(' && pName[op + 1] == ')')
+        op += 2;
+      else
+        while (pName[op] && strchr("<>=!+-*/%^&|~[],", pName[op]))
+          op++;
+
+      if (!depth) {
+        if (pDst + op >= pMax)
+          break;
+        memcpy(pDst, pName, op);
+        pDst += op;
+      }
+      pName += op;
+      continue;
+    }
+
+    if (*pName == '<') {
+      if (!depth++) {
+        *pDst++ = '<';
+        cnt++;
+      }
+    }
+    else
+    if (*pName == '>' && depth) {
+      if (!--depth)
+        *pDst++ = '>';
+    }
+    else
+    if (*pName == '(' && !depth)
+      break;
+    else
+    if (!depth)
+      *pDst++ = *pName;
+
+    pName++;
+  }
+
+  *pDst = 0;
+
+  return cnt;
+}
+
+/*****************************************************************************/
+/* qsort callback for sorting by address.  Exports sort ahead of the public
+   at the same address so that lookups return the public.
+*/
+
+int     AddrSorter(const void *key, const void *element)
+{
+  REMAP * pk = *(REMAP**)key;
+  REMAP * pe = *(REMAP**)element;
+
+  if (pk->seg != pe->seg)
+    return (pk->seg < pe->seg ? -1 : 1);
+
+  if (pk->offs != pe->offs)
+    return (pk->offs < pe->offs ? -1 : 1);
+
+  return (int)(pk->type & REMAP_TYPE) - (int)(pe->type & REMAP_TYPE);
+}
+
+/*****************************************************************************/
+
@@ -0,0 +1,830 @@
+/*****************************************************************************/
+/*  remap_bench.c
+ *
+ *  Microbenchmarks (--microbench).  The map named on the commandline is
+ *  the corpus:  its lines, segment & module rows, and public names are
+ *  fed to the functions that do most of remap's work, each one timed on
+ *  its own.  Each benchmark runs over the whole corpus repeatedly until
+ *  it has taken at least BENCH_MINMS.
+ *
+ *  The results are tab-separated:  a few '#' lines identify the corpus &
+ *  the demangler, then each benchmark's name, the operations it timed, &
+ *  the nanoseconds per operation.  The names & the format don't change,
+ *  so results from different builds can be compared line by line.
+ *
+ *  The timings include copying the input where a function modifies it;
+ *  the "copy" benchmark measures that alone.
+ *
+ *  --bench-demangle compares the demanglers on the map's mangled names:
+ *  the builtin GCC demangler, demangl.dll if it can be loaded, the
+ *  external one if -x named it, & the memo table once it holds every
+ *  name.  Each call is timed so the median & 99th percentile can be
+ *  reported along with the rate & the names that couldn't be demangled.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define BENCH_MINMS     250.0
+#define BENCH_MAXMS     (20 * BENCH_MINMS)  /* including any setup */
+#define BENCH_MAXROUNDS 100000
+#define CB_BENCHLINE    1024
+
+/* the timer's resolution is about a microsecond, so each name's latency
+   is taken over this many calls */
+#define BENCH_REPS      16
+
+/* name classes for the demangler benchmarks */
+#define NM_C            0
+#define NM_Z            1
+#define NM_UZ           2       /* with gcc's extra underscore */
+#define NM_VTABLE       3
+#define NM_THUNK        4
+#define NM_MOZ          5       /* with Mozilla's "$w$" suffix */
+#define NM_VAC          6       /* VAC's, which have a double underscore */
+#define NM_COUNT        7
+
+/* the map, split into lines & sorted into the parts the benchmarks use */
+typedef struct _corpus {
+    char *  pText;
+    char ** ppLine;
+    ULONG   cLine;
+    char ** ppSeg;      /* segment rows */
+    ULONG   cSeg;
+    char ** ppMod;      /* module rows, following "at offset " */
+    ULONG   cMod;
+    char ** appName[NM_COUNT];  /* names from the publics, by class */
+    ULONG   acName[NM_COUNT];
+    long    offPublics; /* where the first listing of publics begins */
+    REMAP** ppRec;      /* the records stored by StorePublics */
+    ULONG   cRec;
+    REMAP** ppImp;      /* those that are imports */
+    ULONG   cImp;
+} CORPUS;
+
+typedef ULONG BENCHPROC(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                        double * pdMs);
+
+int     LoadCorpus(REMAPCTX * pCtx, CORPUS * pCorp);
+void    FreeCorpus(CORPUS * pCorp);
+int     NameClass(char * pName);
+void    RunBench(REMAPCTX * pCtx, CORPUS * pCorp, char * pszName,
+                 BENCHPROC * pfn, void * pv);
+char *  DemanglerPath(void);
+
+BENCHPROC   BenchCopy;
+BENCHPROC   BenchTrim;
+BENCHPROC   BenchTrimLine;
+BENCHPROC   BenchMatchArray;
+BENCHPROC   BenchParseSegment;
+BENCHPROC   BenchParseModule;
+BENCHPROC   BenchStorePublics;
+BENCHPROC   BenchDemangle;
+BENCHPROC   BenchSorter;
+BENCHPROC   BenchImportSorter;
+
+int     ImportCompare(const void *key, const void *element);
+
+void    DemangleBenchPath(REMAPCTX * pCtx, char * pszPath, int fMemo,
+                          char ** ppName, ULONG cName, double * pdLat);
+int     DemangleFailed(char * pIn, char * pOut);
+int     LatencySorter(const void *key, const void *element);
+
+char *  apszNameClass[NM_COUNT] = {"c", "_Z", "__Z", "vtable", "thunk", "$w$",
+                                   "vac"};
+
+char    szBench[CB_BENCHLINE];
+char    szBenchOut[CB_BENCHLINE];
+
+/*****************************************************************************/
+/* Called by ProcessMap() */
+
+int     MicroBench(REMAPCTX * pCtx)
+{
+  int     ndx;
+  int     fNoDemangle = (opts & OPT_NO_DEMANGLE);
+  CORPUS  corp;
+  char    szName[64];
+
+  memset(&corp, 0, sizeof(corp));
+  if (!LoadCorpus(pCtx, &corp)) {
+    FreeCorpus(&corp);
+    return 0;
+  }
+
+  fprintf(pCtx->fo, "# remap microbench 1\n# corpus\t%s\n# demangler\t%s\n"
+          "# name\tops\tns_per_op\n", pCtx->fIn, DemanglerPath());
+
+  RunBench(pCtx, &corp, "copy", BenchCopy, 0);
+  RunBench(pCtx, &corp, "Trim", BenchTrim, 0);
+  RunBench(pCtx, &corp, "TrimLine", BenchTrimLine, 0);
+  RunBench(pCtx, &corp, "MatchArray", BenchMatchArray, 0);
+  RunBench(pCtx, &corp, "ParseSegment", BenchParseSegment, 0);
+  RunBench(pCtx, &corp, "ParseModule", BenchParseModule, 0);
+
+  opts |= OPT_NO_DEMANGLE;
+  RunBench(pCtx, &corp, "StorePublics/nodemangle", BenchStorePublics, 0);
+  if (!fNoDemangle) {
+    opts &= ~OPT_NO_DEMANGLE;
+    RunBench(pCtx, &corp, "StorePublics", BenchStorePublics, 0);
+
+    /* each name class, by the demangler itself, then from the memo
+       table once it holds every name */
+    for (ndx = 0; ndx < NM_COUNT; ndx++) {
+      sprintf(szName, "Demangle/%s/%s", DemanglerPath(), apszNameClass[ndx]);
+      RunBench(pCtx, &corp, szName, BenchDemangle, (void*)(ULONG)ndx);
+    }
+    if (hashDemangle.ppSlot ||
+        HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO))) {
+      for (ndx = 0; ndx < NM_COUNT; ndx++) {
+        sprintf(szName, "Demangle/memo/%s", apszNameClass[ndx]);
+        RunBench(pCtx, &corp, szName, BenchDemangle,
+                 (void*)(ULONG)(ndx + NM_COUNT));
+      }
+    }
+  }
+
+  RunBench(pCtx, &corp, "AddressSorter", BenchSorter, (void*)AddressSorter);
+  RunBench(pCtx, &corp, "NameSorter", BenchSorter, (void*)NameSorter);
+  RunBench(pCtx, &corp, "ImportSorter", BenchImportSorter, 0);
+
+  /* this marks duplicates as it goes, so it's last */
+  RunBench(pCtx, &corp, "DuplicateSorter", BenchSorter,
+           (void*)DuplicateSorter);
+
+  FreeCorpus(&corp);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Run a benchmark until it's taken long enough, then report it. */
+
+void    RunBench(REMAPCTX * pCtx, CORPUS * pCorp, char * pszName,
+                 BENCHPROC * pfn, void * pv)
+{
+  ULONG   cOps = 0;
+  ULONG   cRounds;
+  double  dMs = 0;
+  double  dStart = StatsNow();
+
+  for (cRounds = 0; dMs < BENCH_MINMS && cRounds < BENCH_MAXROUNDS &&
+       StatsNow() - dStart < BENCH_MAXMS; cRounds++) {
+    cOps += pfn(pCtx, pCorp, pv, &dMs);
+    if (!cOps)
+      break;
+  }
+
+  /* the map may have nothing for a benchmark to work on */
+  if (cOps)
+    fprintf(pCtx->fo, "%s\t%lu\t%.1f\n", pszName, cOps,
+            dMs * 1000000.0 / cOps);
+  else
+    fprintf(pCtx->fo, "%s\t0\t-\n", pszName);
+  fflush(pCtx->fo);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Read the map into memory & find the parts each benchmark needs. */
+
+int     LoadCorpus(REMAPCTX * pCtx, CORPUS * pCorp)
+{
+  int     state = 0;
+  int     ndx;
+  ULONG   cb;
+  ULONG   ctr;
+  char *  ptr;
+  char *  pNext;
+  char *  pName;
+
+  if (pCtx->cbMap > CB_BUFMAX / 4) {
+    fprintf(stderr, "'%s' is too large for a corpus\n", pCtx->fIn);
+    return 0;
+  }
+  cb = (ULONG)pCtx->cbMap;
+
+  /* the text is followed by room for a copy of the names */
+  pCorp->pText = (char*)malloc(2 * (cb + 1));
+  if (!pCorp->pText ||
+      fread(pCorp->pText, 1, cb, pCtx->fi) != cb) {
+    fprintf(stderr, "unable to read '%s'\n", pCtx->fIn);
+    return 0;
+  }
+  pCorp->pText[cb] = 0;
+  pName = pCorp->pText + cb + 1;
+
+  for (ctr = 1, ptr = pCorp->pText; (ptr = strchr(ptr, '\n')) != 0; ptr++)
+    ctr++;
+
+  /* one array holds all of the others */
+  pCorp->ppLine = (char**)malloc((3 + NM_COUNT) * ctr * sizeof(char*));
+  if (!pCorp->ppLine) {
+    fprintf(stderr, "malloc failed for corpus\n");
+    return 0;
+  }
+  pCorp->ppSeg = pCorp->ppLine + ctr;
+  pCorp->ppMod = pCorp->ppSeg + ctr;
+  for (ndx = 0; ndx < NM_COUNT; ndx++)
+    pCorp->appName[ndx] = pCorp->ppMod + (ndx + 1) * ctr;
+
+  for (ptr = pCorp->pText; ptr && *ptr; ptr = pNext) {
+    pNext = strchr(ptr, '\n');
+    if (pNext)
+      *pNext++ = 0;
+    if (pNext && pNext - ptr >= 2 && pNext[-2] == '\r')
+      pNext[-2] = 0;
+    if (strlen(ptr) >= CB_BENCHLINE)
+      continue;
+    pCorp->ppLine[pCorp->cLine++] = ptr;
+
+    ptr += strspn(ptr, pszWS);
+    if (!*ptr)
+      continue;
+
+    /* the segments & modules are listed between these headers */
+    if (state == 0) {
+      if (MatchArray(apszModules, ptr))
+        state = 1;
+      continue;
+    }
+    if (state == 1) {
+      if (strlen(ptr) > 23 && ptr[4] == ':' && ptr[13] == ' ' &&
+          ptr[23] == 'H')
+        pCorp->ppSeg[pCorp->cSeg++] = ptr;
+      else
+      if (!strncmp(ptr, szModule, cbModule))
+        pCorp->ppMod[pCorp->cMod++] = ptr + cbModule;
+      else
+      if (MatchArray(apszGroups, ptr))
+        state = 2;
+      continue;
+    }
+
+    /* StorePublics() starts on the line after this header */
+    if (MatchArray(apszPubByName, ptr)) {
+      if (!pCorp->offPublics && pNext)
+        pCorp->offPublics = pNext - pCorp->pText;
+      state = 3;
+      continue;
+    }
+    if (state != 3 || ptr[4] != ':')
+      continue;
+
+    /* a public's name follows its address & "Imp" or "Abs" */
+    ptr = strpbrk(ptr, pszWS);
+    if (!ptr)
+      continue;
+    ptr += strspn(ptr, pszWS);
+    if (!strncmp(ptr, szImp, cbImp) || !strncmp(ptr, szAbs, cbAbs)) {
+      ptr += 4;
+      ptr += strspn(ptr, pszWS);
+    }
+    cb = strcspn(ptr, pszWS);
+    if (!cb)
+      continue;
+
+    /* the lines are left intact, so the names are copied */
+    memcpy(pName, ptr, cb);
+    pName[cb] = 0;
+    ndx = NameClass(pName);
+    pCorp->appName[ndx][pCorp->acName[ndx]++] = pName;
+    pName += cb + 1;
+  }
+
+  if (!pCorp->offPublics) {
+    fprintf(stderr, "publics by name header not found in '%s'\n", pCtx->fIn);
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    FreeCorpus(CORPUS * pCorp)
+{
+  if (pCorp->pText)
+    free(pCorp->pText);
+  if (pCorp->ppLine)
+    free(pCorp->ppLine);
+  if (pCorp->ppRec)
+    free(pCorp->ppRec);
+  if (pCorp->ppImp)
+    free(pCorp->ppImp);
+  memset(pCorp, 0, sizeof(CORPUS));
+
+  return;
+}
+
+/*****************************************************************************/
+
+int     NameClass(char * pName)
+{
+  char *  ptr;
+
+  if (strstr(pName, pszTrouble))
+    return NM_MOZ;
+
+  ptr = pName + (pName[0] == '_' && pName[1] == '_');
+  if (strncmp(ptr, "_Z", 2))
+    return (strstr(pName, "__") ? NM_VAC : NM_C);
+  if (!strncmp(ptr, "_ZTV", 4))
+    return NM_VTABLE;
+  if (!strncmp(ptr, "_ZTh", 4) || !strncmp(ptr, "_ZTv", 4) ||
+      !strncmp(ptr, "_ZTc", 4))
+    return NM_THUNK;
+
+  return (ptr == pName ? NM_Z : NM_UZ);
+}
+
+/*****************************************************************************/
+
+char *  DemanglerPath(void)
+{
+  if (opts & OPT_NO_DEMANGLE)
+    return "none";
+  if (opts & OPT_XXC)
+    return "external";
+  if (opts & OPT_VAC)
+    return "vac";
+
+  return "gcc";
+}
+
+/*****************************************************************************/
+/*  the benchmarks                                                           */
+/*****************************************************************************/
+
+ULONG   BenchCopy(REMAPCTX * pCtx, CORPUS * pCorp, void * pv, double * pdMs)
+{
+  ULONG   ctr;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cLine; ctr++)
+    strcpy(szBench, pCorp->ppLine[ctr]);
+
+  *pdMs += StatsNow() - dStart;
+
+  return pCorp->cLine;
+}
+
+/*****************************************************************************/
+/* Split each line into words, as the parsers do. */
+
+ULONG   BenchTrim(REMAPCTX * pCtx, CORPUS * pCorp, void * pv, double * pdMs)
+{
+  ULONG   ctr;
+  char *  pNext;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cLine; ctr++) {
+    strcpy(szBench, pCorp->ppLine[ctr]);
+    pNext = szBench;
+    while (pNext)
+      Trim(pNext, &pNext);
+  }
+
+  *pdMs += StatsNow() - dStart;
+
+  return pCorp->cLine;
+}
+
+/*****************************************************************************/
+
+ULONG   BenchTrimLine(REMAPCTX * pCtx, CORPUS * pCorp, void * pv, double * pdMs)
+{
+  ULONG   ctr;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cLine; ctr++) {
+    strcpy(szBench, pCorp->ppLine[ctr]);
+    TrimLine(szBench);
+  }
+
+  *pdMs += StatsNow() - dStart;
+
+  return pCorp->cLine;
+}
+
+/*****************************************************************************/
+/* Most lines don't match, as when SeekToHdr() looks for a header. */
+
+ULONG   BenchMatchArray(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                        double * pdMs)
+{
+  ULONG   ctr;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cLine; ctr++)
+    MatchArray(apszPubByName, pCorp->ppLine[ctr]);
+
+  *pdMs += StatsNow() - dStart;
+
+  return pCorp->cLine;
+}
+
+/*****************************************************************************/
+/* Every record goes at the start of the buffer. */
+
+ULONG   BenchParseSegment(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                          double * pdMs)
+{
+  ULONG   ctr;
+  ULONG   seg;
+  ULONG   offs;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cSeg; ctr++) {
+    strcpy(szBench, pCorp->ppSeg[ctr]);
+    pCtx->pCur = pCtx->buffer;
+    ((REMAP*)pCtx->pCur)->type = 0;
+    ParseSegment(pCtx, szBench, &seg, &offs);
+  }
+
+  *pdMs += StatsNow() - dStart;
+
+  pCtx->pCur = pCtx->buffer;
+  pCtx->recCnt = 0;
+
+  return pCorp->cSeg;
+}
+
+/*****************************************************************************/
+
+ULONG   BenchParseModule(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                         double * pdMs)
+{
+  ULONG   ctr;
+  double  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->cMod; ctr++) {
+    strcpy(szBench, pCorp->ppMod[ctr]);
+    pCtx->pCur = pCtx->buffer;
+    ((REMAP*)pCtx->pCur)->type = 0;
+    ParseModule(pCtx, szBench, 1, 0);
+  }
+
+  *pdMs += StatsNow() - dStart;
+
+  pCtx->pCur = pCtx->buffer;
+  pCtx->recCnt = 0;
+
+  return pCorp->cMod;
+}
+
+/*****************************************************************************/
+/* Read both listings of publics from the map.  The records are kept for
+   the sorters.
+*/
+
+ULONG   BenchStorePublics(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                          double * pdMs)
+{
+  REMAP * r;
+  double  dStart;
+
+  memset(pCtx->buffer, 0, pCtx->pCur - pCtx->buffer + sizeof(REMAP));
+  pCtx->pCur = pCtx->buffer;
+  pCtx->recCnt = 0;
+  if (fseek(pCtx->fi, pCorp->offPublics, SEEK_SET))
+    return 0;
+
+  dStart = StatsNow();
+  if (!StorePublics(pCtx))
+    return 0;
+  *pdMs += StatsNow() - dStart;
+
+  if (pCorp->ppRec)
+    free(pCorp->ppRec);
+  if (pCorp->ppImp)
+    free(pCorp->ppImp);
+  pCorp->cRec = 0;
+  pCorp->cImp = 0;
+  pCorp->ppRec = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
+  pCorp->ppImp = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
+  if (pCorp->ppRec && pCorp->ppImp) {
+    for (r = (REMAP*)pCtx->buffer; r->next; r = r->next) {
+      pCorp->ppRec[pCorp->cRec++] = r;
+      if (r->type & REMAP_IMP)
+        pCorp->ppImp[pCorp->cImp++] = r;
+    }
+  }
+
+  return pCtx->recCnt;
+}
+
+/*****************************************************************************/
+/* pv is the name class;  classes past NM_COUNT go through Demangle() &
+   its memo table, which is filled before the timing starts.
+*/
+
+ULONG   BenchDemangle(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                      double * pdMs)
+{
+  int     ndx = (int)(ULONG)pv;
+  int     fMemo = (ndx >= NM_COUNT);
+  ULONG   ctr;
+  ULONG   flags;
+  char ** ppName;
+  double  dStart;
+
+  if (fMemo)
+    ndx -= NM_COUNT;
+  ppName = pCorp->appName[ndx];
+
+  if (fMemo && !*pdMs) {
+    for (ctr = 0; ctr < pCorp->acName[ndx]; ctr++) {
+      strcpy(szBench, ppName[ctr]);
+      flags = 0;
+      Demangle(szBench, szBenchOut, sizeof(szBenchOut), &flags);
+    }
+  }
+
+  dStart = StatsNow();
+
+  for (ctr = 0; ctr < pCorp->acName[ndx]; ctr++) {
+    strcpy(szBench, ppName[ctr]);
+    flags = 0;
+    if (fMemo)
+      Demangle(szBench, szBenchOut, sizeof(szBenchOut), &flags);
+    else
+      DemangleName(szBench, szBenchOut, sizeof(szBenchOut), &flags);
+  }
+
+  *pdMs += StatsNow() - dStart;
+
+  return pCorp->acName[ndx];
+}
+
+/*****************************************************************************/
+/* pv is the qsort callback;  each round sorts the records as stored. */
+
+ULONG   BenchSorter(REMAPCTX * pCtx, CORPUS * pCorp, void * pv, double * pdMs)
+{
+  REMAP** ppArr;
+  double  dStart;
+
+  if (!pCorp->cRec)
+    return 0;
+
+  ppArr = (REMAP**)malloc(pCorp->cRec * sizeof(REMAP*));
+  if (!ppArr)
+    return 0;
+  memcpy(ppArr, pCorp->ppRec, pCorp->cRec * sizeof(REMAP*));
+
+  dStart = StatsNow();
+  qsort(ppArr, pCorp->cRec, sizeof(REMAP*),
+        (int (*)(const void*, const void*))pv);
+  *pdMs += StatsNow() - dStart;
+
+  free(ppArr);
+
+  return pCorp->cRec;
+}
+
+/*****************************************************************************/
+/* Sort the imports by their import names. */
+
+ULONG   BenchImportSorter(REMAPCTX * pCtx, CORPUS * pCorp, void * pv,
+                          double * pdMs)
+{
+  REMAP** ppArr;
+  double  dStart;
+
+  if (!pCorp->cImp)
+    return 0;
+
+  ppArr = (REMAP**)malloc(pCorp->cImp * sizeof(REMAP*));
+  if (!ppArr)
+    return 0;
+  memcpy(ppArr, pCorp->ppImp, pCorp->cImp * sizeof(REMAP*));
+
+  dStart = StatsNow();
+  qsort(ppArr, pCorp->cImp, sizeof(REMAP*), ImportCompare);
+  *pdMs += StatsNow() - dStart;
+
+  free(ppArr);
+
+  return pCorp->cImp;
+}
+
+/*****************************************************************************/
+
+int     ImportCompare(const void *key, const void *element)
+{
+  return ImportSorter((*(REMAP**)key)->text, (*(REMAP**)element)->text);
+}
+
+/*****************************************************************************/
+/*  --bench-demangle                                                         */
+/*****************************************************************************/
+/* Called by ProcessMap() */
+
+int     DemangleBench(REMAPCTX * pCtx)
+{
+  int       ndx;
+  int       rtn = 0;
+  int       fVac;
+  int       fGcc;
+  int       kind;
+  int       saveOpts = opts;
+  ULONG     ctr;
+  ULONG     cName = 0;
+  ULONG     cVac;
+  char **   ppName = 0;
+  double *  pdLat = 0;
+  HASHTBL   hash;
+  CORPUS    corp;
+
+  memset(&corp, 0, sizeof(corp));
+  memset(&hash, 0, sizeof(hash));
+
+do {
+  if (opts & OPT_NO_DEMANGLE) {
+    fprintf(stderr, "--bench-demangle can't be used with -n\n");
+    break;
+  }
+
+  if (!LoadCorpus(pCtx, &corp))
+    break;
+
+  for (ndx = 0, ctr = 0; ndx < NM_COUNT; ndx++)
+    ctr += corp.acName[ndx];
+  ppName = (char**)malloc((ctr + 1) * sizeof(char*));
+  pdLat = (double*)malloc((ctr + 1) * sizeof(double));
+  if (!ppName || !pdLat || !HashInit(&hash, 0x10000, 0)) {
+    fprintf(stderr, "malloc failed for demangler benchmark\n");
+    break;
+  }
+
+  /* each mangled name is used once, though most are listed twice.  The
+     names are sorted the way -v sorts them:  VAC's first, then GCC's,
+     so each demangler is only given names it can demangle. */
+  opts = (saveOpts & ~(OPT_GCC | OPT_VAC | OPT_XXC)) | OPT_VAC;
+  for (fGcc = 0, cVac = 0; fGcc < 2; fGcc++) {
+    if (fGcc)
+      cVac = cName;
+    for (ndx = 0; ndx < NM_COUNT; ndx++) {
+      for (ctr = 0; ctr < corp.acName[ndx]; ctr++) {
+        kind = ClassifyName(corp.appName[ndx][ctr], 0, 0);
+        if ((fGcc ? (kind != NAME_GCC && kind != NAME_GCCTYPE) :
+                    kind != NAME_VAC))
+          continue;
+        if (HashFind(&hash, corp.appName[ndx][ctr], 1) && hash.cEnt > cName)
+          ppName[cName++] = corp.appName[ndx][ctr];
+      }
+    }
+  }
+
+  fprintf(pCtx->fo, "# remap demangler benchmark 1\n# corpus\t%s\n"
+          "# names\t%lu\n# path\tnames\tnames_per_sec\tp50_ns\tp99_ns"
+          "\tfailed_pct\n", pCtx->fIn, cName);
+
+  /* DemangleName() uses whichever demangler the options select */
+  opts = (saveOpts & ~(OPT_GCC | OPT_VAC | OPT_XXC)) | OPT_GCC;
+  DemangleBenchPath(pCtx, "gcc", 0, &ppName[cVac], cName - cVac, pdLat);
+
+  fVac = ((saveOpts & OPT_VAC) || LoadVacDemangler());
+  opts = (saveOpts & ~(OPT_GCC | OPT_VAC | OPT_XXC)) | OPT_VAC;
+  DemangleBenchPath(pCtx, "vac", 0, ppName, (fVac ? cVac : 0), pdLat);
+
+  /* the external demangler's scheme is unknown, so it gets every name */
+  opts = (saveOpts & ~(OPT_GCC | OPT_VAC | OPT_XXC)) | OPT_XXC;
+  DemangleBenchPath(pCtx, "external", 0, ppName,
+                    ((saveOpts & OPT_XXC) ? cName : 0), pdLat);
+
+  /* the memo table is filled using the demangler that was selected;
+     without -v or -x, that's only GCC's names */
+  opts = saveOpts;
+  if (!hashDemangle.ppSlot &&
+      !HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO)))
+    DemangleBenchPath(pCtx, "memo", 1, ppName, 0, pdLat);
+  else
+  if (opts & (OPT_VAC | OPT_XXC))
+    DemangleBenchPath(pCtx, "memo", 1, ppName, cName, pdLat);
+  else
+    DemangleBenchPath(pCtx, "memo", 1, &ppName[cVac], cName - cVac, pdLat);
+
+  rtn = 1;
+
+} while (0);
+
+  opts = saveOpts;
+  HashFree(&hash);
+  if (ppName)
+    free(ppName);
+  if (pdLat)
+    free(pdLat);
+  FreeCorpus(&corp);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Demangle every name, timing each one, until it's taken long enough.
+   The latencies & failures are those of the last pass.  A path that
+   isn't available is given no names & reported as such.
+*/
+
+void    DemangleBenchPath(REMAPCTX * pCtx, char * pszPath, int fMemo,
+                          char ** ppName, ULONG cName, double * pdLat)
+{
+  ULONG   ctr;
+  ULONG   cReps;
+  ULONG   cCalls = 0;
+  ULONG   cFailed = 0;
+  ULONG   flags;
+  char *  ptr;
+  double  dStart;
+  double  dMs = 0;
+
+  if (!cName) {
+    fprintf(pCtx->fo, "%s\t0\t-\t-\t-\t-\n", pszPath);
+    fflush(pCtx->fo);
+    return;
+  }
+
+  if (fMemo) {
+    for (ctr = 0; ctr < cName; ctr++) {
+      strcpy(szBench, ppName[ctr]);
+      flags = 0;
+      Demangle(szBench, szBenchOut, sizeof(szBenchOut), &flags);
+    }
+  }
+
+  while (dMs < BENCH_MINMS) {
+    cFailed = 0;
+    for (ctr = 0; ctr < cName; ctr++) {
+      dStart = StatsNow();
+      for (cReps = 0; cReps < BENCH_REPS; cReps++) {
+        strcpy(szBench, ppName[ctr]);
+        flags = 0;
+        if (fMemo)
+          ptr = Demangle(szBench, szBenchOut, sizeof(szBenchOut), &flags);
+        else
+          ptr = DemangleName(szBench, szBenchOut, sizeof(szBenchOut),
+                             &flags);
+      }
+      pdLat[ctr] = (StatsNow() - dStart) / BENCH_REPS;
+      dMs += pdLat[ctr] * BENCH_REPS;
+
+      if (DemangleFailed(szBench, ptr))
+        cFailed++;
+    }
+    cCalls += cName * BENCH_REPS;
+  }
+
+  qsort(pdLat, cName, sizeof(double), LatencySorter);
+
+  fprintf(pCtx->fo, "%s\t%lu\t%.0f\t%.0f\t%.0f\t%.2f\n", pszPath, cName,
+          cCalls * 1000.0 / dMs, pdLat[(cName - 1) / 2] * 1000000.0,
+          pdLat[(cName - 1) * 99 / 100] * 1000000.0,
+          cFailed * 100.0 / cName);
+  fflush(pCtx->fo);
+
+  return;
+}
+
+/*****************************************************************************/
+/* A name that can't be demangled comes back unchanged, though the line
+   read from an external demangler ends with whitespace (or underscores
+   when it's been replaced).
+*/
+
+int     DemangleFailed(char * pIn, char * pOut)
+{
+  int     cb = strlen(pIn);
+
+  if (!pOut || !*pOut)
+    return 1;
+  if (strncmp(pOut, pIn, cb))
+    return 0;
+
+  pOut += cb;
+
+  return (strspn(pOut, (opts & OPT_WS) ? pszWS : "_") == strlen(pOut));
+}
+
+/*****************************************************************************/
+
+int     LatencySorter(const void *key, const void *element)
+{
+  double  dk = *(double*)key;
+  double  de = *(double*)element;
+
+  return (dk < de ? -1 : (dk > de ? 1 : 0));
+}
+
+/*****************************************************************************/
+
@@ -0,0 +1,409 @@
+/*****************************************************************************/
+/*  remap_cache.c
+ *
+ *  Listing cache (--cache).  In an incremental build most maps don't
+ *  change, so the listing produced for a map is saved in a cache
+ *  directory along with a hash of the map & the options that produced
+ *  it.  When the same map is listed again with the same options, the
+ *  saved listing is used instead.  If the existing output file already
+ *  matches it, the file isn't touched at all.
+ *
+ *  Each entry is a file named for the hash of its header line.  The
+ *  header identifies the map & options;  the second line describes the
+ *  listing that follows.  The directory is kept under a size limit by
+ *  deleting the entries used least recently.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define CACHE_OPTS      (0x00FF | OPT_BOTHARGS) /* those that affect a listing */
+#define CACHE_BLOCK     0x10000
+#define CACHE_MB_DEFAULT 64
+
+/* an entry found when trimming the cache */
+typedef struct _cacheent {
+    ULONG   ulStamp;    /* date & time last used */
+    ULONG   cb;
+    char    szName[CCHMAXPATHCOMP];
+} CACHEENT;
+
+int     HashFile(char * pszFile, unsigned long long * pHash,
+                 unsigned long long * pcb);
+int     CopyListing(FILE * fpIn, char * pszOut, unsigned long long cbOut);
+void    TouchEntry(char * pszEntry);
+void    TrimCache(void);
+int     CacheEntSorter(const void *key, const void *element);
+
+char *  pszCacheDir = 0;
+ULONG   cCacheMB = CACHE_MB_DEFAULT;
+HMTX    hmtxCache = 0;
+
+char    szCacheTag[] = "remap-1.02-cache";
+char    szCacheExt[] = ".rmc";
+
+/*****************************************************************************/
+/* Confirm the cache directory exists & add a separator to its name. */
+
+int     CacheInit(void)
+{
+  int         cb;
+  char *      ptr;
+  FILESTATUS3 fs;
+
+  /* the report modes & --microbench aren't cached */
+  if (opts & (OPT_REPORTS | OPT_BENCH))
+    return 1;
+
+  if (DosQueryPathInfo(pszCacheDir, FIL_STANDARD, &fs, sizeof(fs)) ||
+      !(fs.attrFile & FILE_DIRECTORY)) {
+    fprintf(stderr, "cache directory '%s' not found\n", pszCacheDir);
+    return 0;
+  }
+
+  cb = strlen(pszCacheDir);
+  ptr = (char*)malloc(cb + 2);
+  if (!ptr) {
+    fprintf(stderr, "malloc failed for CacheInit\n");
+    return 0;
+  }
+  strcpy(ptr, pszCacheDir);
+  if (cb && ptr[cb - 1] != '\\' && ptr[cb - 1] != '/' && ptr[cb - 1] != ':')
+    strcpy(&ptr[cb], "\\");
+  pszCacheDir = ptr;
+
+  if (DosCreateMutexSem(0, &hmtxCache, 0, FALSE)) {
+    fprintf(stderr, "unable to initialize the cache\n");
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* If the cache has a listing for this map & these options, make sure the
+   output file matches it & return 1.  Otherwise, save the key so that
+   CacheStore() can add the listing once it's been produced.
+*/
+
+int     CacheLookup(REMAPCTX * pCtx)
+{
+  int     rtn = 0;
+  FILE *  fp;
+  unsigned long long  hash;
+  unsigned long long  hashOut;
+  unsigned long long  hashOld;
+  unsigned long long  cbMap;
+  unsigned long long  cbOut;
+  unsigned long long  cbOld;
+  char    szEntry[CCHMAXPATH];
+  char    szLine[CCHMAXPATH + 64];
+
+  *pCtx->szCacheHdr = 0;
+
+  if (!hmtxCache || (opts & (OPT_REPORTS | OPT_BENCH)))
+    return 0;
+
+  /* if anything's wrong with the names, let the normal path report it */
+  if (!SetupNames(pCtx) || !HashFile(pCtx->fIn, &hash, &cbMap))
+    return 0;
+
+  sprintf(pCtx->szCacheHdr, "%s %016llX %llu %02X %.200s\n",
+          szCacheTag, hash, cbMap, (opts & CACHE_OPTS),
+          ((opts & OPT_XXC) ? pszDemangler : "-"));
+  sprintf(szEntry, "%s%08lX%s", pszCacheDir,
+          HashString(pCtx->szCacheHdr), szCacheExt);
+
+  fp = fopen(szEntry, "rb");
+  if (!fp)
+    return 0;
+
+do {
+  if (!fgets(szLine, sizeof(szLine), fp) ||
+      strcmp(szLine, pCtx->szCacheHdr))
+    break;
+
+  if (!fgets(szLine, sizeof(szLine), fp) ||
+      sscanf(szLine, "%llX %llu", &hashOut, &cbOut) != 2)
+    break;
+
+  /* leave an identical output file alone so its timestamp doesn't
+     change;  otherwise, replace it with the saved listing */
+  if (HashFile(pCtx->fOut, &hashOld, &cbOld) &&
+      cbOld == cbOut && hashOld == hashOut)
+    rtn = 1;
+  else
+    rtn = CopyListing(fp, pCtx->fOut, cbOut);
+
+} while (0);
+
+  fclose(fp);
+
+  if (rtn)
+    TouchEntry(szEntry);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Save a newly-produced listing.  It's written to a temporary file first
+   so another process never sees a partial entry;  its name includes the
+   whole process & thread id, so two writers never share one.
+*/
+
+void    CacheStore(REMAPCTX * pCtx)
+{
+  int     ok = 0;
+  ULONG   cb;
+  FILE *  fpIn = 0;
+  FILE *  fpOut = 0;
+  PPIB    ppib;
+  PTIB    ptib;
+  char *  pBuf = 0;
+  unsigned long long  hashOut;
+  unsigned long long  cbOut;
+  char    szEntry[CCHMAXPATH];
+  char    szTemp[CCHMAXPATH];
+
+  if (!*pCtx->szCacheHdr)
+    return;
+
+  if (!HashFile(pCtx->fOut, &hashOut, &cbOut))
+    return;
+
+  DosGetInfoBlocks(&ptib, &ppib);
+  sprintf(szEntry, "%s%08lX%s", pszCacheDir,
+          HashString(pCtx->szCacheHdr), szCacheExt);
+  sprintf(szTemp, "%s%08lX.%lX.%lX", pszCacheDir,
+          HashString(pCtx->szCacheHdr), ppib->pib_ulpid,
+          ptib->tib_ptib2->tib2_ultid);
+
+do {
+  pBuf = (char*)malloc(CACHE_BLOCK);
+  fpIn = fopen(pCtx->fOut, "rb");
+  fpOut = fopen(szTemp, "wb");
+  if (!pBuf || !fpIn || !fpOut)
+    break;
+
+  fputs(pCtx->szCacheHdr, fpOut);
+  fprintf(fpOut, "%016llX %llu\n", hashOut, cbOut);
+
+  while ((cb = fread(pBuf, 1, CACHE_BLOCK, fpIn)) != 0) {
+    if (fwrite(pBuf, 1, cb, fpOut) != cb)
+      break;
+  }
+
+  ok = !ferror(fpIn) && !ferror(fpOut);
+
+} while (0);
+
+  if (fpIn)
+    fclose(fpIn);
+  if (fpOut && fclose(fpOut))
+    ok = 0;
+  if (pBuf)
+    free(pBuf);
+
+  if (ok) {
+    DosDelete(szEntry);
+    ok = !DosMove(szTemp, szEntry);
+  }
+  if (!ok) {
+    DosDelete(szTemp);
+    return;
+  }
+
+  TrimCache();
+
+  return;
+}
+
+/*****************************************************************************/
+/* A streamed 64-bit FNV-1a hash of a file's contents. */
+
+int     HashFile(char * pszFile, unsigned long long * pHash,
+                 unsigned long long * pcb)
+{
+  ULONG   cb;
+  ULONG   ctr;
+  FILE *  fp;
+  unsigned char *     pBuf;
+  unsigned long long  hash = 14695981039346656037ULL;
+
+  *pcb = 0;
+
+  fp = fopen(pszFile, "rb");
+  if (!fp)
+    return 0;
+
+  pBuf = (unsigned char*)malloc(CACHE_BLOCK);
+  if (!pBuf) {
+    fclose(fp);
+    return 0;
+  }
+
+  while ((cb = fread(pBuf, 1, CACHE_BLOCK, fp)) != 0) {
+    for (ctr = 0; ctr < cb; ctr++) {
+      hash ^= pBuf[ctr];
+      hash *= 1099511628211ULL;
+    }
+    *pcb += cb;
+  }
+
+  cb = ferror(fp);
+  free(pBuf);
+  fclose(fp);
+
+  *pHash = hash;
+  return !cb;
+}
+
+/*****************************************************************************/
+/* Copy the listing that follows an entry's header to the output file. */
+
+int     CopyListing(FILE * fpIn, char * pszOut, unsigned long long cbOut)
+{
+  ULONG   cb;
+  unsigned long long  cbDone = 0;
+  FILE *  fpOut;
+  char *  pBuf;
+
+  pBuf = (char*)malloc(CACHE_BLOCK);
+  if (!pBuf)
+    return 0;
+
+  fpOut = fopen(pszOut, "wb");
+  if (!fpOut) {
+    free(pBuf);
+    return 0;
+  }
+
+  while ((cb = fread(pBuf, 1, CACHE_BLOCK, fpIn)) != 0) {
+    if (fwrite(pBuf, 1, cb, fpOut) != cb)
+      break;
+    cbDone += cb;
+  }
+
+  free(pBuf);
+
+  /* a damaged entry just means the listing is produced again */
+  if (fclose(fpOut) || cbDone != cbOut)
+    return 0;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* The time an entry was last written is the time it was last used. */
+
+void    TouchEntry(char * pszEntry)
+{
+  FILESTATUS3 fs;
+  DATETIME    dt;
+
+  if (DosQueryPathInfo(pszEntry, FIL_STANDARD, &fs, sizeof(fs)))
+    return;
+
+  DosGetDateTime(&dt);
+  fs.fdateLastWrite.year    = dt.year - 1980;
+  fs.fdateLastWrite.month   = dt.month;
+  fs.fdateLastWrite.day     = dt.day;
+  fs.ftimeLastWrite.hours   = dt.hours;
+  fs.ftimeLastWrite.minutes = dt.minutes;
+  fs.ftimeLastWrite.twosecs = dt.seconds / 2;
+
+  DosSetPathInfo(pszEntry, FIL_STANDARD, &fs, sizeof(fs), 0);
+
+  return;
+}
+
+/*****************************************************************************/
+/* If the entries total more than the limit, delete the ones used least
+   recently.  In batch mode, only one thread at a time does this.
+*/
+
+void    TrimCache(void)
+{
+  int         cnt = 0;
+  int         cAlloc = 0;
+  int         ctr;
+  HDIR        hdir = HDIR_CREATE;
+  ULONG       cFound = 1;
+  ULONG       cbTotal = 0;
+  ULONG       cbMax;
+  CACHEENT *  pEnt = 0;
+  CACHEENT *  pNew;
+  FILEFINDBUF3 ffb;
+  char        szSpec[CCHMAXPATH];
+
+  cbMax = (cCacheMB >= 4096 ? 0xFFFFFFFF : cCacheMB << 20);
+
+  DosRequestMutexSem(hmtxCache, SEM_INDEFINITE_WAIT);
+
+  sprintf(szSpec, "%s*%s", pszCacheDir, szCacheExt);
+  if (!DosFindFirst(szSpec, &hdir, FILE_NORMAL | FILE_ARCHIVED,
+                    &ffb, sizeof(ffb), &cFound, FIL_STANDARD)) {
+    do {
+      if (cnt == cAlloc) {
+        cAlloc = (cAlloc ? 2 * cAlloc : 256);
+        pNew = (CACHEENT*)realloc(pEnt, cAlloc * sizeof(CACHEENT));
+        if (!pNew)
+          break;
+        pEnt = pNew;
+      }
+
+      pEnt[cnt].ulStamp = (*(USHORT*)&ffb.fdateLastWrite << 16) |
+                          *(USHORT*)&ffb.ftimeLastWrite;
+      pEnt[cnt].cb = ffb.cbFile;
+      strcpy(pEnt[cnt].szName, ffb.achName);
+      cbTotal += ffb.cbFile;
+      cnt++;
+      cFound = 1;
+    } while (!DosFindNext(hdir, &ffb, sizeof(ffb), &cFound));
+
+    DosFindClose(hdir);
+  }
+
+  if (cbTotal > cbMax && pEnt) {
+    qsort(pEnt, cnt, sizeof(CACHEENT), CacheEntSorter);
+
+    for (ctr = 0; ctr < cnt && cbTotal > cbMax; ctr++) {
+      sprintf(szSpec, "%s%s", pszCacheDir, pEnt[ctr].szName);
+      if (!DosDelete(szSpec))
+        cbTotal -= pEnt[ctr].cb;
+    }
+  }
+
+  DosReleaseMutexSem(hmtxCache);
+
+  if (pEnt)
+    free(pEnt);
+
+  return;
+}
+
+/*****************************************************************************/
+/* qsort callback:  least recently used first */
+
+int     CacheEntSorter(const void *key, const void *element)
+{
+  ULONG   kStamp = ((CACHEENT*)key)->ulStamp;
+  ULONG   eStamp = ((CACHEENT*)element)->ulStamp;
+
+  if (kStamp != eStamp)
+    return (kStamp < eStamp ? -1 : 1);
+
+  return 0;
+}
+
+/*****************************************************************************/
+
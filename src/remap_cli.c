@@ -0,0 +1,532 @@
+/*****************************************************************************/
+/*  remap_cli.c
+ *
+ *  Remap's commandline:  it parses the options, then hands each map to
+ *  the same code that libremap.lib is built from.  Batch mode (-b) lists
+ *  several maps at once, each in its own context.
+ *
+ *  The listings & reports use that code's internal entry points rather
+ *  than the RMAP API:  a listing copies the map's header & trailer as it
+ *  reads, & with --max-memory its records are sorted in pieces without
+ *  ever all being in memory - neither fits the API's model of a map
+ *  that's read, then queried.  Only the shutdown (RmapTerm()) is shared.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+#include "libremap.h"
+#include "exceptq.h"
+
+/*****************************************************************************/
+
+int     ParseArgs(int argc, char* argv[]);
+int     ParseLongArg(int argc, char* argv[], int * pCtr);
+int     RunBatch(void);
+void    BatchWorker(void * pv);
+int     BatchSorter(const void *key, const void *element);
+
+/*****************************************************************************/
+
+/* the map named on the commandline;  in batch mode, its name is
+   copied to the context of the first job */
+REMAPCTX  ctxMain;
+
+/* batch mode hands out the maps largest first, so a long job starts
+   early instead of being the last thing running */
+typedef struct _batchjob {
+    REMAPCTX ** ppCtx;
+    int     cCtx;
+    int     next;
+    int     cFailed;
+} BATCHJOB;
+
+/* long options:  'opt' is set when the option is present;  if 'pVal'
+   is supplied, the next argument is converted to a number & stored there;
+   if 'ppStr' is supplied, the next argument itself is stored there
+*/
+typedef struct _longopt {
+    char *  pszName;
+    int     opt;
+    ULONG * pVal;
+    char ** ppStr;
+} LONGOPT;
+
+LONGOPT aLongOpts[] = {
+    {"buckets",     OPT_BUCKETS,    0,          0},
+    {"profile",     OPT_PROFILE,    0,          0},
+    {"linkorder",   OPT_LINKORDER,  0,          0},
+    {"diff",        OPT_DIFF,       0,          0},
+    {"modsizes",    OPT_MODSIZES,   0,          0},
+    {"templates",   OPT_TEMPLATES,  0,          0},
+    {"xref",        OPT_XREF,       0,          0},
+    {"csv",         OPT_CSV,        0,          0},
+    {"sizes",       OPT_SIZES,      0,          0},
+    {"cache",       0,              0,          &pszCacheDir},
+    {"cachesize",   0,              &cCacheMB,  0},
+    {"dmglcache",   0,              0,          &pszDmglCache},
+    {"max-memory",  0,              &cMaxMemMB, 0},
+    {"stats",       OPT_STATS,      0,          0},
+    {"stats-json",  OPT_STATS | OPT_STATSJSON, 0, 0},
+    {"trace",       0,              0,          &pszTraceFile},
+    {"microbench",  OPT_BENCH,      0,          0},
+    {"bench-demangle", OPT_BENCH | OPT_BENCHDMGL, 0, 0},
+    {"dry-run-estimate", OPT_ESTIMATE, 0,       0},
+    {"both-args",   OPT_BOTHARGS,   0,          0},
+    {"base",        0,              &ulBase,    0},
+    {"frames",      0,              &cFrames,   0},
+    {"threads",     0,              &cThreads,  0},
+    {"top",         0,              &cTop,      0},
+    {0,             0,              0,          0}
+};
+
+/*****************************************************************************/
+
+char *  pszHelp =
+      "\n remap v1.02 - (C)2010  R L Walsh\n"
+        " Reformats and demangles IBM-style .map files.\n\n"
+        " Usage:  remap [-options] [optional_files] mapfile[.map]\n"
+        " General options:\n"
+        "   -a  show demangled method arguments\n"
+        "   -b  list several maps concurrently  (usage:  remap -b 1.map 2.map ...)\n"
+        "   -d  demangle only, don't reformat\n"
+        "   -n  don't demangle symbols\n"
+        "   -m  include linker warning messages (errors are always displayed)\n"
+        "   -o  specify output file             (default: *.remap or *.demap)\n"
+        "   -w  preserve whitespace in symbols  (default: replace with undersores)\n"
+        "   --both-args    list names both with & without their arguments\n"
+        "   --cache dir    reuse the listings of unchanged maps saved in dir\n"
+        "   --cachesize n  limit the cache to n megabytes (default: 64)\n"
+        "   --dmglcache f  keep demangled names in file f for later runs\n"
+        "   --max-memory n sort large listings in n MB using temporary files\n"
+        "   --stats        show the time taken by each step & other counts\n"
+        "   --stats-json   the same, written as json\n"
+        "   --trace f      write a timeline of each thread's work to file f\n"
+        "   --microbench   time remap's main functions using the map as input\n"
+        "   --bench-demangle  compare the demanglers on the map's names\n"
+        "   --dry-run-estimate  predict the memory needed to list the map\n"
+        " Demangler options:\n"
+        "   -g  use builtin GCC demangler       (default)\n"
+        "   -v  use VAC demangler               (requires demangl.dll)\n"
+        "   -x  use specified demangler         (example: \"myfilt.exe -z -n yyy\")\n"
+        " Report options (output goes to stdout unless -o is used):\n"
+        "   --buckets    group exceptq trap reports by crash signature\n"
+        "                (usage:  remap --buckets mapfile report.trp ...)\n"
+        "   --profile    flat profile of sampled program counters\n"
+        "                (usage:  remap --profile mapfile samples.txt ...)\n"
+        "   --linkorder  list the sampled functions, hottest first, for the linker\n"
+        "                (usage:  remap --linkorder mapfile samples.txt ...)\n"
+        "   --sizes      largest functions, data, object modules, and libraries\n"
+        "                (shows the top 20 of each unless --top is used)\n"
+        "   --diff       list the symbols & modules that changed between builds\n"
+        "                (usage:  remap --diff old.map new.map)\n"
+        "   --modsizes   code, data, & bss bytes per library and object module\n"
+        "   --templates  instances & bytes per template, ignoring its arguments\n"
+        "   --xref       unresolved imports & unused exports across many maps\n"
+        "                (usage:  remap --xref directory_or_mapfile ...)\n"
+        "   --base n     linear address of segment 1    (default: 0x10000)\n"
+        "   --csv        write comma-separated values   (--modsizes only)\n"
+        "   --frames n   frames in a crash signature    (default: 5)\n"
+        "   --threads n  worker threads                 (default: one per cpu)\n"
+        "   --top n      limit report to the top n rows (default: all;  --sizes: 20)\n"
+        "\n";
+
+/*****************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  EXCEPTIONREGISTRATIONRECORD ExRegRec;
+  int     xq;
+  int     rtn = 1;
+
+  xq = LoadExceptq(&ExRegRec, 0);
+
+  /* expand response files & wildcards - the report modes may be
+     given more files than will fit on a commandline */
+  _response(&argc, &argv);
+  _wildcard(&argc, &argv);
+
+  if (!ParseArgs(argc, argv)) {
+    if (xq)
+      UninstallExceptq(&ExRegRec);
+    return 1;
+  }
+
+do {
+  if (!Init()) {
+    fprintf(stderr, "Init failed\n");
+    break;
+  }
+
+  if (opts & OPT_BATCH) {
+    rtn = (RunBatch() ? 0 : 1);
+    break;
+  }
+
+  /* this only reads as far as the publics */
+  if (opts & OPT_ESTIMATE) {
+    rtn = (EstimateMemory(&ctxMain) ? 0 : 1);
+    break;
+  }
+
+  /* an unchanged map's listing may already be in the cache */
+  if (CacheLookup(&ctxMain)) {
+    rtn = 0;
+    break;
+  }
+
+  if (!OpenContext(&ctxMain)) {
+    fprintf(stderr, "Init failed\n");
+    break;
+  }
+
+  if (!ProcessMap(&ctxMain))
+    break;
+
+  StatsPrint(&ctxMain);
+  CloseContext(&ctxMain);
+  CacheStore(&ctxMain);
+  rtn = 0;
+
+} while (0);
+
+  /* general cleanup */
+  CloseContext(&ctxMain);
+  TraceWrite();
+  if (apszFiles)
+    free(apszFiles);
+  RmapTerm();
+
+  if (xq)
+    UninstallExceptq(&ExRegRec);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* This lets options & files be specified on the commandline in almost any
+   order.  The only restriction is that optional files be specified in the
+   same order as the options that required them.
+*/
+
+int     ParseArgs(int argc, char* argv[])
+{
+  int     ctr;
+  int     order = 99;
+  int     needInfile = 1;
+  int     needOutfile = 0;
+  int     needDemangler = 0;
+  char *  ptr;
+
+  if (argc < 2) {
+    fprintf(stderr, pszHelp);
+    return 0;
+  }
+
+  apszFiles = (char**)malloc(argc * sizeof(char*));
+  if (!apszFiles) {
+    fprintf(stderr, "malloc failed for file list\n");
+    return 0;
+  }
+
+  for (ctr = 1; ctr < argc; ctr++) {
+
+    if (argv[ctr][0] == '-' && argv[ctr][1] == '-') {
+      if (!ParseLongArg(argc, argv, &ctr))
+        return 0;
+      continue;
+    }
+
+    if (*argv[ctr] == '-' || *argv[ctr] == '/') {
+      ptr = argv[ctr];
+
+      while (*(++ptr)) {
+        switch(*ptr) {
+          case 'a':
+          case 'A':
+            opts |= OPT_SHOW_ARGS;
+            break;
+
+          case 'b':
+          case 'B':
+            opts |= OPT_BATCH;
+            break;
+
+          case 'd':
+          case 'D':
+            opts |= OPT_DEMANGLE_ONLY;
+            break;
+
+          case 'm':
+          case 'M':
+            opts |= OPT_WARNINGS;
+            break;
+
+          case 'w':
+          case 'W':
+            opts |= OPT_WS;
+            break;
+
+          case 'n':
+          case 'N':
+            opts |= OPT_NO_DEMANGLE;
+            break;
+
+          case 'g':
+          case 'G':
+            opts &= ~OPT_VAC;
+            opts |= OPT_GCC;
+            break;
+
+          case 'v':
+          case 'V':
+            opts &= ~OPT_GCC;
+            opts |= OPT_VAC;
+            break;
+
+          case 'o':
+          case 'O':
+            needOutfile = order--;
+            break;
+
+          case 'x':
+          case 'X':
+            opts |= OPT_XXC;
+            needDemangler = order--;
+            break;
+        } /* switch */
+      } /* while */
+
+      continue;
+    } /* if */
+
+    if (needDemangler && needDemangler > needOutfile) {
+      pszDemangler = strdup(argv[ctr]);
+      needDemangler = 0;
+    } else
+    if (needOutfile && needOutfile > needDemangler) {
+      strcpy(ctxMain.fOut, argv[ctr]);
+      needOutfile = 0;
+    } else
+    if (needInfile) {
+      strcpy(ctxMain.fIn, argv[ctr]);
+      needInfile = 0;
+    } else
+      apszFiles[cFiles++] = argv[ctr];
+  } /* for */
+
+  /* each map in a batch gets a listing named after it */
+  if (opts & OPT_BATCH) {
+    if (opts & (OPT_REPORTS | OPT_BENCH | OPT_ESTIMATE)) {
+      fprintf(stderr, "-b can't be used with the report options\n");
+      return 0;
+    }
+    if (needOutfile || *ctxMain.fOut) {
+      fprintf(stderr, "-b can't be used with -o\n");
+      return 0;
+    }
+  }
+
+  /* only the report modes that take a list of files accept extras;
+     --xref & -b treat them as more maps */
+  if (cFiles && !(opts & (OPT_FILELIST | OPT_XREF | OPT_BATCH))) {
+    fprintf(stderr, "extra argument '%s'\n", apszFiles[0]);
+    return 0;
+  }
+
+  if ((opts & OPT_FILELIST) && !cFiles) {
+    fprintf(stderr, "no files to process\n");
+    return 0;
+  }
+
+  if ((opts & OPT_DIFF) && cFiles > 1) {
+    fprintf(stderr, "extra argument '%s'\n", apszFiles[1]);
+    return 0;
+  }
+
+  if (needInfile || needOutfile || needDemangler) {
+    fprintf(stderr, "missing argument for %s\n",
+            (needInfile ? "map file" :
+             (needOutfile ? "output file" : "demangler program")));
+    return 0;
+  }
+
+  if (!(opts & (OPT_GCC | OPT_VAC | OPT_XXC)))
+    opts |= OPT_GCC;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Long options select the report modes & their parameters.  Unlike the
+   single-letter options, an option that needs a value takes it from the
+   next argument.
+*/
+
+int     ParseLongArg(int argc, char* argv[], int * pCtr)
+{
+  LONGOPT * pOpt;
+  char *    pEnd;
+
+  for (pOpt = aLongOpts; pOpt->pszName; pOpt++) {
+    if (!stricmp(&argv[*pCtr][2], pOpt->pszName))
+      break;
+  }
+
+  if (!pOpt->pszName) {
+    fprintf(stderr, "unknown option '%s'\n", argv[*pCtr]);
+    return 0;
+  }
+
+  opts |= pOpt->opt;
+
+  if (pOpt->ppStr) {
+    if (++(*pCtr) >= argc) {
+      fprintf(stderr, "missing value for %s\n", argv[*pCtr - 1]);
+      return 0;
+    }
+    *pOpt->ppStr = argv[*pCtr];
+  }
+
+  if (pOpt->pVal) {
+    if (++(*pCtr) >= argc) {
+      fprintf(stderr, "missing value for %s\n", argv[*pCtr - 1]);
+      return 0;
+    }
+
+    *pOpt->pVal = strtoul(argv[*pCtr], &pEnd, 0);
+    if (*pEnd || *argv[*pCtr] == '-') {
+      fprintf(stderr, "invalid value for %s - '%s'\n",
+              argv[*pCtr - 1], argv[*pCtr]);
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Batch mode:  every map on the commandline gets the listing it would get
+   on its own.  The workers claim maps largest first, so the biggest map
+   isn't left to run by itself after the small ones are done.
+*/
+
+int     RunBatch(void)
+{
+  int       ctr;
+  int       ndx;
+  int       rtn = 0;
+  BATCHJOB  job;
+
+  memset(&job, 0, sizeof(job));
+  job.cCtx = cFiles + 1;
+
+do {
+  job.ppCtx = (REMAPCTX**)calloc(job.cCtx, sizeof(REMAPCTX*));
+  if (!job.ppCtx) {
+    fprintf(stderr, "malloc failed for batch\n");
+    break;
+  }
+
+  for (ctr = 0; ctr < job.cCtx; ctr++) {
+    job.ppCtx[ctr] = (REMAPCTX*)calloc(1, sizeof(REMAPCTX));
+    if (!job.ppCtx[ctr]) {
+      fprintf(stderr, "malloc failed for batch\n");
+      break;
+    }
+    strcpy(job.ppCtx[ctr]->fIn, (ctr ? apszFiles[ctr - 1] : ctxMain.fIn));
+    if (!SetupNames(job.ppCtx[ctr]))
+      break;
+  }
+  if (ctr < job.cCtx)
+    break;
+
+  /* the listings are written to the current directory, so maps with
+     the same name in different directories would overwrite each other */
+  for (ctr = 1; ctr < job.cCtx; ctr++) {
+    for (ndx = 0; ndx < ctr; ndx++) {
+      if (!stricmp(job.ppCtx[ctr]->fOut, job.ppCtx[ndx]->fOut))
+        break;
+    }
+    if (ndx < ctr) {
+      fprintf(stderr, "'%s' and '%s' would both be listed in '%s'\n",
+              job.ppCtx[ndx]->fIn, job.ppCtx[ctr]->fIn, job.ppCtx[ctr]->fOut);
+      break;
+    }
+  }
+  if (ctr < job.cCtx)
+    break;
+
+  qsort(job.ppCtx, job.cCtx, sizeof(REMAPCTX*), BatchSorter);
+
+  RunThreads(BatchWorker, &job, QueryThreadCount());
+
+  rtn = (job.cFailed == 0);
+
+} while (0);
+
+  if (job.ppCtx) {
+    for (ctr = 0; ctr < job.cCtx; ctr++) {
+      if (job.ppCtx[ctr])
+        free(job.ppCtx[ctr]);
+    }
+    free(job.ppCtx);
+  }
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Each worker claims the next map until none are left.  A map is
+   closed as soon as it's done so its buffer doesn't outlive the job.
+*/
+
+void    BatchWorker(void * pv)
+{
+  int       ndx;
+  REMAPCTX* pCtx;
+  BATCHJOB* pJob = (BATCHJOB*)pv;
+
+  while ((ndx = __sync_fetch_and_add(&pJob->next, 1)) < pJob->cCtx) {
+    pCtx = pJob->ppCtx[ndx];
+
+    if (CacheLookup(pCtx))
+      continue;
+
+    if (!OpenContext(pCtx) || !ProcessMap(pCtx)) {
+      fprintf(stderr, "unable to process '%s'\n", pCtx->fIn);
+      __sync_fetch_and_add(&pJob->cFailed, 1);
+      CloseContext(pCtx);
+      continue;
+    }
+
+    StatsPrint(pCtx);
+    CloseContext(pCtx);
+    CacheStore(pCtx);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* qsort callback for ordering batch jobs, largest map first */
+
+int     BatchSorter(const void *key, const void *element)
+{
+  unsigned long long  kSize = (*(REMAPCTX**)key)->cbMap;
+  unsigned long long  eSize = (*(REMAPCTX**)element)->cbMap;
+
+  if (kSize != eSize)
+    return (kSize > eSize ? -1 : 1);
+
+  return 0;
+}
+
+/*****************************************************************************/
+
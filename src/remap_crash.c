@@ -0,0 +1,340 @@
+/*****************************************************************************/
+/*  remap_crash.c
+ *
+ *  Crash bucketing (--buckets).  Reads a corpus of exceptq trap reports,
+ *  resolves the top frames of each report's call stack against the map,
+ *  and counts the reports that share the same signature.
+ *
+ *  A signature is the list of the top frames' names:  demangled without
+ *  arguments for frames in the module the map describes, or just the
+ *  module name for frames elsewhere.  Reports are parsed on several
+ *  threads;  each thread reads one report at a time and stops reading
+ *  once it has the frames it needs, so memory use depends only on the
+ *  number of distinct signatures.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define MAX_FRAMES      32
+#define CB_SIG          2048
+
+typedef struct _frame {
+    char    szMod[16];
+    ULONG   obj;
+    ULONG   offs;
+} FRAME;
+
+typedef struct _bucket {
+    ULONG   cnt;
+    char *  pExample;       /* the first report with this signature */
+} BUCKET;
+
+typedef struct _crashjob {
+    ADDRTBL tbl;
+    HASHTBL hash;
+    HMTX    hmtx;
+    char *  pszMapName;     /* the module the map describes */
+    int     next;           /* index of the next report to process */
+    ULONG   cBucketed;
+    ULONG   cNoStack;
+    ULONG   cUnreadable;
+} CRASHJOB;
+
+void    CrashWorker(void * pv);
+int     ReadCallStack(FILE * fp, char * pLine, int cbLine,
+                      FRAME * pFrame, int cMax);
+int     ParseFrame(char * pLine, FRAME * pFrame);
+int     IsMapModule(CRASHJOB * pJob, char * pMod);
+char *  FrameName(CRASHJOB * pJob, FRAME * pFrame, char * pOut, int cbOut);
+int     BucketSorter(const void *key, const void *element);
+
+char *  apszCallStack[] = {"Call Stack", ""};
+char    szSigSep[] = " <- ";
+int     cbSigSep = sizeof(szSigSep) - 1;
+
+/*****************************************************************************/
+
+int     CrashBuckets(REMAPCTX * pCtx)
+{
+  int       ctr;
+  int       cnt;
+  ULONG     cReports;
+  BUCKET *  pb;
+  HASHENT** ppArr;
+  CRASHJOB  job;
+
+  memset(&job, 0, sizeof(job));
+  job.pszMapName = pCtx->szMapName;
+
+  if (!cFrames)
+    cFrames = 1;
+  if (cFrames > MAX_FRAMES)
+    cFrames = MAX_FRAMES;
+
+  if (!BuildAddressTable(&job.tbl, pCtx->buffer))
+    return 0;
+
+  if (!HashInit(&job.hash, 1024, sizeof(BUCKET)) ||
+      DosCreateMutexSem(0, &job.hmtx, 0, FALSE)) {
+    fprintf(stderr, "unable to initialize crash buckets\n");
+    FreeAddressTable(&job.tbl);
+    return 0;
+  }
+
+  RunThreads(CrashWorker, &job, QueryThreadCount());
+
+  DosCloseMutexSem(job.hmtx);
+
+  ppArr = HashToArray(&job.hash);
+  if (!ppArr) {
+    HashFree(&job.hash);
+    FreeAddressTable(&job.tbl);
+    return 0;
+  }
+  cnt = (int)job.hash.cEnt;
+  qsort(ppArr, cnt, sizeof(HASHENT*), BucketSorter);
+
+  cReports = job.cBucketed + job.cNoStack + job.cUnreadable;
+  fprintf(pCtx->fo, "\n Crash buckets for %s\n\n",
+          (*pCtx->szMapName ? pCtx->szMapName : "?"));
+  fprintf(pCtx->fo, " %lu reports:  %lu bucketed,  %lu without a call stack,"
+                    "  %lu unreadable\n", cReports,
+              job.cBucketed, job.cNoStack, job.cUnreadable);
+  fprintf(pCtx->fo, " %d buckets, signatures use the top %lu frames\n\n",
+          cnt, cFrames);
+  fprintf(pCtx->fo, "   Reports       %%  Signature\n"
+                    "  --------  ------  ------------------------\n");
+
+  for (ctr = 0; ctr < cnt; ctr++) {
+    pb = (BUCKET*)ppArr[ctr]->pv;
+    fprintf(pCtx->fo, "  %8lu  %6.2f  %s\n", pb->cnt,
+            (job.cBucketed ? (pb->cnt * 100.0) / job.cBucketed : 0.0),
+            ppArr[ctr]->key);
+    fprintf(pCtx->fo, "                    e.g. %s\n", pb->pExample);
+  }
+  fputs("\n", pCtx->fo);
+
+  free(ppArr);
+  HashFree(&job.hash);
+  FreeAddressTable(&job.tbl);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Each worker claims the next unprocessed report until none are left.
+   Only the bucket update is serialized.
+*/
+
+void    CrashWorker(void * pv)
+{
+  int       ndx;
+  int       cnt;
+  int       ctr;
+  char *    pSig;
+  FILE *    fp;
+  HASHENT * pEnt;
+  BUCKET *  pb;
+  CRASHJOB* pJob = (CRASHJOB*)pv;
+  FRAME     aFrame[MAX_FRAMES];
+  char      szLine[1024];
+  char      szName[512];
+  char      szSig[CB_SIG];
+
+  while ((ndx = __sync_fetch_and_add(&pJob->next, 1)) < cFiles) {
+
+    fp = fopen(apszFiles[ndx], "r");
+    if (!fp) {
+      fprintf(stderr, "unable to open trap report '%s'\n", apszFiles[ndx]);
+      __sync_fetch_and_add(&pJob->cUnreadable, 1);
+      continue;
+    }
+
+    cnt = ReadCallStack(fp, szLine, sizeof(szLine),
+                        aFrame, (int)cFrames);
+    fclose(fp);
+
+    if (!cnt) {
+      __sync_fetch_and_add(&pJob->cNoStack, 1);
+      continue;
+    }
+
+    /* build the signature, truncating it if it gets too long */
+    pSig = szSig;
+    *pSig = 0;
+    for (ctr = 0; ctr < cnt; ctr++) {
+      FrameName(pJob, &aFrame[ctr], szName, sizeof(szName));
+      if ((pSig - szSig) + cbSigSep + strlen(szName) >= sizeof(szSig))
+        break;
+      if (ctr) {
+        memcpy(pSig, szSigSep, cbSigSep);
+        pSig += cbSigSep;
+      }
+      strcpy(pSig, szName);
+      pSig = strchr(pSig, 0);
+    }
+
+    DosRequestMutexSem(pJob->hmtx, SEM_INDEFINITE_WAIT);
+    pEnt = HashFind(&pJob->hash, szSig, 1);
+    if (pEnt) {
+      pb = (BUCKET*)pEnt->pv;
+      if (!pb->cnt)
+        pb->pExample = apszFiles[ndx];
+      pb->cnt++;
+      pJob->cBucketed++;
+    }
+    DosReleaseMutexSem(pJob->hmtx);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Read the trapping thread's call stack from an exceptq report.  Reading
+   stops at the end of the first "Call Stack" section or when enough
+   frames have been collected.
+*/
+
+int     ReadCallStack(FILE * fp, char * pLine, int cbLine,
+                      FRAME * pFrame, int cMax)
+{
+  int     cnt = 0;
+  int     inStack = 0;
+  char *  ptr;
+
+  while (cnt < cMax && fgets(pLine, cbLine, fp)) {
+
+    ptr = pLine + strspn(pLine, pszWS);
+
+    if (!inStack) {
+      if (MatchArray(apszCallStack, ptr))
+        inStack = 1;
+      continue;
+    }
+
+    /* a blank line or separator that follows the frames ends the section */
+    if (!*ptr || *ptr == '_') {
+      if (cnt)
+        break;
+      continue;
+    }
+
+    if (ParseFrame(ptr, &pFrame[cnt]))
+      cnt++;
+  }
+
+  return cnt;
+}
+
+/*****************************************************************************/
+/* A frame is identified by an "obj:offset" field (4 + 8 hex digits);
+   the word in front of it is the module name.  Lines without one (the
+   column headings & labels) are ignored.
+*/
+
+int     ParseFrame(char * pLine, FRAME * pFrame)
+{
+  int     ctr;
+  char *  pPrev = 0;
+  char *  pWord;
+  char *  pNext;
+
+  for (pWord = Trim(pLine, &pNext); pWord; pWord = Trim(pNext, &pNext)) {
+
+    if (strlen(pWord) == 13 && pWord[4] == ':' && pPrev) {
+      for (ctr = 0; ctr < 13; ctr++) {
+        if (ctr != 4 && !isxdigit(pWord[ctr]))
+          break;
+      }
+
+      if (ctr == 13) {
+        strncpy(pFrame->szMod, pPrev, sizeof(pFrame->szMod) - 1);
+        pFrame->szMod[sizeof(pFrame->szMod) - 1] = 0;
+        pFrame->obj  = strtoul(pWord, 0, 16);
+        pFrame->offs = strtoul(&pWord[5], 0, 16);
+        return 1;
+      }
+    }
+
+    pPrev = pWord;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************/
+/* Exceptq truncates module names to 8 characters. */
+
+int     IsMapModule(CRASHJOB * pJob, char * pMod)
+{
+  if (!*pJob->pszMapName)
+    return 1;
+
+  if (strlen(pMod) >= 8)
+    return !strnicmp(pMod, pJob->pszMapName, 8);
+
+  return !stricmp(pMod, pJob->pszMapName);
+}
+
+/*****************************************************************************/
+/* Name a frame by the public that contains it.  If that public belongs to
+   an earlier object module (i.e. the address is in a static function),
+   use the module's source name instead.
+*/
+
+char *  FrameName(CRASHJOB * pJob, FRAME * pFrame, char * pOut, int cbOut)
+{
+  REMAP * pSym;
+  REMAP * pMod;
+
+  if (!IsMapModule(pJob, pFrame->szMod)) {
+    strcpy(pOut, pFrame->szMod);
+    return pOut;
+  }
+
+  pSym = FindByAddress(pJob->tbl.ppSym, pJob->tbl.cSym,
+                       pFrame->obj, pFrame->offs);
+  pMod = FindByAddress(pJob->tbl.ppMod, pJob->tbl.cMod,
+                       pFrame->obj, pFrame->offs);
+
+  if (pSym && (!pMod || pSym->offs >= pMod->offs))
+    return StripArgs(RecordName(pSym), pOut, cbOut);
+
+  if (pMod) {
+    sprintf(pOut, "[%.*s]", cbOut - 3, strchr(pMod->text, 0) + 1);
+    return pOut;
+  }
+
+  sprintf(pOut, "%s!%04lX:%08lX", pFrame->szMod, pFrame->obj, pFrame->offs);
+  return pOut;
+}
+
+/*****************************************************************************/
+/* qsort callback:  most reports first, then by signature */
+
+int     BucketSorter(const void *key, const void *element)
+{
+  HASHENT * pk = *(HASHENT**)key;
+  HASHENT * pe = *(HASHENT**)element;
+  ULONG     kCnt = ((BUCKET*)pk->pv)->cnt;
+  ULONG     eCnt = ((BUCKET*)pe->pv)->cnt;
+
+  if (kCnt != eCnt)
+    return (kCnt > eCnt ? -1 : 1);
+
+  return strcmp(pk->key, pe->key);
+}
+
+/*****************************************************************************/
+
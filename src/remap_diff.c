@@ -0,0 +1,514 @@
+/*****************************************************************************/
+/*  remap_diff.c
+ *
+ *  Map comparison (--diff).  Reads the map from an old build & the map
+ *  from a new one, then lists the publics & object modules that were
+ *  added, removed, resized, or moved.
+ *
+ *  Symbols are matched by their demangled name (plus a suffix for vtables,
+ *  thunks, etc.) rather than by address, so a change in one function
+ *  doesn't make everything after it look different.  Names that occur
+ *  more than once (statics, or overloads when arguments aren't shown) are
+ *  compared as a group.  Each section of the report is written as it's
+ *  generated by a single pass over one map's address-sorted publics.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define CB_DIFFKEY      1280
+
+/* a name or module found in either map */
+typedef struct _diffent {
+    REMAP * pOld;       /* the first instance in each map */
+    REMAP * pNew;
+    ULONG   cOld;       /* the number of instances */
+    ULONG   cNew;
+    ULONG   cbOld;      /* the total size of the instances */
+    ULONG   cbNew;
+    int     fDone;
+} DIFFENT;
+
+typedef struct _diffmap {
+    char *  pBuf;
+    ADDRTBL tbl;
+    ULONG * pSize;
+    ULONG   cbSym;
+    ULONG   cbMod;
+    char    szName[CCHMAXPATH];
+} DIFFMAP;
+
+typedef struct _diffcnt {
+    ULONG   cRemoved;
+    ULONG   cAdded;
+    ULONG   cResized;
+    ULONG   cMoved;
+    ULONG   cSame;
+} DIFFCNT;
+
+typedef struct _diffjob {
+    FILE *  fo;
+    REMAPCTX* apCtx[2]; /* the old & new maps while they're being read */
+    int     next;
+    int     cRead;
+    DIFFMAP mapOld;
+    DIFFMAP mapNew;
+    HASHTBL hashSym;
+    HASHTBL hashMod;
+    DIFFCNT sym;
+    DIFFCNT mod;
+} DIFFJOB;
+
+void    DiffReader(void * pv);
+int     SetupDiffMap(DIFFMAP * pMap);
+int     JoinSymbols(DIFFJOB * pJob, DIFFMAP * pMap, int fNew);
+int     JoinModules(DIFFJOB * pJob, DIFFMAP * pMap, int fNew);
+void    PrintSymbolDiffs(DIFFJOB * pJob);
+void    PrintModuleDiffs(DIFFJOB * pJob);
+char *  SymbolKey(REMAP * r, char * pKey);
+char *  ModuleKey(REMAP * r, char * pKey);
+char *  InstanceCount(DIFFENT * pEnt, char * pOut);
+void    PrintDiffCounts(DIFFJOB * pJob, char * pszTitle, DIFFCNT * pCnt);
+
+char *  pszDiffAddrHdr =
+        "    Seg:Offset         Bytes  Name\n"
+        "   -------------  ----------  ------------------------\n";
+
+char *  pszDiffSizeHdr =
+        "    Old Bytes   New Bytes       Delta  Name\n"
+        "   ----------  ----------  ----------  ------------------------\n";
+
+char *  pszDiffMoveHdr =
+        "   Old Address    New Address    Name\n"
+        "   -------------  -------------  ------------------------\n";
+
+/*****************************************************************************/
+/* The map named first on the commandline is the old one & has already
+   been opened;  the new one gets a context of its own.  Both are read
+   at the same time.
+*/
+
+int     MapDiff(REMAPCTX * pCtx)
+{
+  int       rtn = 0;
+  DIFFJOB   job;
+  REMAPCTX  ctxNew;
+
+  memset(&job, 0, sizeof(job));
+  memset(&ctxNew, 0, sizeof(ctxNew));
+  job.fo = pCtx->fo;
+  job.apCtx[0] = pCtx;
+  job.apCtx[1] = &ctxNew;
+  strcpy(ctxNew.fIn, apszFiles[0]);
+
+do {
+  if (!OpenMap(&ctxNew))
+    break;
+
+  RunThreads(DiffReader, &job, (QueryThreadCount() > 1 ? 2 : 1));
+  if (job.cRead != 2)
+    break;
+
+  job.mapOld.pBuf = pCtx->buffer;
+  strcpy(job.mapOld.szName, (*pCtx->szMapName ? pCtx->szMapName : "?"));
+  job.mapNew.pBuf = ctxNew.buffer;
+  strcpy(job.mapNew.szName, (*ctxNew.szMapName ? ctxNew.szMapName : "?"));
+
+  if (!SetupDiffMap(&job.mapOld) ||
+      !SetupDiffMap(&job.mapNew))
+    break;
+
+  if (!HashInit(&job.hashSym, job.mapOld.tbl.cSym, sizeof(DIFFENT)) ||
+      !HashInit(&job.hashMod, job.mapOld.tbl.cMod, sizeof(DIFFENT)))
+    break;
+
+  if (!JoinSymbols(&job, &job.mapOld, 0) ||
+      !JoinSymbols(&job, &job.mapNew, 1) ||
+      !JoinModules(&job, &job.mapOld, 0) ||
+      !JoinModules(&job, &job.mapNew, 1)) {
+    fprintf(stderr, "unable to match the symbols in the two maps\n");
+    break;
+  }
+
+  fprintf(pCtx->fo, "\n Differences between %s (old) and %s (new)\n",
+          job.mapOld.szName, job.mapNew.szName);
+
+  PrintSymbolDiffs(&job);
+  PrintModuleDiffs(&job);
+
+  fprintf(pCtx->fo, "\n Summary\n\n");
+  PrintDiffCounts(&job, "publics", &job.sym);
+  PrintDiffCounts(&job, "modules", &job.mod);
+  fprintf(pCtx->fo, "\n   public bytes:  %10lu old  %10lu new  %+11ld\n",
+          job.mapOld.cbSym, job.mapNew.cbSym,
+          (long)(job.mapNew.cbSym - job.mapOld.cbSym));
+  fprintf(pCtx->fo, "   module bytes:  %10lu old  %10lu new  %+11ld\n\n",
+          job.mapOld.cbMod, job.mapNew.cbMod,
+          (long)(job.mapNew.cbMod - job.mapOld.cbMod));
+
+  rtn = 1;
+
+} while (0);
+
+  HashFree(&job.hashSym);
+  HashFree(&job.hashMod);
+
+  if (job.mapOld.pSize)
+    free(job.mapOld.pSize);
+  FreeAddressTable(&job.mapOld.tbl);
+
+  if (job.mapNew.pSize)
+    free(job.mapNew.pSize);
+  FreeAddressTable(&job.mapNew.tbl);
+  CloseContext(&ctxNew);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Each reader claims one of the maps;  with a single thread, it reads
+   both.  The demangler's memo table is shared, so a name in both maps
+   is only demangled once.
+*/
+
+void    DiffReader(void * pv)
+{
+  int       ndx;
+  DIFFJOB * pJob = (DIFFJOB*)pv;
+
+  while ((ndx = __sync_fetch_and_add(&pJob->next, 1)) < 2) {
+    if (ReadMap(pJob->apCtx[ndx]))
+      __sync_fetch_and_add(&pJob->cRead, 1);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Sort a map's records by address & infer the size of its publics. */
+
+int     SetupDiffMap(DIFFMAP * pMap)
+{
+  int     ctr;
+
+  if (!BuildAddressTable(&pMap->tbl, pMap->pBuf))
+    return 0;
+
+  pMap->pSize = InferSizes(&pMap->tbl);
+  if (!pMap->pSize)
+    return 0;
+
+  for (ctr = 0; ctr < pMap->tbl.cSym; ctr++) {
+    if (pMap->tbl.ppSym[ctr]->type & REMAP_OBJ)
+      pMap->cbSym += pMap->pSize[ctr];
+  }
+
+  for (ctr = 0; ctr < pMap->tbl.cMod; ctr++)
+    pMap->cbMod += RecordLength(pMap->tbl.ppMod[ctr]);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Add a map's publics to the table.  Exports are skipped since they
+   duplicate the publics they alias.
+*/
+
+int     JoinSymbols(DIFFJOB * pJob, DIFFMAP * pMap, int fNew)
+{
+  int       ctr;
+  REMAP *   r;
+  HASHENT * pEnt;
+  DIFFENT * pd;
+  char      szKey[CB_DIFFKEY];
+
+  for (ctr = 0; ctr < pMap->tbl.cSym; ctr++) {
+    r = pMap->tbl.ppSym[ctr];
+    if (!(r->type & REMAP_OBJ))
+      continue;
+
+    pEnt = HashFind(&pJob->hashSym, SymbolKey(r, szKey), 1);
+    if (!pEnt)
+      return 0;
+
+    pd = (DIFFENT*)pEnt->pv;
+    if (fNew) {
+      if (!pd->cNew++)
+        pd->pNew = r;
+      pd->cbNew += pMap->pSize[ctr];
+    }
+    else {
+      if (!pd->cOld++)
+        pd->pOld = r;
+      pd->cbOld += pMap->pSize[ctr];
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* An object module that contributes to several segments is treated as
+   one item whose size is the total of its contributions.
+*/
+
+int     JoinModules(DIFFJOB * pJob, DIFFMAP * pMap, int fNew)
+{
+  int       ctr;
+  REMAP *   r;
+  HASHENT * pEnt;
+  DIFFENT * pd;
+  char      szKey[CB_DIFFKEY];
+
+  for (ctr = 0; ctr < pMap->tbl.cMod; ctr++) {
+    r = pMap->tbl.ppMod[ctr];
+
+    pEnt = HashFind(&pJob->hashMod, ModuleKey(r, szKey), 1);
+    if (!pEnt)
+      return 0;
+
+    pd = (DIFFENT*)pEnt->pv;
+    if (fNew) {
+      if (!pd->cNew++)
+        pd->pNew = r;
+      pd->cbNew += RecordLength(r);
+    }
+    else {
+      if (!pd->cOld++)
+        pd->pOld = r;
+      pd->cbOld += RecordLength(r);
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Removed publics are listed in the old map's order, everything else in
+   the new map's order.  A name is only considered to have moved if it
+   occurs once in each map.  The counts are of names, not instances;  a
+   name that both moved & changed size is counted as both.
+*/
+
+void    PrintSymbolDiffs(DIFFJOB * pJob)
+{
+  int       ctr;
+  REMAP *   r;
+  DIFFENT * pd;
+  DIFFMAP * pOld = &pJob->mapOld;
+  DIFFMAP * pNew = &pJob->mapNew;
+  char      szKey[CB_DIFFKEY];
+  char      szCnt[32];
+
+  fprintf(pJob->fo, "\n Removed publics\n\n%s", pszDiffAddrHdr);
+  for (ctr = 0; ctr < pOld->tbl.cSym; ctr++) {
+    r = pOld->tbl.ppSym[ctr];
+    if (!(r->type & REMAP_OBJ))
+      continue;
+
+    pd = (DIFFENT*)HashFind(&pJob->hashSym, SymbolKey(r, szKey), 0)->pv;
+    if (!pd->cNew) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %10lu  %s\n",
+              r->seg, r->offs, pOld->pSize[ctr], szKey);
+      if (pd->pOld == r)
+        pJob->sym.cRemoved++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Added publics\n\n%s", pszDiffAddrHdr);
+  for (ctr = 0; ctr < pNew->tbl.cSym; ctr++) {
+    r = pNew->tbl.ppSym[ctr];
+    if (!(r->type & REMAP_OBJ))
+      continue;
+
+    pd = (DIFFENT*)HashFind(&pJob->hashSym, SymbolKey(r, szKey), 0)->pv;
+    if (!pd->cOld) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %10lu  %s\n",
+              r->seg, r->offs, pNew->pSize[ctr], szKey);
+      if (pd->pNew == r)
+        pJob->sym.cAdded++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Resized publics\n\n%s", pszDiffSizeHdr);
+  for (ctr = 0; ctr < pNew->tbl.cSym; ctr++) {
+    r = pNew->tbl.ppSym[ctr];
+    if (!(r->type & REMAP_OBJ))
+      continue;
+
+    pd = (DIFFENT*)HashFind(&pJob->hashSym, SymbolKey(r, szKey), 0)->pv;
+    if (pd->fDone || !pd->cOld)
+      continue;
+    pd->fDone = 1;
+
+    if (pd->cbOld != pd->cbNew || pd->cOld != pd->cNew) {
+      fprintf(pJob->fo, "   %10lu  %10lu  %+10ld  %s%s\n",
+              pd->cbOld, pd->cbNew, (long)(pd->cbNew - pd->cbOld),
+              szKey, InstanceCount(pd, szCnt));
+      pJob->sym.cResized++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Moved publics\n\n%s", pszDiffMoveHdr);
+  for (ctr = 0; ctr < pNew->tbl.cSym; ctr++) {
+    r = pNew->tbl.ppSym[ctr];
+    if (!(r->type & REMAP_OBJ))
+      continue;
+
+    pd = (DIFFENT*)HashFind(&pJob->hashSym, SymbolKey(r, szKey), 0)->pv;
+    if (pd->fDone != 1)
+      continue;
+    pd->fDone = 2;
+
+    if (pd->cOld == 1 && pd->cNew == 1 &&
+        (pd->pOld->seg != r->seg || pd->pOld->offs != r->offs)) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %04lX:%08lX  %s\n",
+              pd->pOld->seg, pd->pOld->offs, r->seg, r->offs, szKey);
+      pJob->sym.cMoved++;
+    }
+    else
+    if (pd->cbOld == pd->cbNew && pd->cOld == pd->cNew)
+      pJob->sym.cSame++;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Same as above, for object modules. */
+
+void    PrintModuleDiffs(DIFFJOB * pJob)
+{
+  int       ctr;
+  REMAP *   r;
+  DIFFENT * pd;
+  DIFFMAP * pOld = &pJob->mapOld;
+  DIFFMAP * pNew = &pJob->mapNew;
+  char      szKey[CB_DIFFKEY];
+  char      szCnt[32];
+
+  fprintf(pJob->fo, "\n Removed modules\n\n%s", pszDiffAddrHdr);
+  for (ctr = 0; ctr < pOld->tbl.cMod; ctr++) {
+    r = pOld->tbl.ppMod[ctr];
+    pd = (DIFFENT*)HashFind(&pJob->hashMod, ModuleKey(r, szKey), 0)->pv;
+    if (!pd->cNew) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %10lu  %s\n",
+              r->seg, r->offs, RecordLength(r), szKey);
+      if (pd->pOld == r)
+        pJob->mod.cRemoved++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Added modules\n\n%s", pszDiffAddrHdr);
+  for (ctr = 0; ctr < pNew->tbl.cMod; ctr++) {
+    r = pNew->tbl.ppMod[ctr];
+    pd = (DIFFENT*)HashFind(&pJob->hashMod, ModuleKey(r, szKey), 0)->pv;
+    if (!pd->cOld) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %10lu  %s\n",
+              r->seg, r->offs, RecordLength(r), szKey);
+      if (pd->pNew == r)
+        pJob->mod.cAdded++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Resized modules\n\n%s", pszDiffSizeHdr);
+  for (ctr = 0; ctr < pNew->tbl.cMod; ctr++) {
+    r = pNew->tbl.ppMod[ctr];
+    pd = (DIFFENT*)HashFind(&pJob->hashMod, ModuleKey(r, szKey), 0)->pv;
+    if (pd->fDone || !pd->cOld)
+      continue;
+    pd->fDone = 1;
+
+    if (pd->cbOld != pd->cbNew || pd->cOld != pd->cNew) {
+      fprintf(pJob->fo, "   %10lu  %10lu  %+10ld  %s%s\n",
+              pd->cbOld, pd->cbNew, (long)(pd->cbNew - pd->cbOld),
+              szKey, InstanceCount(pd, szCnt));
+      pJob->mod.cResized++;
+    }
+  }
+
+  fprintf(pJob->fo, "\n Moved modules\n\n%s", pszDiffMoveHdr);
+  for (ctr = 0; ctr < pNew->tbl.cMod; ctr++) {
+    r = pNew->tbl.ppMod[ctr];
+    pd = (DIFFENT*)HashFind(&pJob->hashMod, ModuleKey(r, szKey), 0)->pv;
+    if (pd->fDone != 1)
+      continue;
+    pd->fDone = 2;
+
+    if (pd->cOld == 1 && pd->cNew == 1 &&
+        (pd->pOld->seg != r->seg || pd->pOld->offs != r->offs)) {
+      fprintf(pJob->fo, "   %04lX:%08lX  %04lX:%08lX  %s\n",
+              pd->pOld->seg, pd->pOld->offs, r->seg, r->offs, szKey);
+      pJob->mod.cMoved++;
+    }
+    else
+    if (pd->cbOld == pd->cbNew && pd->cOld == pd->cNew)
+      pJob->mod.cSame++;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* A public's key is its name plus the suffix used to identify vtables,
+   thunks, etc. so that e.g. a class's vtable & typeinfo don't collide.
+*/
+
+char *  SymbolKey(REMAP * r, char * pKey)
+{
+  sprintf(pKey, "%.*s%s", CB_DIFFKEY - 32, r->text, DecodeFlagName(r->type));
+
+  return pKey;
+}
+
+/*****************************************************************************/
+/* Module records are "length\0source\0library". */
+
+char *  ModuleKey(REMAP * r, char * pKey)
+{
+  char *  pSrc;
+  char *  pLib;
+
+  pSrc = strchr(r->text, 0) + 1;
+  pLib = strchr(pSrc, 0) + 1;
+  sprintf(pKey, "%.*s  (%.*s)", CCHMAXPATH - 1, pSrc, CCHMAXPATH - 1, pLib);
+
+  return pKey;
+}
+
+/*****************************************************************************/
+/* Note a change in the number of instances of a name. */
+
+char *  InstanceCount(DIFFENT * pEnt, char * pOut)
+{
+  if (pEnt->cOld == pEnt->cNew)
+    *pOut = 0;
+  else
+    sprintf(pOut, "  [%lu -> %lu]", pEnt->cOld, pEnt->cNew);
+
+  return pOut;
+}
+
+/*****************************************************************************/
+
+void    PrintDiffCounts(DIFFJOB * pJob, char * pszTitle, DIFFCNT * pCnt)
+{
+  fprintf(pJob->fo, "   %s:  %lu removed,  %lu added,  %lu resized,"
+                    "  %lu moved,  %lu unchanged\n", pszTitle,
+          pCnt->cRemoved, pCnt->cAdded, pCnt->cResized,
+          pCnt->cMoved, pCnt->cSame);
+
+  return;
+}
+
+/*****************************************************************************/
+
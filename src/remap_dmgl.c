@@ -0,0 +1,421 @@
+/*****************************************************************************/
+/*  remap_dmgl.c
+ *
+ *  Demangle cache (--dmglcache).  Between one build & the next, nearly
+ *  all of a map's names are unchanged, yet each run demangles every one
+ *  of them again - which is slow when the demangler is demangl.dll or an
+ *  external program.  This keeps the demangler's results in a file so
+ *  later runs can reuse them.
+ *
+ *  The file is a log:  a run loads the entries that match its demangler
+ *  & options into the memo table Demangle() uses, then appends the names
+ *  it had to demangle itself.  Reading shares the file with other readers
+ *  but not with writers;  appending requires exclusive access.  When the
+ *  log accumulates too many duplicates (e.g. when several processes added
+ *  the same names at once), it's rewritten without them.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <share.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define DMGL_OPTS       (OPT_SHOW_ARGS | OPT_WS)
+#define DMGL_BOTH       0x80    /* --both-args, in the key's 2 digits */
+#define DMGL_RETRIES    20
+#define DMGL_WAIT       50
+#define DMGL_COMPACT    1000    /* the fewest lines worth compacting */
+
+FILE *  OpenShared(char * pszMode, int shflag);
+char *  ReadLog(FILE * fp, ULONG * pcb);
+int     IsEntry(char * pLine, char ** ppName, char ** ppFlags, char ** ppText);
+int     CompactLog(void);
+
+char *  pszDmglCache = 0;
+ULONG   cDmglLookups = 0;
+ULONG   cDmglHits = 0;
+
+char    szDmglTag[] = "remap-1.02-demangle\n";
+char    szDmglKey[32];      /* identifies the demangler & its options */
+char *  pDmglLog = 0;       /* the entries loaded from the file */
+ULONG   cbDmglLog = 0;
+ULONG   cDmglLines = 0;
+ULONG   cDmglDups = 0;
+
+/*****************************************************************************/
+/* Set up the memo table & fill it with the entries made by the same
+   demangler using the same options.  A missing file is an empty cache;
+   one that isn't a demangle cache is left alone & not used.
+*/
+
+int     DmglCacheLoad(void)
+{
+  ULONG     cb;
+  FILE *    fp;
+  char *    pLine;
+  char *    pNext;
+  char *    pName;
+  char *    pFlags;
+  char *    pText;
+  HASHENT * pEnt;
+  DMGLMEMO* pMemo;
+
+  sprintf(szDmglKey, "%c%02X%08lX",
+          ((opts & OPT_XXC) ? 'X' : ((opts & OPT_VAC) ? 'V' : 'G')),
+          ((opts & DMGL_OPTS) | ((opts & OPT_BOTHARGS) ? DMGL_BOTH : 0)),
+          ((opts & OPT_XXC) ? HashString(pszDemangler) : 0));
+
+  if (!hashDemangle.ppSlot &&
+      !HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO))) {
+    fprintf(stderr, "unable to initialize the demangle cache\n");
+    return 0;
+  }
+
+  fp = OpenShared("rb", SH_DENYWR);
+  if (!fp)
+    return 1;
+
+  pDmglLog = ReadLog(fp, &cb);
+  fclose(fp);
+  if (!pDmglLog)
+    return 1;
+  cbDmglLog = cb + 1;
+  MEMADD(MEM_STRINGS, cbDmglLog);
+
+  if (cb && strncmp(pDmglLog, szDmglTag, sizeof(szDmglTag) - 1)) {
+    fprintf(stderr, "'%s' isn't a demangle cache - it won't be used\n",
+            pszDmglCache);
+    free(pDmglLog);
+    MEMADD(MEM_STRINGS, -(long)cbDmglLog);
+    pDmglLog = 0;
+    pszDmglCache = 0;
+    return 1;
+  }
+
+  /* the text is used where it is, so the lines are split in place */
+  for (pLine = pDmglLog + strlen(szDmglTag); pLine < pDmglLog + cb;
+       pLine = pNext) {
+
+    pNext = strchr(pLine, '\n');
+    if (!pNext)
+      break;
+    *pNext++ = 0;
+
+    if (!IsEntry(pLine, &pName, &pFlags, &pText))
+      continue;
+    cDmglLines++;
+
+    if (strncmp(pLine, szDmglKey, strlen(szDmglKey)))
+      continue;
+
+    pEnt = HashFind(&hashDemangle, pName, 1);
+    if (!pEnt)
+      break;
+
+    pMemo = (DMGLMEMO*)pEnt->pv;
+    if (pMemo->pText) {
+      cDmglDups++;
+      continue;
+    }
+    pMemo->pText = pText;
+    pMemo->flags = strtoul(pFlags, 0, 16);
+
+    /* --both-args's two forms are separated by a tab */
+    if (pMemo->flags & REMAP_ARGS) {
+      pText = strchr(pText, '\t');
+      if (pText)
+        *pText = 0;
+      else
+        pMemo->flags &= ~REMAP_ARGS;
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Append the names demangled during this run, report how well the cache
+   worked, then compact the file if it needs it.
+*/
+
+void    DmglCacheSave(void)
+{
+  ULONG     cNew = 0;
+  FILE *    fp = 0;
+  HASHENT** ppArr;
+  HASHENT** ppEnt;
+  DMGLMEMO* pMemo;
+  char *    pArgs;
+
+  if (!pszDmglCache || !hashDemangle.ppSlot)
+    return;
+
+do {
+  ppArr = HashToArray(&hashDemangle);
+  if (!ppArr)
+    break;
+
+  for (ppEnt = ppArr; *ppEnt; ppEnt++) {
+    pMemo = (DMGLMEMO*)(*ppEnt)->pv;
+
+    /* the log is line-oriented & tab-delimited */
+    pArgs = ((pMemo->pText && (pMemo->flags & REMAP_ARGS)) ?
+             strchr(pMemo->pText, 0) + 1 : 0);
+    if (!pMemo->fNew || !pMemo->pText ||
+        strpbrk((*ppEnt)->key, "\t\r\n") || strpbrk(pMemo->pText, "\t\r\n") ||
+        (pArgs && strpbrk(pArgs, "\t\r\n")))
+      continue;
+
+    /* if a process ended partway through a line, that line is ended
+       with an extra tab, which IsEntry() rejects, so the new entries
+       don't run into it & it can't pass for a complete entry */
+    if (!fp) {
+      fp = OpenShared("a+b", SH_DENYRW);
+      if (!fp) {
+        fprintf(stderr, "unable to update demangle cache '%s'\n",
+                pszDmglCache);
+        break;
+      }
+      fseek(fp, 0, SEEK_END);
+      if (!ftell(fp))
+        fputs(szDmglTag, fp);
+      else
+      if (!fseek(fp, -1, SEEK_END) && fgetc(fp) != '\n') {
+        fseek(fp, 0, SEEK_END);
+        fputs("\t\n", fp);
+      }
+      else
+        fseek(fp, 0, SEEK_END);
+    }
+
+    fprintf(fp, "%s %s\t%lX\t%s%s%s\n", szDmglKey, (*ppEnt)->key,
+            pMemo->flags, pMemo->pText, (pArgs ? "\t" : ""),
+            (pArgs ? pArgs : ""));
+    cNew++;
+  }
+
+  free(ppArr);
+
+  if (fp && fclose(fp))
+    fprintf(stderr, "error writing demangle cache '%s'\n", pszDmglCache);
+
+} while (0);
+
+  fprintf(stderr, "demangle cache:  %lu of %lu lookups found (%.1f%%),"
+                  "  %lu added\n", cDmglHits, cDmglLookups,
+          (cDmglLookups ? (cDmglHits * 100.0) / cDmglLookups : 0.0), cNew);
+
+  /* other processes may still be reading the loaded entries' file,
+     so the check for duplicates uses the counts from loading it */
+  if (cDmglLines >= DMGL_COMPACT && cDmglDups * 4 > cDmglLines)
+    CompactLog();
+
+  return;
+}
+
+/*****************************************************************************/
+/* Called after FreeDemangleMemo() - the loaded entries' text is here. */
+
+void    DmglCacheFree(void)
+{
+  if (pDmglLog) {
+    free(pDmglLog);
+    MEMADD(MEM_STRINGS, -(long)cbDmglLog);
+  }
+  pDmglLog = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Rewrite the log without duplicates.  Every demangler's entries are kept,
+   not just the ones loaded.  The file is held exclusively while it's read
+   & copied;  anything appended between closing it & replacing it is lost,
+   which only means those names will be demangled again.
+*/
+
+int     CompactLog(void)
+{
+  int       ok = 0;
+  ULONG     cb;
+  FILE *    fpIn;
+  FILE *    fpOut = 0;
+  char *    pLog;
+  char *    pLine;
+  char *    pNext;
+  char *    pName;
+  char *    pFlags;
+  char *    pText;
+  ULONG     cEnt;
+  HASHTBL   hash;
+  char      szTemp[CCHMAXPATH];
+
+  fpIn = OpenShared("rb", SH_DENYRW);
+  if (!fpIn)
+    return 0;
+
+  pLog = ReadLog(fpIn, &cb);
+  if (!pLog) {
+    fclose(fpIn);
+    return 0;
+  }
+
+  memset(&hash, 0, sizeof(hash));
+  sprintf(szTemp, "%.*s.tmp", CCHMAXPATH - 5, pszDmglCache);
+
+do {
+  if (strncmp(pLog, szDmglTag, sizeof(szDmglTag) - 1) ||
+      !HashInit(&hash, 0x10000, 0))
+    break;
+
+  fpOut = fopen(szTemp, "wb");
+  if (!fpOut)
+    break;
+  fputs(szDmglTag, fpOut);
+
+  /* an entry's key is everything up to the first tab;  only the first
+     entry with a given key is kept */
+  ok = 1;
+  for (pLine = pLog + strlen(szDmglTag); pLine < pLog + cb; pLine = pNext) {
+    pNext = strchr(pLine, '\n');
+    if (!pNext)
+      break;
+    *pNext++ = 0;
+
+    if (!IsEntry(pLine, &pName, &pFlags, &pText))
+      continue;
+
+    cEnt = hash.cEnt;
+    if (!HashFind(&hash, pLine, 1)) {
+      ok = 0;
+      break;
+    }
+    if (hash.cEnt == cEnt)
+      continue;
+
+    fprintf(fpOut, "%s\t%s\t%s\n", pLine, pFlags, pText);
+  }
+
+} while (0);
+
+  if (fpOut && fclose(fpOut))
+    ok = 0;
+  fclose(fpIn);
+  HashFree(&hash);
+  free(pLog);
+
+  if (ok) {
+    DosDelete(pszDmglCache);
+    ok = !DosMove(szTemp, pszDmglCache);
+  }
+  if (!ok && fpOut)
+    DosDelete(szTemp);
+
+  return ok;
+}
+
+/*****************************************************************************/
+/* Other processes may be using the file, so keep trying for a while. */
+
+FILE *  OpenShared(char * pszMode, int shflag)
+{
+  int     ctr;
+  FILE *  fp;
+  FILESTATUS3 fs;
+
+  for (ctr = 0; ctr < DMGL_RETRIES; ctr++) {
+    fp = _fsopen(pszDmglCache, pszMode, shflag);
+    if (fp)
+      return fp;
+
+    /* a reader doesn't need to wait for a file that doesn't exist */
+    if (*pszMode == 'r' &&
+        DosQueryPathInfo(pszDmglCache, FIL_STANDARD, &fs, sizeof(fs)))
+      return 0;
+
+    DosSleep(DMGL_WAIT);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************/
+/* Read the entire file into a null-terminated buffer. */
+
+char *  ReadLog(FILE * fp, ULONG * pcb)
+{
+  long    cb;
+  char *  pBuf;
+
+  *pcb = 0;
+
+  if (fseek(fp, 0, SEEK_END) || (cb = ftell(fp)) < 0 ||
+      fseek(fp, 0, SEEK_SET))
+    return 0;
+
+  pBuf = (char*)malloc(cb + 1);
+  if (!pBuf) {
+    fprintf(stderr, "malloc failed for demangle cache\n");
+    return 0;
+  }
+
+  if (fread(pBuf, 1, cb, fp) != (size_t)cb) {
+    free(pBuf);
+    return 0;
+  }
+
+  pBuf[cb] = 0;
+  *pcb = cb;
+
+  return pBuf;
+}
+
+/*****************************************************************************/
+/* An entry is "key name<tab>flags<tab>text", where --both-args's text is
+   "name<tab>name(args)".  A line that was only partly written when a
+   process ended is ignored:  either it's the last one, or the next run
+   ended it with a tab, leaving too many tabs or an empty name.
+*/
+
+int     IsEntry(char * pLine, char ** ppName, char ** ppFlags, char ** ppText)
+{
+  char *  ptr;
+  int     cTabs;
+
+  ptr = strchr(pLine, ' ');
+  if (!ptr || ptr - pLine != strlen(szDmglKey))
+    return 0;
+  *ppName = ptr + 1;
+
+  ptr = strchr(ptr, '\t');
+  if (!ptr)
+    return 0;
+  *ptr++ = 0;
+  *ppFlags = ptr;
+
+  ptr = strchr(ptr, '\t');
+  if (!ptr)
+    return 0;
+  *ptr++ = 0;
+  *ppText = ptr;
+
+  if (!*ptr || *ptr == '\t')
+    return 0;
+  for (cTabs = 0; (ptr = strchr(ptr, '\t')) != 0 && *++ptr; )
+    cTabs++;
+  if (ptr || cTabs > ((strtoul(*ppFlags, 0, 16) & REMAP_ARGS) ? 1 : 0))
+    return 0;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
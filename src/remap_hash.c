@@ -0,0 +1,204 @@
+/*****************************************************************************/
+/*  remap_hash.c
+ *
+ *  A simple chained hash table keyed by strings.  Each entry carries a
+ *  block of caller-defined data (e.g. counters) that's zeroed when the
+ *  entry is added.  The table doubles in size whenever it averages more
+ *  than 2 entries per slot.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+int     HashGrow(HASHTBL * pHash);
+
+/* keep the caller's data 8-byte aligned */
+#define HASH_ALIGN(cb)  (((cb) + 7) & ~7)
+
+/*****************************************************************************/
+
+int     HashInit(HASHTBL * pHash, ULONG cSlot, ULONG cbData)
+{
+  ULONG   cnt;
+
+  /* round up to a power of 2 so the hash can be masked */
+  for (cnt = 64; cnt < cSlot; cnt <<= 1)
+    ;
+
+  pHash->ppSlot = (HASHENT**)calloc(cnt, sizeof(HASHENT*));
+  if (!pHash->ppSlot) {
+    fprintf(stderr, "calloc failed for HashInit - slots= %ld\n", cnt);
+    return 0;
+  }
+
+  pHash->cSlot  = cnt;
+  pHash->cEnt   = 0;
+  pHash->cbData = HASH_ALIGN(cbData);
+  MEMADD(MEM_HASH, cnt * sizeof(HASHENT*));
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* FNV-1a - fast & good enough for symbol names. */
+
+ULONG   HashString(char * pKey)
+{
+  ULONG   hash = 2166136261UL;
+
+  while (*pKey) {
+    hash ^= (unsigned char)*pKey++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+/*****************************************************************************/
+/* Return the entry for a key.  If it isn't found & fAdd is set, a new
+   entry is added;  otherwise, null is returned.
+*/
+
+HASHENT * HashFind(HASHTBL * pHash, char * pKey, int fAdd)
+{
+  ULONG     hash;
+  ULONG     cbKey;
+  HASHENT * pEnt;
+  HASHENT** ppSlot;
+
+  hash = HashString(pKey);
+  ppSlot = &pHash->ppSlot[hash & (pHash->cSlot - 1)];
+
+  for (pEnt = *ppSlot; pEnt; pEnt = pEnt->next) {
+    if (pEnt->hash == hash && !strcmp(pEnt->key, pKey))
+      return pEnt;
+  }
+
+  if (!fAdd)
+    return 0;
+
+  cbKey = strlen(pKey) + 1;
+  pEnt = (HASHENT*)malloc(sizeof(HASHENT) + pHash->cbData + cbKey);
+  if (!pEnt) {
+    fprintf(stderr, "malloc failed for HashFind - bytes= %ld\n",
+            sizeof(HASHENT) + pHash->cbData + cbKey);
+    return 0;
+  }
+
+  pEnt->hash = hash;
+  pEnt->pv   = &pEnt[1];
+  pEnt->key  = (char*)pEnt->pv + pHash->cbData;
+  memset(pEnt->pv, 0, pHash->cbData);
+  memcpy(pEnt->key, pKey, cbKey);
+
+  pEnt->next = *ppSlot;
+  *ppSlot = pEnt;
+  pHash->cEnt++;
+  MEMADD(MEM_HASH, sizeof(HASHENT) + pHash->cbData + cbKey);
+
+  if (pHash->cEnt > 2 * pHash->cSlot)
+    HashGrow(pHash);
+
+  return pEnt;
+}
+
+/*****************************************************************************/
+/* Double the number of slots.  If the allocation fails, the table just
+   keeps working with longer chains.
+*/
+
+int     HashGrow(HASHTBL * pHash)
+{
+  ULONG     ctr;
+  ULONG     cSlot = pHash->cSlot * 2;
+  HASHENT * pEnt;
+  HASHENT * pNext;
+  HASHENT** ppSlot;
+
+  ppSlot = (HASHENT**)calloc(cSlot, sizeof(HASHENT*));
+  if (!ppSlot)
+    return 0;
+
+  for (ctr = 0; ctr < pHash->cSlot; ctr++) {
+    for (pEnt = pHash->ppSlot[ctr]; pEnt; pEnt = pNext) {
+      pNext = pEnt->next;
+      pEnt->next = ppSlot[pEnt->hash & (cSlot - 1)];
+      ppSlot[pEnt->hash & (cSlot - 1)] = pEnt;
+    }
+  }
+
+  free(pHash->ppSlot);
+  MEMADD(MEM_HASH, (cSlot - pHash->cSlot) * sizeof(HASHENT*));
+  pHash->ppSlot = ppSlot;
+  pHash->cSlot  = cSlot;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Return a null-terminated array of all entries so they can be sorted.
+   The caller must free it.
+*/
+
+HASHENT** HashToArray(HASHTBL * pHash)
+{
+  ULONG     ctr;
+  HASHENT * pEnt;
+  HASHENT** ppArr;
+  HASHENT** ppRtn;
+
+  ppRtn = (HASHENT**)malloc((pHash->cEnt + 1) * sizeof(HASHENT*));
+  if (!ppRtn) {
+    fprintf(stderr, "malloc failed for HashToArray - bytes= %ld\n",
+            (pHash->cEnt + 1) * sizeof(HASHENT*));
+    return 0;
+  }
+
+  ppArr = ppRtn;
+  for (ctr = 0; ctr < pHash->cSlot; ctr++) {
+    for (pEnt = pHash->ppSlot[ctr]; pEnt; pEnt = pEnt->next)
+      *ppArr++ = pEnt;
+  }
+  *ppArr = 0;
+
+  return ppRtn;
+}
+
+/*****************************************************************************/
+
+void    HashFree(HASHTBL * pHash)
+{
+  ULONG     ctr;
+  HASHENT * pEnt;
+  HASHENT * pNext;
+
+  if (!pHash->ppSlot)
+    return;
+
+  for (ctr = 0; ctr < pHash->cSlot; ctr++) {
+    for (pEnt = pHash->ppSlot[ctr]; pEnt; pEnt = pNext) {
+      pNext = pEnt->next;
+      MEMADD(MEM_HASH, -(long)(sizeof(HASHENT) + pHash->cbData +
+                               strlen(pEnt->key) + 1));
+      free(pEnt);
+    }
+  }
+
+  free(pHash->ppSlot);
+  MEMADD(MEM_HASH, -(long)(pHash->cSlot * sizeof(HASHENT*)));
+  memset(pHash, 0, sizeof(HASHTBL));
+
+  return;
+}
+
+/*****************************************************************************/
+
@@ -0,0 +1,411 @@
+/*****************************************************************************/
+/*  remap_lib.c
+ *
+ *  libremap's interface (see libremap.h).  A map is read with the same
+ *  code remap.exe uses for its listings, then indexed three ways:  every
+ *  entry by address, the publics by name, and the publics & exports by
+ *  address for looking up the symbol that contains an address.
+ *
+ *  Names are stored mangled & demangled when they're first used, so
+ *  looking up a few addresses only demangles a few names.  The index by
+ *  name needs all of them, so it isn't built until it's used;  that's
+ *  the only thing that changes after a map is opened, so it's the only
+ *  part of a lookup that needs a lock.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+#include "libremap.h"
+
+/*****************************************************************************/
+
+/* the options a caller can set */
+#define RMAP_OPTS   (RMAP_NO_DEMANGLE | RMAP_SHOW_ARGS | RMAP_WS | \
+                     RMAP_GCC | RMAP_VAC | RMAP_XXC | RMAP_BOTH_ARGS)
+
+struct _rmap {
+    REMAPCTX  ctx;
+    REMAP **  ppAddr;   /* every entry */
+    int       cAddr;
+    REMAP **  ppName;   /* publics, imports, & exports */
+    int       cName;
+    ADDRTBL   tbl;      /* publics & exports */
+    HASHTBL   hash;     /* the first entry with each name */
+    HMTX      hmtx;     /* serializes building the index by name */
+    volatile int fNames;  /* ppName has been sorted & hashed */
+};
+
+/* an entry of the index by name, with its name already demangled */
+typedef struct _rmapname {
+    char *    pszName;
+    REMAP *   r;
+} RMAPNAME;
+
+int     RmapIndex(RMAP * pMap);
+int     RmapNames(RMAP * pMap);
+int     RmapNameSorter(const void *key, const void *element);
+int     RmapSymbol(REMAP * r, RMAPSYM * pSym);
+
+/* these are declared in remap.c */
+extern FILE *   pi;
+extern FILE *   po;
+extern ULONG    ulFiltPID;
+extern HMTX     hmtxDemangle;
+
+/*****************************************************************************/
+/* Set the options & start the demangler.  This has to be called once,
+   before any map is opened.
+*/
+
+int     RmapInit(ULONG flags, char * pszDmgl)
+{
+  opts = (int)(flags & RMAP_OPTS);
+  if (!(opts & (OPT_GCC | OPT_VAC | OPT_XXC)))
+    opts |= OPT_GCC;
+
+  if ((opts & OPT_XXC) && !(opts & OPT_NO_DEMANGLE)) {
+    if (!pszDmgl) {
+      fprintf(stderr, "RmapInit - no demangler program\n");
+      return 0;
+    }
+    pszDemangler = strdup(pszDmgl);
+    if (!pszDemangler) {
+      fprintf(stderr, "malloc failed for RmapInit\n");
+      return 0;
+    }
+  }
+
+  /* the names that have been demangled are kept here, for every map */
+  if (!(opts & OPT_NO_DEMANGLE) && !hashDemangle.ppSlot &&
+      !HashInit(&hashDemangle, 0x10000, sizeof(DMGLMEMO)))
+    return 0;
+
+  return Init();
+}
+
+/*****************************************************************************/
+/* Release the demangler & whatever it saved.  Every map should be
+   closed first.
+*/
+
+void    RmapTerm(void)
+{
+  DmglCacheSave();
+  FreeDemangleMemo();
+  DmglCacheFree();
+
+  /* cleanup if we used an external demangler */
+  if (ulFiltPID)
+    DosSendSignalException(ulFiltPID, XCPT_SIGNAL_BREAK);
+  if (po)
+    fclose(po);
+  if (pi)
+    fclose(pi);
+  if (hmtxDemangle)
+    DosCloseMutexSem(hmtxDemangle);
+  if (pszDemangler)
+    free(pszDemangler);
+
+  ulFiltPID = 0;
+  po = 0;
+  pi = 0;
+  hmtxDemangle = 0;
+  pszDemangler = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Read & index a map.  Its file is closed once it's been read. */
+
+RMAP *  RmapOpen(char * pszMap)
+{
+  RMAP *  pMap;
+
+  if (strlen(pszMap) >= CCHMAXPATH - 4) {
+    fprintf(stderr, "invalid input filename or path - '%s'\n", pszMap);
+    return 0;
+  }
+
+  pMap = (RMAP*)calloc(1, sizeof(RMAP));
+  if (!pMap) {
+    fprintf(stderr, "malloc failed for RmapOpen\n");
+    return 0;
+  }
+  strcpy(pMap->ctx.fIn, pszMap);
+  pMap->ctx.fLazy = !(opts & OPT_NO_DEMANGLE);
+
+do {
+  if (!OpenMap(&pMap->ctx) || !ReadMap(&pMap->ctx))
+    break;
+
+  /* the records are indexed, so they have to be in memory */
+  if (pMap->ctx.pSpill) {
+    fprintf(stderr, "'%s' is too large to read into memory\n",
+            pMap->ctx.fIn);
+    break;
+  }
+
+  fclose(pMap->ctx.fi);
+  pMap->ctx.fi = 0;
+  MEMADD(MEM_IO, -BUFSIZ);
+
+  if (!RmapIndex(pMap))
+    break;
+
+  return pMap;
+
+} while (0);
+
+  RmapClose(pMap);
+
+  return 0;
+}
+
+/*****************************************************************************/
+
+void    RmapClose(RMAP * pMap)
+{
+  if (!pMap)
+    return;
+
+  if (pMap->ppAddr) {
+    free(pMap->ppAddr);
+    MEMADD(MEM_SORT, -(long)((pMap->cAddr + 1) * sizeof(REMAP*)));
+  }
+  if (pMap->ppName) {
+    free(pMap->ppName);
+    MEMADD(MEM_SORT, -(long)((pMap->cName + 1) * sizeof(REMAP*)));
+  }
+  FreeAddressTable(&pMap->tbl);
+  HashFree(&pMap->hash);
+  if (pMap->hmtx)
+    DosCloseMutexSem(pMap->hmtx);
+  CloseContext(&pMap->ctx);
+  free(pMap);
+
+  return;
+}
+
+/*****************************************************************************/
+/* The entries are chosen the same way as for a .remap listing:  the
+   duplicates that result from reading both lists of publics are left out.
+   The index by name is only collected here;  see RmapNames().
+*/
+
+int     RmapIndex(RMAP * pMap)
+{
+  ULONG     rc;
+  REMAP *   pRec;
+
+  pMap->ppAddr = (REMAP**)malloc((pMap->ctx.recCnt + 1) * sizeof(REMAP*));
+  pMap->ppName = (REMAP**)malloc((pMap->ctx.recCnt + 1) * sizeof(REMAP*));
+  if (!pMap->ppAddr || !pMap->ppName) {
+    fprintf(stderr, "malloc failed for RmapIndex - bytes= %d\n",
+            (pMap->ctx.recCnt + 1) * sizeof(REMAP*));
+    return 0;
+  }
+
+  for (pRec = (REMAP*)pMap->ctx.buffer; pRec->next; pRec = pRec->next) {
+    if (pRec->type & REMAP_DUP2)
+      continue;
+
+    if ((pRec->type & (REMAP_OBJ | REMAP_DUP)) != (REMAP_OBJ | REMAP_DUP))
+      pMap->ppAddr[pMap->cAddr++] = pRec;
+
+    if ((pRec->type & (REMAP_IMP | REMAP_EXP | REMAP_EPT)) ||
+        (pRec->type & (REMAP_OBJ | REMAP_DUP)) == REMAP_OBJ)
+      pMap->ppName[pMap->cName++] = pRec;
+  }
+  pMap->ppAddr[pMap->cAddr] = 0;
+  pMap->ppName[pMap->cName] = 0;
+
+  /* the unused ends of the arrays are small enough to ignore */
+  MEMADD(MEM_SORT, (pMap->cAddr + pMap->cName + 2) * sizeof(REMAP*));
+
+  qsort(pMap->ppAddr, pMap->cAddr, sizeof(REMAP*), AddressSorter);
+
+  if (!BuildAddressTable(&pMap->tbl, pMap->ctx.buffer))
+    return 0;
+
+  rc = DosCreateMutexSem(0, &pMap->hmtx, 0, FALSE);
+  if (rc) {
+    fprintf(stderr, "DosCreateMutexSem - rc= %ld\n", rc);
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Sort & hash the publics by name the first time they're needed.  Every
+   name is demangled first, in one pass, so the sort compares strings that
+   are already at hand;  names that repeat are found in the memo table.
+*/
+
+int     RmapNames(RMAP * pMap)
+{
+  int        ctr;
+  int        rtn = 0;
+  RMAPNAME * pName = 0;
+  HASHENT *  pEnt;
+
+  /* the table & ppName's new order have to be seen before fNames is */
+  if (pMap->fNames) {
+    __sync_synchronize();
+    return 1;
+  }
+
+  DosRequestMutexSem(pMap->hmtx, SEM_INDEFINITE_WAIT);
+
+do {
+  if (pMap->fNames) {
+    rtn = 1;
+    break;
+  }
+
+  pName = (RMAPNAME*)malloc((pMap->cName + 1) * sizeof(RMAPNAME));
+  if (!pName) {
+    fprintf(stderr, "malloc failed for RmapNames - bytes= %d\n",
+            (pMap->cName + 1) * sizeof(RMAPNAME));
+    break;
+  }
+
+  for (ctr = 0; ctr < pMap->cName; ctr++) {
+    pName[ctr].pszName = RecordName(pMap->ppName[ctr]);
+    pName[ctr].r = pMap->ppName[ctr];
+  }
+
+  qsort(pName, pMap->cName, sizeof(RMAPNAME), RmapNameSorter);
+
+  if (!HashInit(&pMap->hash, pMap->cName, sizeof(REMAP*)))
+    break;
+
+  for (ctr = 0; ctr < pMap->cName; ctr++) {
+    pMap->ppName[ctr] = pName[ctr].r;
+    pEnt = HashFind(&pMap->hash, pName[ctr].pszName, 1);
+    if (!pEnt)
+      break;
+    if (!*(REMAP**)pEnt->pv)
+      *(REMAP**)pEnt->pv = pName[ctr].r;
+  }
+  if (ctr < pMap->cName)
+    break;
+
+  __sync_synchronize();
+  pMap->fNames = 1;
+  rtn = 1;
+
+} while (0);
+
+  DosReleaseMutexSem(pMap->hmtx);
+  if (pName)
+    free(pName);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* qsort callback - the same order as NameSorter() */
+
+int     RmapNameSorter(const void *key, const void *element)
+{
+  return CompareNames(((RMAPNAME*)key)->pszName, ((RMAPNAME*)key)->r,
+                      ((RMAPNAME*)element)->pszName, ((RMAPNAME*)element)->r);
+}
+
+/*****************************************************************************/
+
+int     RmapCount(RMAP * pMap, int order)
+{
+  return (order == RMAP_BYNAME ? pMap->cName : pMap->cAddr);
+}
+
+/*****************************************************************************/
+/* Return the ndx'th entry in the order requested. */
+
+int     RmapGet(RMAP * pMap, int order, int ndx, RMAPSYM * pSym)
+{
+  if (ndx < 0 || ndx >= RmapCount(pMap, order))
+    return 0;
+
+  if (order == RMAP_BYNAME && !RmapNames(pMap))
+    return 0;
+
+  return RmapSymbol((order == RMAP_BYNAME ? pMap->ppName[ndx] :
+                                            pMap->ppAddr[ndx]), pSym);
+}
+
+/*****************************************************************************/
+/* Find the public or export at or below seg:offs.  As with a crash
+   report, an address before the first symbol in its segment isn't found.
+*/
+
+int     RmapFindAddress(RMAP * pMap, ULONG seg, ULONG offs, RMAPSYM * pSym)
+{
+  return RmapSymbol(FindByAddress(pMap->tbl.ppSym, pMap->tbl.cSym,
+                                  seg, offs), pSym);
+}
+
+/*****************************************************************************/
+/* Names are matched exactly, as they appear after demangling. */
+
+int     RmapFindName(RMAP * pMap, char * pszName, RMAPSYM * pSym)
+{
+  HASHENT * pEnt;
+
+  if (!RmapNames(pMap))
+    return 0;
+
+  pEnt = HashFind(&pMap->hash, pszName, 0);
+
+  return RmapSymbol((pEnt ? *(REMAP**)pEnt->pv : 0), pSym);
+}
+
+/*****************************************************************************/
+
+int     RmapSymbol(REMAP * r, RMAPSYM * pSym)
+{
+  int     cText;
+  int     ctr;
+
+  if (!r)
+    return 0;
+
+  switch (r->type & REMAP_TYPE) {
+    case REMAP_SEG:
+    case REMAP_MOD:
+      cText = 3;
+      break;
+    case REMAP_IMP:
+    case REMAP_EXP:
+      cText = 2;
+      break;
+    default:
+      cText = 1;
+      break;
+  }
+
+  pSym->type = RecordType(r) & REMAP_MASK;
+  pSym->seg  = r->seg;
+  pSym->offs = r->offs;
+  pSym->apszText[0] = r->text;
+  for (ctr = 1; ctr < 3; ctr++)
+    pSym->apszText[ctr] = (ctr < cText ?
+                           strchr(pSym->apszText[ctr - 1], 0) + 1 : "");
+  pSym->apszText[0] = RecordName(r);
+  if ((opts & OPT_BOTHARGS) && (r->type & (REMAP_OBJ | REMAP_IMP | REMAP_EXP)))
+    pSym->apszText[2] = RecordArgs(r);
+
+  return 1;
+}
+
+/*****************************************************************************/
+
@@ -0,0 +1,689 @@
+/*****************************************************************************/
+/*  remap_pipe.c
+ *
+ *  Publics parsed, demangled, & stored concurrently.  The thread reading
+ *  the map parses its publics into batches & hands them out in turn to
+ *  several demangler threads.  A store thread collects the batches from
+ *  them in the same order & adds their records to the context, just as
+ *  StorePublics() would.  With --max-memory, that's also where full
+ *  buffers are sorted into runs, so sorting overlaps the rest too.
+ *
+ *  Each pair of threads is connected by its own queue with one writer &
+ *  one reader, so the queues don't need a lock.  A queue holds a few
+ *  batches at most;  a thread that gets ahead waits for the next one.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define PIPE_MAXDMGL    16      /* demangler threads */
+#define PIPE_DEPTH      4       /* batches a queue can hold */
+#define PIPE_ITEMS      256     /* lines in a batch */
+#define CB_PIPEIN       0x4000  /* their text */
+#define CB_PIPEOUT      0x4000  /* the demangled names, to start with */
+#define CB_PIPENAME     CB_MAXNAME  /* the longest demangled name */
+
+/* one line of the publics;  the offsets are into the batch's text */
+typedef struct _pipeitem {
+    ULONG   type;       /* REMAP_ERR for lines StoreError() handles */
+    ULONG   seg;
+    ULONG   offs;
+    int     offLine;
+    int     offSym;     /* the mangled name */
+    int     offImp;     /* an import's external name, or -1 */
+    int     offOut;     /* in pOut;  -1 if it couldn't be demangled */
+} PIPEITEM;
+
+typedef struct _pipebatch {
+    int     cItem;
+    ULONG   cbIn;
+    char *  pOut;       /* the demangled names */
+    ULONG   cbOut;
+    ULONG   cbOutMax;
+    PIPEITEM aItem[PIPE_ITEMS];
+    char    achIn[CB_PIPEIN];
+} PIPEBATCH;
+
+/* a null batch marks the end */
+typedef struct _pipeq {
+    PIPEBATCH *     apBatch[PIPE_DEPTH];
+    volatile ULONG  cPut;
+    volatile ULONG  cGet;
+    HEV     hevPut;     /* posted when a batch is added */
+    HEV     hevGet;     /* posted when one is removed */
+} PIPEQ;
+
+typedef struct _pipe {
+    REMAPCTX *  pCtx;
+    THRDARG     arg;
+    HEV         hevStart;
+    int         cDmgl;      /* set once every thread has been started */
+    int         next;       /* the next thread's job */
+    volatile int fFailed;
+    PIPEQ       aIn[PIPE_MAXDMGL];
+    PIPEQ       aOut[PIPE_MAXDMGL];
+    STATS       aStats[PIPE_MAXDMGL];
+} PIPE;
+
+int     PipeOpen(PIPE * pPipe, int cDmgl);
+void    PipeClose(PIPE * pPipe);
+void    PipeWorker(void * pv);
+int     PipeParse(PIPE * pPipe);
+void    PipeLine(REMAPCTX * pCtx, PIPEBATCH * pBatch);
+void    PipeError(PIPEBATCH * pBatch, PIPEITEM * pItem, char * pLine);
+void    PipeDemangle(PIPE * pPipe, int ndx);
+void    PipeStore(PIPE * pPipe);
+int     PipeStoreBatch(REMAPCTX * pCtx, PIPEBATCH * pBatch);
+PIPEBATCH * PipeNewBatch(void);
+void    PipeFreeBatch(PIPEBATCH * pBatch);
+void    PipePut(PIPEQ * pq, PIPEBATCH * pBatch);
+PIPEBATCH * PipeGet(PIPEQ * pq);
+
+/*****************************************************************************/
+/* Called by StoreMap().  Where there's nothing to overlap, or the maps
+   themselves are already being read concurrently, the publics are stored
+   the usual way.  So are those that won't be demangled until they're
+   used (pCtx->fLazy).
+*/
+
+int     PipePublics(REMAPCTX * pCtx)
+{
+  int     ctr;
+  int     cDmgl;
+  int     cStarted;
+  int     rtn = 0;
+  double  dStart = 0;
+  PIPE *  pPipe;
+  TID     atid[PIPE_MAXDMGL + 1];
+
+  if ((opts & (OPT_NO_DEMANGLE | OPT_BATCH | OPT_DIFF)) || pCtx->fLazy)
+    return StorePublics(pCtx);
+
+  cDmgl = QueryThreadCount();
+  if (cDmgl < 2)
+    return StorePublics(pCtx);
+  if (cDmgl > PIPE_MAXDMGL)
+    cDmgl = PIPE_MAXDMGL;
+
+  /* only the builtin demangler can be used by several threads at once */
+  if (!(opts & OPT_GCC))
+    cDmgl = 1;
+
+  pPipe = (PIPE*)calloc(1, sizeof(PIPE));
+  if (!pPipe) {
+    fprintf(stderr, "malloc failed for PipePublics\n");
+    return 0;
+  }
+  pPipe->pCtx = pCtx;
+  pPipe->arg.pfn = PipeWorker;
+  pPipe->arg.pv = pPipe;
+
+do {
+  if (!PipeOpen(pPipe, cDmgl))
+    break;
+
+  /* a demangler for each queue plus the store thread;  if they can't
+     all be started, the ones that were are told to quit */
+  for (cStarted = 0; cStarted < cDmgl + 1; cStarted++) {
+    if (!StartThread(&pPipe->arg, &atid[cStarted]))
+      break;
+  }
+
+  pPipe->cDmgl = (cStarted < 2 ? 0 : cStarted - 1);
+  DosPostEventSem(pPipe->hevStart);
+
+  if (pPipe->cDmgl) {
+    if (pszTraceFile)
+      dStart = StatsNow();
+    rtn = PipeParse(pPipe);
+    if (pszTraceFile)
+      TraceSpan("parse publics", dStart, 0);
+  }
+
+  for (ctr = 0; ctr < cStarted; ctr++)
+    DosWaitThread(&atid[ctr], DCWW_WAIT);
+
+  if (!pPipe->cDmgl) {
+    rtn = StorePublics(pCtx);
+    break;
+  }
+
+  if (pPipe->fFailed)
+    rtn = 0;
+
+  /* the demanglers' timings are added to the map's */
+  if (pCtx->pStats) {
+    for (ctr = 0; ctr < pPipe->cDmgl; ctr++) {
+      pCtx->pStats->aPhase[PH_DEMANGLE].cCalls +=
+                          pPipe->aStats[ctr].aPhase[PH_DEMANGLE].cCalls;
+      pCtx->pStats->aPhase[PH_DEMANGLE].dWall +=
+                          pPipe->aStats[ctr].aPhase[PH_DEMANGLE].dWall;
+      pCtx->pStats->aPhase[PH_DEMANGLE].dCpu +=
+                          pPipe->aStats[ctr].aPhase[PH_DEMANGLE].dCpu;
+      pCtx->pStats->cDemangle += pPipe->aStats[ctr].cDemangle;
+    }
+  }
+
+} while (0);
+
+  PipeClose(pPipe);
+  free(pPipe);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+
+int     PipeOpen(PIPE * pPipe, int cDmgl)
+{
+  int     ctr;
+  ULONG   rc;
+
+  rc = DosCreateEventSem(0, &pPipe->hevStart, 0, FALSE);
+
+  for (ctr = 0; !rc && ctr < cDmgl; ctr++) {
+    rc = DosCreateEventSem(0, &pPipe->aIn[ctr].hevPut, 0, FALSE);
+    if (!rc)
+      rc = DosCreateEventSem(0, &pPipe->aIn[ctr].hevGet, 0, FALSE);
+    if (!rc)
+      rc = DosCreateEventSem(0, &pPipe->aOut[ctr].hevPut, 0, FALSE);
+    if (!rc)
+      rc = DosCreateEventSem(0, &pPipe->aOut[ctr].hevGet, 0, FALSE);
+  }
+
+  if (rc) {
+    fprintf(stderr, "DosCreateEventSem - rc= %ld\n", rc);
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    PipeClose(PIPE * pPipe)
+{
+  int     ctr;
+
+  if (pPipe->hevStart)
+    DosCloseEventSem(pPipe->hevStart);
+
+  for (ctr = 0; ctr < PIPE_MAXDMGL; ctr++) {
+    if (pPipe->aIn[ctr].hevPut)
+      DosCloseEventSem(pPipe->aIn[ctr].hevPut);
+    if (pPipe->aIn[ctr].hevGet)
+      DosCloseEventSem(pPipe->aIn[ctr].hevGet);
+    if (pPipe->aOut[ctr].hevPut)
+      DosCloseEventSem(pPipe->aOut[ctr].hevPut);
+    if (pPipe->aOut[ctr].hevGet)
+      DosCloseEventSem(pPipe->aOut[ctr].hevGet);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* The first thread to start stores the records;  the rest demangle. */
+
+void    PipeWorker(void * pv)
+{
+  int     ndx;
+  PIPE *  pPipe = (PIPE*)pv;
+
+  DosWaitEventSem(pPipe->hevStart, SEM_INDEFINITE_WAIT);
+  if (!pPipe->cDmgl)
+    return;
+
+  ndx = __sync_fetch_and_add(&pPipe->next, 1);
+  if (ndx)
+    PipeDemangle(pPipe, ndx - 1);
+  else
+    PipeStore(pPipe);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Read both listings of publics, as StorePublics() does, & hand the
+   batches to the demanglers in turn.  However this ends, every queue
+   gets an end marker so the other threads can finish.
+*/
+
+int     PipeParse(PIPE * pPipe)
+{
+  int         skip = 0;
+  int         byValue = 0;
+  int         rtn = 1;
+  ULONG       cBatch = 0;
+  ULONG       ctr;
+  char *      ptr;
+  PIPEBATCH * pBatch = 0;
+  REMAPCTX *  pCtx = pPipe->pCtx;
+
+  while (!pPipe->fFailed &&
+         fgets(pCtx->bufIn, sizeof(pCtx->bufIn), pCtx->fi)) {
+
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
+
+    if (!*ptr) {
+      if (!skip) {
+        skip = 1;
+        continue;
+      }
+
+      if (byValue)
+        break;
+
+      if (!SeekToHdr(pCtx, apszPubByValue, 0)) {
+        fprintf(stderr, "publics by value header not found\n");
+        rtn = 0;
+        break;
+      }
+      byValue = 1;
+      skip = 0;
+      continue;
+    }
+    skip = 1;
+
+    if (!pBatch) {
+      pBatch = PipeNewBatch();
+      if (!pBatch) {
+        rtn = 0;
+        break;
+      }
+    }
+
+    PipeLine(pCtx, pBatch);
+
+    /* a batch is handed on when it may not have room for another line */
+    if (pBatch->cItem == PIPE_ITEMS ||
+        pBatch->cbIn + 2 * sizeof(pCtx->bufIn) > CB_PIPEIN) {
+      PipePut(&pPipe->aIn[cBatch++ % pPipe->cDmgl], pBatch);
+      pBatch = 0;
+    }
+  }
+
+  if (pBatch)
+    PipePut(&pPipe->aIn[cBatch++ % pPipe->cDmgl], pBatch);
+
+  /* the store thread stops at the first end marker it finds, which is
+     in the queue the next batch would have gone to */
+  for (ctr = 0; ctr < (ULONG)pPipe->cDmgl; ctr++)
+    PipePut(&pPipe->aIn[(cBatch + ctr) % pPipe->cDmgl], 0);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Parse a line of the publics the same way StorePublics() does, then
+   copy what's needed from it to the batch.
+*/
+
+void    PipeLine(REMAPCTX * pCtx, PIPEBATCH * pBatch)
+{
+  int         ctr;
+  ULONG       cb;
+  char *      ptr;
+  char *      pEnd;
+  char *      pSymbol;
+  char *      pImport = 0;
+  PIPEITEM *  pItem = &pBatch->aItem[pBatch->cItem++];
+
+  memset(pItem, 0, sizeof(PIPEITEM));
+  pItem->offImp = -1;
+
+  ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
+
+  pItem->seg = strtoul(ptr, &pEnd, 16);
+  if (pItem->seg > SEG_MAX || *pEnd != ':') {
+    PipeError(pBatch, pItem, pCtx->bufIn);
+    return;
+  }
+
+  pItem->offs = strtoul(&pEnd[1], &ptr, 16);
+
+  for (pEnd = ptr, ctr = 0; pEnd && *pEnd; pEnd = strpbrk(pEnd, pszWS)) {
+    pEnd += strspn(pEnd, pszWS);
+    if (!*pEnd)
+      break;
+    ctr++;
+  }
+
+  if (!ctr) {
+    PipeError(pBatch, pItem, pCtx->bufIn);
+    return;
+  }
+  ptr += strspn(ptr, pszWS);
+
+  if (ctr == 3 && !strncmp(ptr, szImp, cbImp)) {
+    ctr--;
+    pItem->type |= REMAP_IMP;
+    ptr += cbImp;
+  } else
+  if (ctr == 2 && !strncmp(ptr, szAbs, cbAbs)) {
+    ctr--;
+    pItem->type |= REMAP_ABS;
+    ptr += cbAbs;
+  } else
+  if (ctr != 1) {
+    PipeError(pBatch, pItem, pCtx->bufIn);
+    return;
+  }
+
+  pSymbol = Trim(ptr, &ptr);
+  if (!pSymbol) {
+    fprintf(stderr, "symbol name not found\n");
+    PipeError(pBatch, pItem, pCtx->bufIn);
+    return;
+  }
+
+  /* this only changes the line after the symbol's name */
+  if (ctr == 2) {
+    pImport = Trim(ptr, 0);
+    if (!pImport) {
+      fprintf(stderr, "import name not found\n");
+      PipeError(pBatch, pItem, pCtx->bufIn);
+      return;
+    }
+
+    if (*pImport == '(') {
+      pImport++;
+      ptr = strchr(pImport, 0) - 1;
+      if (*ptr == ')')
+        *ptr = 0;
+    }
+  }
+
+  /* the line ends at the symbol's name, should it be stored as an error */
+  cb = strlen(pCtx->bufIn) + 1;
+  pItem->offLine = pBatch->cbIn;
+  pItem->offSym = pBatch->cbIn + (pSymbol - pCtx->bufIn);
+  memcpy(&pBatch->achIn[pBatch->cbIn], pCtx->bufIn, cb);
+  pBatch->cbIn += cb;
+
+  if (pImport) {
+    cb = strlen(pImport) + 1;
+    pItem->offImp = pBatch->cbIn;
+    memcpy(&pBatch->achIn[pBatch->cbIn], pImport, cb);
+    pBatch->cbIn += cb;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+
+void    PipeError(PIPEBATCH * pBatch, PIPEITEM * pItem, char * pLine)
+{
+  ULONG   cb = strlen(pLine) + 1;
+
+  pItem->type = REMAP_ERR;
+  pItem->offLine = pBatch->cbIn;
+  memcpy(&pBatch->achIn[pBatch->cbIn], pLine, cb);
+  pBatch->cbIn += cb;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Demangle each batch from one queue & pass it on in the matching queue
+   to the store thread.  --stats times the calls as DemangleSymbol() does.
+*/
+
+void    PipeDemangle(PIPE * pPipe, int ndx)
+{
+  int         ctr;
+  ULONG       cb;
+  char *      ptr;
+  char *      pOut;
+  double      dStart = 0;
+  PIPEITEM *  pItem;
+  PIPEBATCH * pBatch;
+  STATS *     pStats = (pPipe->pCtx->pStats ? &pPipe->aStats[ndx] : 0);
+
+  if (pszTraceFile)
+    dStart = StatsNow();
+
+  while ((pBatch = PipeGet(&pPipe->aIn[ndx])) != 0) {
+
+    for (ctr = 0; ctr < pBatch->cItem; ctr++) {
+      pItem = &pBatch->aItem[ctr];
+      pItem->offOut = -1;
+      if (pItem->type == REMAP_ERR)
+        continue;
+
+      /* make sure the longest name will fit */
+      if (pBatch->cbOut + CB_PIPENAME > pBatch->cbOutMax) {
+        pOut = (char*)realloc(pBatch->pOut, pBatch->cbOutMax * 2);
+        if (!pOut)
+          continue;
+        MEMADD(MEM_IO, pBatch->cbOutMax);
+        pBatch->pOut = pOut;
+        pBatch->cbOutMax *= 2;
+      }
+
+      pOut = &pBatch->pOut[pBatch->cbOut];
+      *pOut = 0;
+      if (pStats)
+        StatsBegin(pStats, PH_DEMANGLE);
+      ptr = Demangle(&pBatch->achIn[pItem->offSym], pOut, CB_PIPENAME,
+                     &pItem->type);
+      if (pStats) {
+        StatsEnd(pStats, PH_DEMANGLE);
+        pStats->cDemangle++;
+      }
+      if (!ptr)
+        continue;
+
+      /* a name that didn't fit is left mangled */
+      cb = NameLength(ptr, pItem->type);
+      if (ptr != pOut)
+        memcpy(pOut, ptr, cb);
+      pItem->offOut = pBatch->cbOut;
+      pBatch->cbOut += cb;
+    }
+
+    PipePut(&pPipe->aOut[ndx], pBatch);
+  }
+
+  PipePut(&pPipe->aOut[ndx], 0);
+
+  if (pszTraceFile)
+    TraceSpan("demangle publics", dStart, 0);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Collect the batches in the order they were parsed & store them.  After
+   a failure, the rest are just freed so the other threads can finish.
+*/
+
+void    PipeStore(PIPE * pPipe)
+{
+  ULONG       cBatch;
+  double      dStart = 0;
+  PIPEBATCH * pBatch;
+
+  if (pszTraceFile)
+    dStart = StatsNow();
+
+  for (cBatch = 0; ; cBatch++) {
+    pBatch = PipeGet(&pPipe->aOut[cBatch % pPipe->cDmgl]);
+    if (!pBatch)
+      break;
+
+    if (!pPipe->fFailed && !PipeStoreBatch(pPipe->pCtx, pBatch))
+      pPipe->fFailed = 1;
+
+    PipeFreeBatch(pBatch);
+  }
+
+  if (pszTraceFile)
+    TraceSpan("store publics", dStart, 0);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Add a batch's records as StorePublics() would have. */
+
+int     PipeStoreBatch(REMAPCTX * pCtx, PIPEBATCH * pBatch)
+{
+  int         ctr;
+  char *      ptr;
+  char *      pSymbol;
+  PIPEITEM *  pItem;
+  REMAP *     r;
+
+  for (ctr = 0; ctr < pBatch->cItem; ctr++) {
+    pItem = &pBatch->aItem[ctr];
+
+    r = NextRecord(pCtx);
+    if (!r)
+      return 0;
+
+    if (pItem->type != REMAP_ERR && pItem->offOut < 0)
+      fprintf(stderr, "Demangle failed for symbol name\n");
+
+    if (pItem->type == REMAP_ERR || pItem->offOut < 0) {
+      StoreError(pCtx, &pBatch->achIn[pItem->offLine], r);
+      continue;
+    }
+
+    pSymbol = &pBatch->pOut[pItem->offOut];
+
+    /* a name too long for its record keeps its mangled form */
+    if (NameLength(pSymbol, pItem->type) > RecordSpace(pCtx, r)) {
+      pSymbol = &pBatch->achIn[pItem->offSym];
+      pItem->type &= ~(REMAP_ATTRMASK | REMAP_ARGS);
+    }
+
+    /* Mapsym can't handle names over 255 characters long. */
+    if (opts & OPT_DEMANGLE_ONLY) {
+      if (strlen(pSymbol) > 255)
+        strcpy(&pSymbol[252], "...");
+    }
+
+    r->type |= pItem->type;
+    r->seg  = pItem->seg;
+    r->offs = pItem->offs;
+    ptr = StoreNames(pCtx, r, pSymbol, (pItem->offImp >= 0 ?
+                                        &pBatch->achIn[pItem->offImp] : 0));
+    if (!ptr) {
+      StoreError(pCtx, &pBatch->achIn[pItem->offLine], r);
+      continue;
+    }
+    pCtx->pCur = ptr;
+
+    if (!(r->type & REMAP_IMP))
+      r->type |= REMAP_OBJ;
+    r->next = (REMAP*)pCtx->pCur;
+    pCtx->recCnt++;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Batches are counted as buffers;  how many there can be at once depends
+   on the number of queues & their depth, not the size of the map.
+*/
+
+PIPEBATCH * PipeNewBatch(void)
+{
+  PIPEBATCH * pBatch;
+
+  pBatch = (PIPEBATCH*)malloc(sizeof(PIPEBATCH));
+  if (pBatch) {
+    pBatch->pOut = (char*)malloc(CB_PIPEOUT);
+    if (!pBatch->pOut) {
+      free(pBatch);
+      pBatch = 0;
+    }
+  }
+  if (!pBatch) {
+    fprintf(stderr, "malloc failed for PipeNewBatch\n");
+    return 0;
+  }
+
+  pBatch->cItem = 0;
+  pBatch->cbIn = 0;
+  pBatch->cbOut = 0;
+  pBatch->cbOutMax = CB_PIPEOUT;
+  MEMADD(MEM_IO, sizeof(PIPEBATCH) + CB_PIPEOUT);
+
+  return pBatch;
+}
+
+/*****************************************************************************/
+
+void    PipeFreeBatch(PIPEBATCH * pBatch)
+{
+  MEMADD(MEM_IO, -(long)(sizeof(PIPEBATCH) + pBatch->cbOutMax));
+  free(pBatch->pOut);
+  free(pBatch);
+
+  return;
+}
+
+/*****************************************************************************/
+/* A writer that finds the queue full waits for the reader to remove a
+   batch.  The semaphore is reset before the count is checked again, so a
+   post made in between isn't lost.
+*/
+
+void    PipePut(PIPEQ * pq, PIPEBATCH * pBatch)
+{
+  ULONG   cPost;
+
+  while (pq->cPut - pq->cGet >= PIPE_DEPTH) {
+    DosResetEventSem(pq->hevGet, &cPost);
+    if (pq->cPut - pq->cGet < PIPE_DEPTH)
+      break;
+    DosWaitEventSem(pq->hevGet, SEM_INDEFINITE_WAIT);
+  }
+
+  pq->apBatch[pq->cPut % PIPE_DEPTH] = pBatch;
+  __sync_synchronize();
+  pq->cPut++;
+  DosPostEventSem(pq->hevPut);
+
+  return;
+}
+
+/*****************************************************************************/
+/* A reader that finds the queue empty waits for the writer to add one. */
+
+PIPEBATCH * PipeGet(PIPEQ * pq)
+{
+  ULONG       cPost;
+  PIPEBATCH * pBatch;
+
+  while (pq->cPut == pq->cGet) {
+    DosResetEventSem(pq->hevPut, &cPost);
+    if (pq->cPut != pq->cGet)
+      break;
+    DosWaitEventSem(pq->hevPut, SEM_INDEFINITE_WAIT);
+  }
+
+  __sync_synchronize();
+  pBatch = pq->apBatch[pq->cGet % PIPE_DEPTH];
+  __sync_synchronize();
+  pq->cGet++;
+  DosPostEventSem(pq->hevGet);
+
+  return pBatch;
+}
+
+/*****************************************************************************/
+
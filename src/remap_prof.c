@@ -0,0 +1,689 @@
+/*****************************************************************************/
+/*  remap_prof.c
+ *
+ *  Flat profile (--profile).  Attributes sampled program counters to the
+ *  functions, object modules, and libraries in the map.
+ *
+ *  Samples are read from one or more files, one per line, as either
+ *  "seg:offset [count]" or "linear_address [count]" (hex addresses,
+ *  decimal counts, '#' starts a comment).  Linear addresses are converted
+ *  using the load address of segment 1 (--base) & the loader's practice
+ *  of starting each segment on a 64k boundary.
+ *
+ *  The samples are sorted by address, then merged with the address-sorted
+ *  publics, modules, and segments in a single pass, so the cost doesn't
+ *  depend on how many symbols each sample has to be compared with.
+ *  Samples outside any public are charged to their object module, then
+ *  to their segment.
+ *
+ *  Link order (--linkorder).  Uses the same samples to write a list of
+ *  the publics that were hit, hottest first, one external name per line,
+ *  so the linker can place the hot code together.  A summary of how many
+ *  4k pages the hot code occupies now & after reordering goes to stderr.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+typedef struct _sample {
+    ULONG   seg;
+    ULONG   offs;
+    ULONG   cnt;
+} SAMPLE;
+
+typedef struct _profile {
+    FILE *  fo;
+    ADDRTBL tbl;
+    ULONG * pSymHits;       /* per public */
+    ULONG * pModHits;       /* per module - samples not in any public */
+    ULONG * pModTotal;      /* per module - all samples */
+    ULONG * pSegHits;       /* per segment - samples not in any module */
+    ULONG * pSegBase;       /* per segment - linear address */
+    ULONG   cOther;         /* samples outside every segment */
+    ULONG   cTotal;
+    SAMPLE* pSample;
+    ULONG   cSample;
+    ULONG   cAlloc;
+} PROFILE;
+
+/* a line in one of the listings */
+typedef struct _profrow {
+    ULONG   hits;
+    char *  pPrefix;
+    char *  pName;
+    char *  pSuffix;
+} PROFROW;
+
+int     LoadProfile(PROFILE * pProf, REMAPCTX * pCtx);
+void    FreeProfile(PROFILE * pProf);
+int     ReadSamples(PROFILE * pProf, char * pFile);
+int     AddSample(PROFILE * pProf, ULONG seg, ULONG offs, ULONG cnt);
+int     LinearToSeg(PROFILE * pProf, ULONG addr, ULONG * pSeg, ULONG * pOffs);
+void    AttributeSamples(PROFILE * pProf);
+int     PrintProfileFunctions(PROFILE * pProf);
+int     PrintProfileModules(PROFILE * pProf);
+void    PrintProfileRows(PROFILE * pProf, char * pszTitle,
+                         PROFROW * pRow, int cRow);
+ULONG   CountPages(PROFILE * pProf, ULONG * pSize, int * pNdx, int cNdx);
+int     SampleSorter(const void *key, const void *element);
+int     ProfRowSorter(const void *key, const void *element);
+int     HotSorter(const void *key, const void *element);
+int     SeqSorter(const void *key, const void *element);
+
+/* used by HotSorter, which can't be passed the profile */
+PROFILE * pHotProf = 0;
+
+/*****************************************************************************/
+
+int     FlatProfile(REMAPCTX * pCtx)
+{
+  PROFILE prof;
+  int     rtn = 0;
+
+  if (!LoadProfile(&prof, pCtx))
+    return 0;
+
+  fprintf(pCtx->fo, "\n Flat profile for %s - %lu samples",
+          (*pCtx->szMapName ? pCtx->szMapName : "?"), prof.cTotal);
+  if (prof.cOther)
+    fprintf(pCtx->fo, " (%lu outside the map)", prof.cOther);
+  fputs("\n", pCtx->fo);
+
+  if (PrintProfileFunctions(&prof) &&
+      PrintProfileModules(&prof))
+    rtn = 1;
+  fputs("\n", pCtx->fo);
+
+  FreeProfile(&prof);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Read every sample file, then sort & attribute the samples. */
+
+int     LoadProfile(PROFILE * pProf, REMAPCTX * pCtx)
+{
+  int     ctr;
+  ULONG   base;
+  ULONG   cnt;
+
+  memset(pProf, 0, sizeof(PROFILE));
+  pProf->fo = pCtx->fo;
+
+  if (!BuildAddressTable(&pProf->tbl, pCtx->buffer))
+    return 0;
+
+  cnt = pProf->tbl.cSym + 2 * pProf->tbl.cMod + 2 * pProf->tbl.cSeg;
+  pProf->pSymHits = (ULONG*)calloc(cnt + 1, sizeof(ULONG));
+  if (!pProf->pSymHits) {
+    fprintf(stderr, "calloc failed for LoadProfile - bytes= %ld\n",
+            (cnt + 1) * sizeof(ULONG));
+    FreeAddressTable(&pProf->tbl);
+    return 0;
+  }
+  pProf->pModHits  = &pProf->pSymHits[pProf->tbl.cSym];
+  pProf->pModTotal = &pProf->pModHits[pProf->tbl.cMod];
+  pProf->pSegHits  = &pProf->pModTotal[pProf->tbl.cMod];
+  pProf->pSegBase  = &pProf->pSegHits[pProf->tbl.cSeg];
+
+  /* segments are loaded in order, each on a 64k boundary */
+  for (base = ulBase, ctr = 0; ctr < pProf->tbl.cSeg; ctr++) {
+    pProf->pSegBase[ctr] = base;
+    base += RecordLength(pProf->tbl.ppSeg[ctr]) + 0xFFFF;
+    base &= ~0xFFFF;
+  }
+
+  for (ctr = 0; ctr < cFiles; ctr++) {
+    if (!ReadSamples(pProf, apszFiles[ctr])) {
+      FreeProfile(pProf);
+      return 0;
+    }
+  }
+
+  qsort(pProf->pSample, pProf->cSample, sizeof(SAMPLE), SampleSorter);
+  AttributeSamples(pProf);
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    FreeProfile(PROFILE * pProf)
+{
+  if (pProf->pSample)
+    free(pProf->pSample);
+  if (pProf->pSymHits)
+    free(pProf->pSymHits);
+  FreeAddressTable(&pProf->tbl);
+  memset(pProf, 0, sizeof(PROFILE));
+
+  return;
+}
+
+/*****************************************************************************/
+
+int     ReadSamples(PROFILE * pProf, char * pFile)
+{
+  int     rtn = 1;
+  ULONG   line = 0;
+  ULONG   seg;
+  ULONG   offs;
+  ULONG   cnt;
+  FILE *  fp;
+  char *  pAddr;
+  char *  pCnt;
+  char *  pEnd;
+  char    szLine[256];
+
+  fp = fopen(pFile, "r");
+  if (!fp) {
+    fprintf(stderr, "unable to open sample file '%s'\n", pFile);
+    return 0;
+  }
+
+  while (fgets(szLine, sizeof(szLine), fp)) {
+    line++;
+
+    pAddr = Trim(szLine, &pCnt);
+    if (!pAddr || *pAddr == '#')
+      continue;
+
+    cnt = 1;
+    pCnt = Trim(pCnt, 0);
+    if (pCnt) {
+      cnt = strtoul(pCnt, &pEnd, 10);
+      if (*pEnd) {
+        fprintf(stderr, "%s(%lu): invalid count '%s'\n", pFile, line, pCnt);
+        continue;
+      }
+    }
+
+    if (strchr(pAddr, ':')) {
+      seg = strtoul(pAddr, &pEnd, 16);
+      if (*pEnd != ':') {
+        fprintf(stderr, "%s(%lu): invalid address '%s'\n", pFile, line, pAddr);
+        continue;
+      }
+      offs = strtoul(&pEnd[1], &pEnd, 16);
+    }
+    else {
+      offs = strtoul(pAddr, &pEnd, 16);
+      if (!LinearToSeg(pProf, offs, &seg, &offs))
+        seg = 0;
+    }
+
+    if (*pEnd) {
+      fprintf(stderr, "%s(%lu): invalid address '%s'\n", pFile, line, pAddr);
+      continue;
+    }
+
+    if (!AddSample(pProf, seg, offs, cnt)) {
+      rtn = 0;
+      break;
+    }
+  }
+
+  fclose(fp);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+
+int     AddSample(PROFILE * pProf, ULONG seg, ULONG offs, ULONG cnt)
+{
+  SAMPLE *  ps;
+
+  if (pProf->cSample >= pProf->cAlloc) {
+    ULONG   cAlloc = (pProf->cAlloc ? pProf->cAlloc * 2 : 0x4000);
+
+    ps = (SAMPLE*)realloc(pProf->pSample, cAlloc * sizeof(SAMPLE));
+    if (!ps) {
+      fprintf(stderr, "realloc failed for AddSample - bytes= %ld\n",
+              cAlloc * sizeof(SAMPLE));
+      return 0;
+    }
+    pProf->pSample = ps;
+    pProf->cAlloc  = cAlloc;
+  }
+
+  ps = &pProf->pSample[pProf->cSample++];
+  ps->seg  = seg;
+  ps->offs = offs;
+  ps->cnt  = cnt;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+int     LinearToSeg(PROFILE * pProf, ULONG addr, ULONG * pSeg, ULONG * pOffs)
+{
+  int     ctr;
+  REMAP * r;
+
+  for (ctr = 0; ctr < pProf->tbl.cSeg; ctr++) {
+    r = pProf->tbl.ppSeg[ctr];
+    if (addr >= pProf->pSegBase[ctr] &&
+        addr - pProf->pSegBase[ctr] < r->offs + RecordLength(r)) {
+      *pSeg  = r->seg;
+      *pOffs = addr - pProf->pSegBase[ctr];
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************/
+/* Walk the sorted samples & the sorted tables together.  Because both
+   are in address order, each table index only ever moves forward.
+*/
+
+void    AttributeSamples(PROFILE * pProf)
+{
+  ULONG     ctr;
+  int       iSym = 0;
+  int       iMod = 0;
+  int       iSeg = 0;
+  REMAP *   pSym;
+  REMAP *   pMod;
+  REMAP *   pSeg;
+  SAMPLE *  ps;
+  ADDRTBL * pTbl = &pProf->tbl;
+
+  for (ctr = 0, ps = pProf->pSample; ctr < pProf->cSample; ctr++, ps++) {
+
+    pProf->cTotal += ps->cnt;
+
+    pSym = MergeFind(pTbl->ppSym, pTbl->cSym, &iSym, ps->seg, ps->offs);
+    pMod = MergeFind(pTbl->ppMod, pTbl->cMod, &iMod, ps->seg, ps->offs);
+    pSeg = MergeFind(pTbl->ppSeg, pTbl->cSeg, &iSeg, ps->seg, ps->offs);
+
+    if (pMod && ps->offs - pMod->offs >= RecordLength(pMod))
+      pMod = 0;
+    if (pSeg && ps->offs - pSeg->offs >= RecordLength(pSeg))
+      pSeg = 0;
+
+    /* a public that precedes the sample's module belongs to
+       another module, so the sample must be in a static function */
+    if (pSym && pMod && pSym->offs < pMod->offs)
+      pSym = 0;
+
+    if (pMod)
+      pProf->pModTotal[iMod - 1] += ps->cnt;
+
+    if (pSym && (pMod || pSeg))
+      pProf->pSymHits[iSym - 1] += ps->cnt;
+    else
+    if (pMod)
+      pProf->pModHits[iMod - 1] += ps->cnt;
+    else
+    if (pSeg)
+      pProf->pSegHits[iSeg - 1] += ps->cnt;
+    else
+      pProf->cOther += ps->cnt;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Publics with hits, plus the unnamed code in modules & segments. */
+
+int     PrintProfileFunctions(PROFILE * pProf)
+{
+  int       ctr;
+  int       cRow = 0;
+  PROFROW * pRow;
+  ADDRTBL * pTbl = &pProf->tbl;
+
+  pRow = (PROFROW*)malloc((pTbl->cSym + pTbl->cMod + pTbl->cSeg + 1) *
+                          sizeof(PROFROW));
+  if (!pRow) {
+    fprintf(stderr, "malloc failed for PrintProfileFunctions\n");
+    return 0;
+  }
+
+  for (ctr = 0; ctr < pTbl->cSym; ctr++) {
+    if (pProf->pSymHits[ctr]) {
+      pRow[cRow].hits    = pProf->pSymHits[ctr];
+      pRow[cRow].pPrefix = "";
+      pRow[cRow].pName   = RecordName(pTbl->ppSym[ctr]);
+      pRow[cRow].pSuffix = DecodeFlagName(RecordType(pTbl->ppSym[ctr]));
+      cRow++;
+    }
+  }
+
+  /* unnamed code is shown as [module] or {segment} */
+  for (ctr = 0; ctr < pTbl->cMod; ctr++) {
+    if (pProf->pModHits[ctr]) {
+      pRow[cRow].hits    = pProf->pModHits[ctr];
+      pRow[cRow].pPrefix = "[";
+      pRow[cRow].pName   = strchr(pTbl->ppMod[ctr]->text, 0) + 1;
+      pRow[cRow].pSuffix = "]";
+      cRow++;
+    }
+  }
+
+  for (ctr = 0; ctr < pTbl->cSeg; ctr++) {
+    if (pProf->pSegHits[ctr]) {
+      pRow[cRow].hits    = pProf->pSegHits[ctr];
+      pRow[cRow].pPrefix = "{";
+      pRow[cRow].pName   = strchr(pTbl->ppSeg[ctr]->text, 0) + 1;
+      pRow[cRow].pSuffix = "}";
+      cRow++;
+    }
+  }
+
+  PrintProfileRows(pProf, "Functions", pRow, cRow);
+  free(pRow);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* An object module may contribute to several segments, so its totals are
+   combined by name.  Libraries are combined the same way.
+*/
+
+int     PrintProfileModules(PROFILE * pProf)
+{
+  int       ctr;
+  int       cRow;
+  int       rtn = 0;
+  char *    pSrc;
+  char *    pLib;
+  HASHENT * pEnt;
+  HASHENT** ppArr = 0;
+  PROFROW * pRow = 0;
+  HASHTBL   hashMod;
+  HASHTBL   hashLib;
+  char      szKey[CCHMAXPATH * 2];
+
+  memset(&hashMod, 0, sizeof(hashMod));
+  memset(&hashLib, 0, sizeof(hashLib));
+
+do {
+  if (!HashInit(&hashMod, pProf->tbl.cMod, sizeof(ULONG)) ||
+      !HashInit(&hashLib, 64, sizeof(ULONG)))
+    break;
+
+  for (ctr = 0; ctr < pProf->tbl.cMod; ctr++) {
+    if (!pProf->pModTotal[ctr])
+      continue;
+
+    pSrc = strchr(pProf->tbl.ppMod[ctr]->text, 0) + 1;
+    pLib = strchr(pSrc, 0) + 1;
+
+    sprintf(szKey, "%.*s  (%.*s)", CCHMAXPATH - 1, pSrc, CCHMAXPATH - 1, pLib);
+    pEnt = HashFind(&hashMod, szKey, 1);
+    if (!pEnt)
+      break;
+    *(ULONG*)pEnt->pv += pProf->pModTotal[ctr];
+
+    pEnt = HashFind(&hashLib, pLib, 1);
+    if (!pEnt)
+      break;
+    *(ULONG*)pEnt->pv += pProf->pModTotal[ctr];
+  }
+  if (ctr < pProf->tbl.cMod)
+    break;
+
+  pRow = (PROFROW*)malloc((hashMod.cEnt + hashLib.cEnt + 1) * sizeof(PROFROW));
+  if (!pRow) {
+    fprintf(stderr, "malloc failed for PrintProfileModules\n");
+    break;
+  }
+
+  ppArr = HashToArray(&hashMod);
+  if (!ppArr)
+    break;
+  for (cRow = 0; ppArr[cRow]; cRow++) {
+    pRow[cRow].hits    = *(ULONG*)ppArr[cRow]->pv;
+    pRow[cRow].pPrefix = "";
+    pRow[cRow].pName   = ppArr[cRow]->key;
+    pRow[cRow].pSuffix = "";
+  }
+  PrintProfileRows(pProf, "Object modules", pRow, cRow);
+  free(ppArr);
+
+  ppArr = HashToArray(&hashLib);
+  if (!ppArr)
+    break;
+  for (cRow = 0; ppArr[cRow]; cRow++) {
+    pRow[cRow].hits    = *(ULONG*)ppArr[cRow]->pv;
+    pRow[cRow].pPrefix = "";
+    pRow[cRow].pName   = ppArr[cRow]->key;
+    pRow[cRow].pSuffix = "";
+  }
+  PrintProfileRows(pProf, "Libraries", pRow, cRow);
+
+  rtn = 1;
+
+} while (0);
+
+  if (ppArr)
+    free(ppArr);
+  if (pRow)
+    free(pRow);
+  HashFree(&hashMod);
+  HashFree(&hashLib);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+
+void    PrintProfileRows(PROFILE * pProf, char * pszTitle,
+                         PROFROW * pRow, int cRow)
+{
+  int     ctr;
+  ULONG   cum = 0;
+  double  total = (pProf->cTotal ? (double)pProf->cTotal : 1.0);
+
+  qsort(pRow, cRow, sizeof(PROFROW), ProfRowSorter);
+
+  if (cTop && (ULONG)cRow > cTop)
+    cRow = (int)cTop;
+
+  fprintf(pProf->fo, "\n %s\n\n", pszTitle);
+  fprintf(pProf->fo, "     Samples       %%   Cum %%  Name\n"
+                    "  ----------  ------  ------  ------------------------\n");
+
+  for (ctr = 0; ctr < cRow; ctr++, pRow++) {
+    cum += pRow->hits;
+    fprintf(pProf->fo, "  %10lu  %6.2f  %6.2f  %s%s%s\n",
+            pRow->hits, (pRow->hits * 100.0) / total, (cum * 100.0) / total,
+            pRow->pPrefix, pRow->pName, pRow->pSuffix);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* There's no call graph, so sample counts are the measure of how often
+   a function is called:  the hottest functions are listed first so the
+   code used most often ends up on the fewest pages.
+*/
+
+int     LinkOrder(REMAPCTX * pCtx)
+{
+  int       ctr;
+  int       cHot = 0;
+  int *     pHot = 0;
+  int *     pSeq = 0;
+  ULONG *   pSize = 0;
+  ULONG     cHits = 0;
+  ULONG     cbHot = 0;
+  ULONG     cbSeg = 0;
+  ULONG     cPagesNow;
+  ULONG     cPagesNew = 0;
+  REMAP *   r;
+  PROFILE   prof;
+
+  if (!LoadProfile(&prof, pCtx))
+    return 0;
+
+do {
+  pSize = InferSizes(&prof.tbl);
+  pHot  = (int*)malloc(2 * (prof.tbl.cSym + 1) * sizeof(int));
+  if (!pSize || !pHot) {
+    fprintf(stderr, "unable to allocate link order tables\n");
+    break;
+  }
+  pSeq = &pHot[prof.tbl.cSym + 1];
+
+  for (ctr = 0; ctr < prof.tbl.cSym; ctr++) {
+    if (prof.pSymHits[ctr])
+      pHot[cHot++] = ctr;
+  }
+
+  pHotProf = &prof;
+  qsort(pHot, cHot, sizeof(int), HotSorter);
+  if (cTop && (ULONG)cHot > cTop)
+    cHot = (int)cTop;
+
+  for (ctr = 0; ctr < cHot; ctr++) {
+    fprintf(pCtx->fo, "%s\n", prof.tbl.ppSym[pHot[ctr]]->text);
+    cHits += prof.pSymHits[pHot[ctr]];
+    cbHot += pSize[pHot[ctr]];
+  }
+
+  /* the current layout:  the pages the hot functions occupy in
+     address order (the index into ppSym is the address order) */
+  memcpy(pSeq, pHot, cHot * sizeof(int));
+  qsort(pSeq, cHot, sizeof(int), SeqSorter);
+  cPagesNow = CountPages(&prof, pSize, pSeq, cHot);
+
+  /* after reordering:  each segment's hot functions are packed together
+     at the start of the segment, which is always page-aligned */
+  for (ctr = 0; ctr < cHot; ctr++) {
+    r = prof.tbl.ppSym[pSeq[ctr]];
+    cbSeg += pSize[pSeq[ctr]];
+    if (ctr + 1 == cHot || prof.tbl.ppSym[pSeq[ctr + 1]]->seg != r->seg) {
+      cPagesNew += (cbSeg + 0xFFF) >> 12;
+      cbSeg = 0;
+    }
+  }
+
+  fprintf(stderr, " link order for %s:  %d functions, %lu bytes,"
+                  " %.1f%% of %lu samples\n",
+          (*pCtx->szMapName ? pCtx->szMapName : "?"), cHot, cbHot,
+          (prof.cTotal ? (cHits * 100.0) / prof.cTotal : 0.0), prof.cTotal);
+  fprintf(stderr, " 4k pages used by these functions:  now %lu,"
+                  "  after reordering %lu\n", cPagesNow, cPagesNew);
+  if (prof.cTotal - cHits)
+    fprintf(stderr, " %lu samples fall outside the listed functions\n",
+            prof.cTotal - cHits);
+
+} while (0);
+
+  if (pHot)
+    free(pHot);
+  if (pSize)
+    free(pSize);
+  FreeProfile(&prof);
+
+  return (pHot && pSize);
+}
+
+/*****************************************************************************/
+/* Count the distinct pages covered by a set of publics in address order.
+   Adjacent functions often share a page, so a page is only counted the
+   first time it's seen.
+*/
+
+ULONG   CountPages(PROFILE * pProf, ULONG * pSize, int * pNdx, int cNdx)
+{
+  int     ctr;
+  ULONG   cPages = 0;
+  ULONG   lastSeg = 0;
+  ULONG   lastPage = 0;
+  ULONG   first;
+  ULONG   last;
+  REMAP * r;
+
+  for (ctr = 0; ctr < cNdx; ctr++) {
+    r = pProf->tbl.ppSym[pNdx[ctr]];
+    first = r->offs >> 12;
+    last  = (r->offs + (pSize[pNdx[ctr]] ? pSize[pNdx[ctr]] - 1 : 0)) >> 12;
+
+    if (cPages && r->seg == lastSeg && first <= lastPage)
+      first = lastPage + 1;
+
+    if (first <= last) {
+      cPages += last - first + 1;
+      lastPage = last;
+    }
+    lastSeg = r->seg;
+  }
+
+  return cPages;
+}
+
+/*****************************************************************************/
+/* qsort callback for samples - by address */
+
+int     SampleSorter(const void *key, const void *element)
+{
+  SAMPLE *  pk = (SAMPLE*)key;
+  SAMPLE *  pe = (SAMPLE*)element;
+
+  if (pk->seg != pe->seg)
+    return (pk->seg < pe->seg ? -1 : 1);
+
+  if (pk->offs != pe->offs)
+    return (pk->offs < pe->offs ? -1 : 1);
+
+  return 0;
+}
+
+/*****************************************************************************/
+/* qsort callback for link order - most hits first, then by address */
+
+int     HotSorter(const void *key, const void *element)
+{
+  int     k = *(int*)key;
+  int     e = *(int*)element;
+
+  if (pHotProf->pSymHits[k] != pHotProf->pSymHits[e])
+    return (pHotProf->pSymHits[k] > pHotProf->pSymHits[e] ? -1 : 1);
+
+  return k - e;
+}
+
+/*****************************************************************************/
+/* qsort callback for indices into ppSym - by address */
+
+int     SeqSorter(const void *key, const void *element)
+{
+  return *(int*)key - *(int*)element;
+}
+
+/*****************************************************************************/
+/* qsort callback for listings - most hits first, then by name */
+
+int     ProfRowSorter(const void *key, const void *element)
+{
+  PROFROW * pk = (PROFROW*)key;
+  PROFROW * pe = (PROFROW*)element;
+
+  if (pk->hits != pe->hits)
+    return (pk->hits > pe->hits ? -1 : 1);
+
+  return strcmp(pk->pName, pe->pName);
+}
+
+/*****************************************************************************/
+
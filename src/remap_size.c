@@ -0,0 +1,758 @@
+/*****************************************************************************/
+/*  remap_size.c
+ *
+ *  Size report (--sizes).  Lists the largest functions, data items,
+ *  object modules, and libraries.
+ *
+ *  Module size report (--modsizes).  Totals the bytes each library & each
+ *  object module contributes to the code, data, & bss segments, as either
+ *  a table or comma-separated values.
+ *
+ *  Template report (--templates).  Groups the functions that are template
+ *  instantiations by their "shape" (the name with its template arguments
+ *  removed) & totals their sizes.  It also lists instantiations that were
+ *  defined in more than one object module.
+ *
+ *  Module & segment records carry their lengths but publics don't, so a
+ *  public's size is inferred from the address of the next public in the
+ *  same segment, bounded by the end of its module or segment.  This takes
+ *  one pass over the address-sorted publics.  Object modules that
+ *  contribute to several segments, and all the modules from a library,
+ *  are combined by name.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define SIZE_TOP_DEFAULT    20
+
+/* segment classes */
+#define CLASS_CODE          0
+#define CLASS_DATA          1
+#define CLASS_BSS           2
+#define CLASS_OTHER         3
+#define CLASS_CNT           4
+
+/* a line in one of the listings */
+typedef struct _sizerow {
+    ULONG   cb;
+    char *  pName;
+    char *  pSuffix;
+    REMAP * pRec;       /* a public's row is named when it's printed */
+} SIZEROW;
+
+/* a template shape, or an instantiation's full name */
+typedef struct _tmplsize {
+    ULONG   cnt;
+    ULONG   cb;
+    ULONG   cMods;      /* the number of modules that define it */
+} TMPLSIZE;
+
+/* the bytes a library or object module contributes to each class */
+typedef struct _modsize {
+    ULONG   acb[CLASS_CNT];
+    ULONG   cbTotal;
+    char *  pSrc;
+    char *  pLib;
+} MODSIZE;
+
+int     PrintSymbolSizes(REMAPCTX * pCtx, ADDRTBL * pTbl, ULONG * pSize);
+int     PrintModuleSizes(REMAPCTX * pCtx, ADDRTBL * pTbl);
+int     SegmentClass(REMAP * pSeg);
+void    PrintSizeRows(REMAPCTX * pCtx, char * pszTitle,
+                      SIZEROW * pRow, int cRow);
+int     SizeRowSorter(const void *key, const void *element);
+int     SizeOnlySorter(const void *key, const void *element);
+int     PrintModSizes(REMAPCTX * pCtx, char * pszTitle, char * pszKind,
+                      HASHTBL * pHash);
+void    PrintCsvString(REMAPCTX * pCtx, char * pStr);
+int     ModSizeSorter(const void *key, const void *element);
+REMAP * ContainingModule(ADDRTBL * pTbl, int * pNdx, REMAP * r);
+void    PrintShapes(REMAPCTX * pCtx, HASHTBL * pHash);
+void    PrintMultiModule(REMAPCTX * pCtx, HASHTBL * pHash);
+int     TmplSizeSorter(const void *key, const void *element);
+
+char *  pszModSizeHdr =
+        "        Code        Data         BSS       Other       Total  Name\n"
+        "  ----------  ----------  ----------  ----------  ----------  ------------------------\n";
+
+/*****************************************************************************/
+
+int     SizeReport(REMAPCTX * pCtx)
+{
+  int       rtn = 0;
+  ULONG *   pSize;
+  ADDRTBL   tbl;
+
+  if (!BuildAddressTable(&tbl, pCtx->buffer))
+    return 0;
+
+  pSize = InferSizes(&tbl);
+  if (pSize) {
+    fprintf(pCtx->fo, "\n Sizes for %s\n",
+            (*pCtx->szMapName ? pCtx->szMapName : "?"));
+
+    if (PrintSymbolSizes(pCtx, &tbl, pSize) &&
+        PrintModuleSizes(pCtx, &tbl))
+      rtn = 1;
+    fputs("\n", pCtx->fo);
+
+    free(pSize);
+  }
+
+  FreeAddressTable(&tbl);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Split the publics into functions (those in code segments) & data.
+   An export is skipped if there's a public at the same address since
+   they're the same item.
+*/
+
+int     PrintSymbolSizes(REMAPCTX * pCtx, ADDRTBL * pTbl, ULONG * pSize)
+{
+  int       ctr;
+  int       iSeg = 0;
+  int       cCode = 0;
+  int       cData = 0;
+  REMAP *   r;
+  REMAP *   pSeg;
+  SIZEROW * pRow;
+  SIZEROW * pRow2;
+
+  pRow = (SIZEROW*)malloc((pTbl->cSym + 1) * sizeof(SIZEROW));
+  if (!pRow) {
+    fprintf(stderr, "malloc failed for PrintSymbolSizes - bytes= %d\n",
+            (pTbl->cSym + 1) * sizeof(SIZEROW));
+    return 0;
+  }
+
+  /* code fills the array from the bottom, data from the top */
+  pRow2 = &pRow[pTbl->cSym];
+
+  for (ctr = 0; ctr < pTbl->cSym; ctr++) {
+    r = pTbl->ppSym[ctr];
+
+    if ((r->type & REMAP_EXP) && ctr + 1 < pTbl->cSym &&
+        pTbl->ppSym[ctr + 1]->seg == r->seg &&
+        pTbl->ppSym[ctr + 1]->offs == r->offs)
+      continue;
+
+    pSeg = MergeFind(pTbl->ppSeg, pTbl->cSeg, &iSeg, r->seg, r->offs);
+    if (SegmentClass(pSeg) == CLASS_CODE) {
+      pRow[cCode].cb      = pSize[ctr];
+      pRow[cCode].pName   = 0;
+      pRow[cCode].pSuffix = 0;
+      pRow[cCode].pRec    = r;
+      cCode++;
+    }
+    else {
+      cData++;
+      pRow2[-cData].cb      = pSize[ctr];
+      pRow2[-cData].pName   = 0;
+      pRow2[-cData].pSuffix = 0;
+      pRow2[-cData].pRec    = r;
+    }
+  }
+
+  PrintSizeRows(pCtx, "Functions", pRow, cCode);
+  PrintSizeRows(pCtx, "Data", &pRow2[-cData], cData);
+  free(pRow);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* The module records carry exact lengths. */
+
+int     PrintModuleSizes(REMAPCTX * pCtx, ADDRTBL * pTbl)
+{
+  int       ctr;
+  int       cRow;
+  int       rtn = 0;
+  ULONG     cb;
+  char *    pSrc;
+  char *    pLib;
+  HASHENT * pEnt;
+  HASHENT** ppArr = 0;
+  SIZEROW * pRow = 0;
+  HASHTBL   hashMod;
+  HASHTBL   hashLib;
+  char      szKey[CCHMAXPATH * 2];
+
+  memset(&hashMod, 0, sizeof(hashMod));
+  memset(&hashLib, 0, sizeof(hashLib));
+
+do {
+  if (!HashInit(&hashMod, pTbl->cMod, sizeof(ULONG)) ||
+      !HashInit(&hashLib, 64, sizeof(ULONG)))
+    break;
+
+  for (ctr = 0; ctr < pTbl->cMod; ctr++) {
+    cb   = RecordLength(pTbl->ppMod[ctr]);
+    pSrc = strchr(pTbl->ppMod[ctr]->text, 0) + 1;
+    pLib = strchr(pSrc, 0) + 1;
+
+    sprintf(szKey, "%.*s  (%.*s)", CCHMAXPATH - 1, pSrc, CCHMAXPATH - 1, pLib);
+    pEnt = HashFind(&hashMod, szKey, 1);
+    if (!pEnt)
+      break;
+    *(ULONG*)pEnt->pv += cb;
+
+    pEnt = HashFind(&hashLib, pLib, 1);
+    if (!pEnt)
+      break;
+    *(ULONG*)pEnt->pv += cb;
+  }
+  if (ctr < pTbl->cMod)
+    break;
+
+  pRow = (SIZEROW*)malloc((hashMod.cEnt + hashLib.cEnt + 1) * sizeof(SIZEROW));
+  if (!pRow) {
+    fprintf(stderr, "malloc failed for PrintModuleSizes\n");
+    break;
+  }
+
+  ppArr = HashToArray(&hashMod);
+  if (!ppArr)
+    break;
+  for (cRow = 0; ppArr[cRow]; cRow++) {
+    pRow[cRow].cb      = *(ULONG*)ppArr[cRow]->pv;
+    pRow[cRow].pName   = ppArr[cRow]->key;
+    pRow[cRow].pSuffix = "";
+    pRow[cRow].pRec    = 0;
+  }
+  PrintSizeRows(pCtx, "Object modules", pRow, cRow);
+  free(ppArr);
+
+  ppArr = HashToArray(&hashLib);
+  if (!ppArr)
+    break;
+  for (cRow = 0; ppArr[cRow]; cRow++) {
+    pRow[cRow].cb      = *(ULONG*)ppArr[cRow]->pv;
+    pRow[cRow].pName   = ppArr[cRow]->key;
+    pRow[cRow].pSuffix = "";
+    pRow[cRow].pRec    = 0;
+  }
+  PrintSizeRows(pCtx, "Libraries", pRow, cRow);
+
+  rtn = 1;
+
+} while (0);
+
+  if (ppArr)
+    free(ppArr);
+  if (pRow)
+    free(pRow);
+  HashFree(&hashMod);
+  HashFree(&hashLib);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* One pass over the records in map order:  each segment record is
+   followed by the records for the modules it contains, so the class
+   that applies to a module is always the most recent segment's.
+*/
+
+int     ModuleSizeReport(REMAPCTX * pCtx)
+{
+  int       cls = CLASS_OTHER;
+  int       rtn = 0;
+  ULONG     cb;
+  char *    pSrc;
+  char *    pLib;
+  REMAP *   r;
+  HASHENT * pEnt;
+  MODSIZE * pms;
+  HASHTBL   hashMod;
+  HASHTBL   hashLib;
+  char      szKey[CCHMAXPATH * 2];
+
+  memset(&hashMod, 0, sizeof(hashMod));
+  memset(&hashLib, 0, sizeof(hashLib));
+
+do {
+  if (!HashInit(&hashMod, 1024, sizeof(MODSIZE)) ||
+      !HashInit(&hashLib, 64, sizeof(MODSIZE)))
+    break;
+
+  for (r = (REMAP*)pCtx->buffer; r->next; r = r->next) {
+    if (r->type & REMAP_SEG) {
+      cls = SegmentClass(r);
+      continue;
+    }
+
+    if (!(r->type & REMAP_MOD))
+      continue;
+
+    cb   = RecordLength(r);
+    pSrc = strchr(r->text, 0) + 1;
+    pLib = strchr(pSrc, 0) + 1;
+
+    sprintf(szKey, "%.*s  (%.*s)", CCHMAXPATH - 1, pSrc, CCHMAXPATH - 1, pLib);
+    pEnt = HashFind(&hashMod, szKey, 1);
+    if (!pEnt)
+      break;
+    pms = (MODSIZE*)pEnt->pv;
+    pms->acb[cls] += cb;
+    pms->cbTotal += cb;
+    pms->pSrc = pSrc;
+    pms->pLib = pLib;
+
+    pEnt = HashFind(&hashLib, pLib, 1);
+    if (!pEnt)
+      break;
+    pms = (MODSIZE*)pEnt->pv;
+    pms->acb[cls] += cb;
+    pms->cbTotal += cb;
+    pms->pSrc = pLib;
+    pms->pLib = "";
+  }
+  if (r->next)
+    break;
+
+  if (opts & OPT_CSV)
+    fprintf(pCtx->fo, "kind,name,library,code,data,bss,other,total\n");
+  else
+    fprintf(pCtx->fo, "\n Module sizes for %s\n",
+            (*pCtx->szMapName ? pCtx->szMapName : "?"));
+
+  if (!PrintModSizes(pCtx, "Libraries", "library", &hashLib) ||
+      !PrintModSizes(pCtx, "Object modules", "object", &hashMod))
+    break;
+
+  if (!(opts & OPT_CSV))
+    fputs("\n", pCtx->fo);
+
+  rtn = 1;
+
+} while (0);
+
+  HashFree(&hashMod);
+  HashFree(&hashLib);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Print one table, largest first, followed by its totals. */
+
+int     PrintModSizes(REMAPCTX * pCtx, char * pszTitle, char * pszKind,
+                      HASHTBL * pHash)
+{
+  int       ctr;
+  int       cls;
+  int       cnt;
+  ULONG     cMax = (cTop ? cTop : 0xFFFFFFFF);
+  MODSIZE * pms;
+  HASHENT** ppArr;
+  MODSIZE   total;
+
+  ppArr = HashToArray(pHash);
+  if (!ppArr)
+    return 0;
+
+  cnt = (int)pHash->cEnt;
+  qsort(ppArr, cnt, sizeof(HASHENT*), ModSizeSorter);
+
+  memset(&total, 0, sizeof(total));
+  for (ctr = 0; ctr < cnt; ctr++) {
+    pms = (MODSIZE*)ppArr[ctr]->pv;
+    for (cls = 0; cls < CLASS_CNT; cls++)
+      total.acb[cls] += pms->acb[cls];
+    total.cbTotal += pms->cbTotal;
+  }
+
+  if (!(opts & OPT_CSV))
+    fprintf(pCtx->fo, "\n %s - %d items\n\n%s", pszTitle, cnt, pszModSizeHdr);
+
+  for (ctr = 0; ctr < cnt && (ULONG)ctr < cMax; ctr++) {
+    pms = (MODSIZE*)ppArr[ctr]->pv;
+
+    if (opts & OPT_CSV) {
+      fprintf(pCtx->fo, "%s,", pszKind);
+      PrintCsvString(pCtx, pms->pSrc);
+      fputc(',', pCtx->fo);
+      PrintCsvString(pCtx, pms->pLib);
+      fprintf(pCtx->fo, ",%lu,%lu,%lu,%lu,%lu\n",
+              pms->acb[CLASS_CODE], pms->acb[CLASS_DATA],
+              pms->acb[CLASS_BSS], pms->acb[CLASS_OTHER], pms->cbTotal);
+    }
+    else
+      fprintf(pCtx->fo, "  %10lu  %10lu  %10lu  %10lu  %10lu  %s\n",
+              pms->acb[CLASS_CODE], pms->acb[CLASS_DATA],
+              pms->acb[CLASS_BSS], pms->acb[CLASS_OTHER], pms->cbTotal,
+              ppArr[ctr]->key);
+  }
+
+  if (!(opts & OPT_CSV))
+    fprintf(pCtx->fo, "  ----------  ----------  ----------  ----------  ----------\n"
+                      "  %10lu  %10lu  %10lu  %10lu  %10lu  total\n",
+            total.acb[CLASS_CODE], total.acb[CLASS_DATA],
+            total.acb[CLASS_BSS], total.acb[CLASS_OTHER], total.cbTotal);
+
+  free(ppArr);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Quote a field, doubling any embedded quotes. */
+
+void    PrintCsvString(REMAPCTX * pCtx, char * pStr)
+{
+  fputc('"', pCtx->fo);
+  for (; *pStr; pStr++) {
+    if (*pStr == '"')
+      fputc('"', pCtx->fo);
+    fputc(*pStr, pCtx->fo);
+  }
+  fputc('"', pCtx->fo);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Segment records are "length\0name\0class".  Classes are identified by
+   the usual keywords;  e.g. both "DATA" & "CONST" are data.
+*/
+
+int     SegmentClass(REMAP * pSeg)
+{
+  char *  pClass;
+
+  if (!pSeg)
+    return CLASS_OTHER;
+
+  pClass = strchr(strchr(pSeg->text, 0) + 1, 0) + 1;
+
+  if (strstr(pClass, "CODE"))
+    return CLASS_CODE;
+
+  if (strstr(pClass, "BSS"))
+    return CLASS_BSS;
+
+  if (strstr(pClass, "DATA") || strstr(pClass, "CONST"))
+    return CLASS_DATA;
+
+  return CLASS_OTHER;
+}
+
+/*****************************************************************************/
+/* Print the largest rows along with their share of the listing's total.
+   Publics are sorted by size first so only the ones that may be printed -
+   those at least as large as the last one that fits - have to be named.
+*/
+
+void    PrintSizeRows(REMAPCTX * pCtx, char * pszTitle,
+                      SIZEROW * pRow, int cRow)
+{
+  int     ctr;
+  int     cSort = cRow;
+  ULONG   cTotal = 0;
+  ULONG   cMax = (cTop ? cTop : SIZE_TOP_DEFAULT);
+
+  for (ctr = 0; ctr < cRow; ctr++)
+    cTotal += pRow[ctr].cb;
+
+  if (cRow && pRow->pRec) {
+    qsort(pRow, cRow, sizeof(SIZEROW), SizeOnlySorter);
+    if ((ULONG)cRow > cMax) {
+      for (cSort = (int)cMax;
+           cSort < cRow && pRow[cSort].cb == pRow[cMax - 1].cb; cSort++)
+        ;
+    }
+
+    for (ctr = 0; ctr < cSort; ctr++) {
+      pRow[ctr].pName   = RecordName(pRow[ctr].pRec);
+      pRow[ctr].pSuffix = DecodeFlagName(RecordType(pRow[ctr].pRec));
+    }
+  }
+
+  qsort(pRow, cSort, sizeof(SIZEROW), SizeRowSorter);
+
+  fprintf(pCtx->fo, "\n %s - %d items, %lu bytes\n\n", pszTitle, cRow, cTotal);
+  fprintf(pCtx->fo, "       Bytes       %%  Name\n"
+                    "  ----------  ------  ------------------------\n");
+
+  for (ctr = 0; ctr < cRow && (ULONG)ctr < cMax; ctr++, pRow++) {
+    fprintf(pCtx->fo, "  %10lu  %6.2f  %s%s\n", pRow->cb,
+            (cTotal ? (pRow->cb * 100.0) / cTotal : 0.0),
+            pRow->pName, pRow->pSuffix);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* qsort callback for listings - largest first, then by name */
+
+int     SizeRowSorter(const void *key, const void *element)
+{
+  SIZEROW * pk = (SIZEROW*)key;
+  SIZEROW * pe = (SIZEROW*)element;
+
+  if (pk->cb != pe->cb)
+    return (pk->cb > pe->cb ? -1 : 1);
+
+  return strcmp(pk->pName, pe->pName);
+}
+
+/*****************************************************************************/
+/* qsort callback for publics that haven't been named yet - largest first */
+
+int     SizeOnlySorter(const void *key, const void *element)
+{
+  ULONG   kcb = ((SIZEROW*)key)->cb;
+  ULONG   ecb = ((SIZEROW*)element)->cb;
+
+  return (kcb == ecb ? 0 : (kcb > ecb ? -1 : 1));
+}
+
+/*****************************************************************************/
+/* qsort callback for module sizes - largest first, then by name */
+
+int     ModSizeSorter(const void *key, const void *element)
+{
+  HASHENT * pk = *(HASHENT**)key;
+  HASHENT * pe = *(HASHENT**)element;
+  ULONG     kcb = ((MODSIZE*)pk->pv)->cbTotal;
+  ULONG     ecb = ((MODSIZE*)pe->pv)->cbTotal;
+
+  if (kcb != ecb)
+    return (kcb > ecb ? -1 : 1);
+
+  return strcmp(pk->key, pe->key);
+}
+
+/*****************************************************************************/
+/* Instantiations are collected on one pass over the address-sorted
+   publics in code segments:  each one is added to the totals for its
+   shape, & to a table of full names which tracks how many modules
+   define it.  A third table holds one entry for each name in each
+   module so a module isn't counted twice.
+*/
+
+int     TemplateReport(REMAPCTX * pCtx)
+{
+  int       ctr;
+  int       iSeg = 0;
+  int       iMod = 0;
+  int       rtn = 0;
+  ULONG *   pSize = 0;
+  REMAP *   r;
+  REMAP *   pMod;
+  HASHENT * pEnt;
+  TMPLSIZE* pts;
+  ADDRTBL   tbl;
+  HASHTBL   hashShape;
+  HASHTBL   hashName;
+  HASHTBL   hashPair;
+  char      szKey[1280];
+  char      szShape[1024];
+
+  memset(&hashShape, 0, sizeof(hashShape));
+  memset(&hashName, 0, sizeof(hashName));
+  memset(&hashPair, 0, sizeof(hashPair));
+
+  if (!BuildAddressTable(&tbl, pCtx->buffer))
+    return 0;
+
+do {
+  pSize = InferSizes(&tbl);
+  if (!pSize)
+    break;
+
+  if (!HashInit(&hashShape, 1024, sizeof(TMPLSIZE)) ||
+      !HashInit(&hashName, tbl.cSym / 4, sizeof(TMPLSIZE)) ||
+      !HashInit(&hashPair, tbl.cSym / 4, 0))
+    break;
+
+  for (ctr = 0; ctr < tbl.cSym; ctr++) {
+    r = tbl.ppSym[ctr];
+
+    /* keep track of the segment & module even if this public is skipped */
+    pMod = ContainingModule(&tbl, &iMod, r);
+    if (!(r->type & REMAP_OBJ) ||
+        SegmentClass(MergeFind(tbl.ppSeg, tbl.cSeg, &iSeg,
+                               r->seg, r->offs)) != CLASS_CODE)
+      continue;
+
+    if (!TemplateShape(r->text, szShape, sizeof(szShape)))
+      continue;
+
+    pEnt = HashFind(&hashShape, szShape, 1);
+    if (!pEnt)
+      break;
+    pts = (TMPLSIZE*)pEnt->pv;
+    pts->cnt++;
+    pts->cb += pSize[ctr];
+
+    sprintf(szKey, "%.*s%s", 1200, r->text, DecodeFlagName(r->type));
+    pEnt = HashFind(&hashName, szKey, 1);
+    if (!pEnt)
+      break;
+    pts = (TMPLSIZE*)pEnt->pv;
+    pts->cnt++;
+    pts->cb += pSize[ctr];
+
+    /* the name's module count only changes if this pair is new */
+    if (pMod) {
+      ULONG   cEnt = hashPair.cEnt;
+
+      sprintf(szKey, "%p\t%.*s", (void*)pMod, 1200, r->text);
+      if (!HashFind(&hashPair, szKey, 1))
+        break;
+      if (hashPair.cEnt != cEnt)
+        pts->cMods++;
+    }
+  }
+  if (ctr < tbl.cSym)
+    break;
+
+  fprintf(pCtx->fo, "\n Template instantiations for %s\n",
+          (*pCtx->szMapName ? pCtx->szMapName : "?"));
+
+  PrintShapes(pCtx, &hashShape);
+  PrintMultiModule(pCtx, &hashName);
+  fputs("\n", pCtx->fo);
+
+  rtn = 1;
+
+} while (0);
+
+  HashFree(&hashShape);
+  HashFree(&hashName);
+  HashFree(&hashPair);
+  if (pSize)
+    free(pSize);
+  FreeAddressTable(&tbl);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Return the module whose range includes this public, if any. */
+
+REMAP * ContainingModule(ADDRTBL * pTbl, int * pNdx, REMAP * r)
+{
+  REMAP * pMod;
+
+  pMod = MergeFind(pTbl->ppMod, pTbl->cMod, pNdx, r->seg, r->offs);
+  if (pMod && r->offs - pMod->offs < RecordLength(pMod))
+    return pMod;
+
+  return 0;
+}
+
+/*****************************************************************************/
+
+void    PrintShapes(REMAPCTX * pCtx, HASHTBL * pHash)
+{
+  int       ctr;
+  int       cnt;
+  ULONG     cInst = 0;
+  ULONG     cbTotal = 0;
+  ULONG     cMax = (cTop ? cTop : 0xFFFFFFFF);
+  TMPLSIZE* pts;
+  HASHENT** ppArr;
+
+  ppArr = HashToArray(pHash);
+  if (!ppArr)
+    return;
+
+  cnt = (int)pHash->cEnt;
+  qsort(ppArr, cnt, sizeof(HASHENT*), TmplSizeSorter);
+
+  for (ctr = 0; ctr < cnt; ctr++) {
+    pts = (TMPLSIZE*)ppArr[ctr]->pv;
+    cInst += pts->cnt;
+    cbTotal += pts->cb;
+  }
+
+  fprintf(pCtx->fo, "\n Shapes - %d shapes, %lu instances, %lu bytes\n\n",
+          cnt, cInst, cbTotal);
+  fprintf(pCtx->fo, "   Instances       Bytes     Average  Shape\n"
+                    "  ----------  ----------  ----------  ------------------------\n");
+
+  for (ctr = 0; ctr < cnt && (ULONG)ctr < cMax; ctr++) {
+    pts = (TMPLSIZE*)ppArr[ctr]->pv;
+    fprintf(pCtx->fo, "  %10lu  %10lu  %10lu  %s\n",
+            pts->cnt, pts->cb, pts->cb / pts->cnt, ppArr[ctr]->key);
+  }
+
+  free(ppArr);
+
+  return;
+}
+
+/*****************************************************************************/
+/* List the instantiations defined by more than one module. */
+
+void    PrintMultiModule(REMAPCTX * pCtx, HASHTBL * pHash)
+{
+  int       ctr;
+  int       cnt;
+  int       cMulti = 0;
+  ULONG     cMax = (cTop ? cTop : 0xFFFFFFFF);
+  TMPLSIZE* pts;
+  HASHENT** ppArr;
+
+  ppArr = HashToArray(pHash);
+  if (!ppArr)
+    return;
+
+  /* move the entries of interest to the front, then sort them */
+  for (ctr = 0, cnt = (int)pHash->cEnt; ctr < cnt; ctr++) {
+    if (((TMPLSIZE*)ppArr[ctr]->pv)->cMods > 1)
+      ppArr[cMulti++] = ppArr[ctr];
+  }
+  qsort(ppArr, cMulti, sizeof(HASHENT*), TmplSizeSorter);
+
+  fprintf(pCtx->fo, "\n Defined in more than one module - %d instantiations\n\n",
+          cMulti);
+  fprintf(pCtx->fo, "     Modules   Instances       Bytes  Name\n"
+                    "  ----------  ----------  ----------  ------------------------\n");
+
+  for (ctr = 0; ctr < cMulti && (ULONG)ctr < cMax; ctr++) {
+    pts = (TMPLSIZE*)ppArr[ctr]->pv;
+    fprintf(pCtx->fo, "  %10lu  %10lu  %10lu  %s\n",
+            pts->cMods, pts->cnt, pts->cb, ppArr[ctr]->key);
+  }
+
+  free(ppArr);
+
+  return;
+}
+
+/*****************************************************************************/
+/* qsort callback for templates - largest total first, then by name */
+
+int     TmplSizeSorter(const void *key, const void *element)
+{
+  HASHENT * pk = *(HASHENT**)key;
+  HASHENT * pe = *(HASHENT**)element;
+  ULONG     kcb = ((TMPLSIZE*)pk->pv)->cb;
+  ULONG     ecb = ((TMPLSIZE*)pe->pv)->cb;
+
+  if (kcb != ecb)
+    return (kcb > ecb ? -1 : 1);
+
+  return strcmp(pk->key, pe->key);
+}
+
+/*****************************************************************************/
+
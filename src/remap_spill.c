@@ -0,0 +1,830 @@
+/*****************************************************************************/
+/*  remap_spill.c
+ *
+ *  Listings sorted in pieces (--max-memory).  Normally, every record is
+ *  kept in a buffer about the size of the map & sorted in place, which
+ *  needs more memory than a 32-bit process may have for the largest maps.
+ *  When a listing would need more than the limit, records are collected
+ *  in a smaller buffer;  each time it fills, its contents are sorted and
+ *  written to a temporary file as a "run".  The listing by address is
+ *  then produced by merging the runs, which also drops the duplicates
+ *  from reading both listings of publics.  The records that belong in
+ *  the listing by name are collected, sorted, & merged the same way.
+ *
+ *  The output is the same as the in-memory listing's.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+/* the largest record:  a symbol & its import name */
+#define CB_MAXREC       (sizeof(REMAP) + CB_MAXNAME + 1024)
+#define CB_RUNBLKMIN    0x1000
+#define CB_RUNBLKMAX    0x10000
+#define SPILL_MIN_MB    2
+#define SPILL_MAX_MB    2048
+
+/* the C runtime's file offsets are signed 32-bit values, so a new
+   temporary file is started before one grows past 2gb */
+#define SPILL_FILEMAX   0x7FFFFFFF
+
+/* a sorted run's location */
+typedef struct _run {
+    FILE *  fp;
+    ULONG   offStart;
+    ULONG   offEnd;
+    ULONG   cbMaxRec;   /* its largest record */
+} RUN;
+
+typedef struct _runfile {
+    FILE *  fp;         /* the file new runs are added to */
+    RUN *   pRun;
+    int     cRun;
+    int     cAlloc;
+} RUNFILE;
+
+typedef struct _spill {
+    ULONG   cbLimit;
+    unsigned long long  cRecs;  /* records written to the address runs */
+    RUNFILE addr;       /* all records, by address */
+    RUNFILE name;       /* the listing by name's records */
+} SPILL;
+
+/* reads one run a block at a time;  pRec is the record at its head */
+typedef struct _cursor {
+    FILE *  fp;
+    ULONG   off;        /* next unread byte in the file */
+    ULONG   offEnd;
+    char *  pBuf;
+    ULONG   cbBuf;
+    ULONG   cbData;
+    ULONG   iData;
+    ULONG   cbRec;
+    ULONG   cbSlot;     /* room for pRec:  the run's largest record */
+    REMAP * pRec;
+    int     fErr;
+} CURSOR;
+
+typedef int SORTFN(const void *key, const void *element);
+
+typedef struct _merge {
+    CURSOR *  pCur;
+    int *     pHeap;    /* indices of the cursors that have a record */
+    int       cHeap;
+    int       cCur;
+    SORTFN *  pfnSort;
+} MERGE;
+
+int     GrowRecords(REMAPCTX * pCtx, ULONG cbNeed);
+int     WriteRun(RUNFILE * pFile, REMAP * pFirst, int cnt, SORTFN * pfnSort);
+int     MergeInit(MERGE * pm, RUNFILE * pFile, SORTFN * pfnSort, ULONG cbMem);
+REMAP * MergeFirst(MERGE * pm, ULONG * pcb);
+int     MergeNext(MERGE * pm);
+int     MergeDone(MERGE * pm);
+void    HeapDown(MERGE * pm, int ndx);
+int     CursorNext(CURSOR * pc);
+int     CursorRead(CURSOR * pc, void * pv, ULONG cb);
+int     AddNameRecord(REMAPCTX * pCtx, REMAP * r, ULONG cb);
+void    CloseRunFile(RUNFILE * pFile);
+int     RunSorter(const void *key, const void *element);
+
+ULONG   cMaxMemMB = 0;
+
+/*****************************************************************************/
+/* Decide whether a map's listing fits in --max-memory.  The in-memory path
+   needs a buffer the size of the map plus an array of pointers to its
+   records.  If that's too much, the buffer gets two thirds of the limit;
+   the rest is for sorting its records & for reading the runs back.
+*/
+
+int     SpillInit(REMAPCTX * pCtx, ULONG * pcbBuf)
+{
+  ULONG   cbLimit;
+  SPILL * pSpill;
+
+  if (!cMaxMemMB || (opts & (OPT_REPORTS | OPT_DEMANGLE_ONLY | OPT_BENCH)))
+    return 1;
+
+  if (cMaxMemMB < SPILL_MIN_MB)
+    cMaxMemMB = SPILL_MIN_MB;
+  if (cMaxMemMB > SPILL_MAX_MB)
+    cMaxMemMB = SPILL_MAX_MB;
+  cbLimit = cMaxMemMB << 20;
+
+  if (pCtx->cbMap + pCtx->cbMap / 4 <= cbLimit)
+    return 1;
+
+  pSpill = (SPILL*)calloc(1, sizeof(SPILL));
+  if (!pSpill) {
+    fprintf(stderr, "malloc failed for SpillInit\n");
+    return 0;
+  }
+
+  pSpill->cbLimit = cbLimit;
+  pCtx->pSpill = pSpill;
+
+  *pcbBuf = cbLimit / 3 * 2;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Return where the next record goes.  If the buffer can't hold another
+   record of the largest size, plus the empty one that ends the chain,
+   its records are written out first or, in memory, the buffer grows.
+*/
+
+REMAP * NextRecord(REMAPCTX * pCtx)
+{
+  ULONG   cbNeed = CB_MAXREC + sizeof(REMAP);
+
+  if (pCtx->pCur + cbNeed > pCtx->buffer + pCtx->cbBuffer) {
+    if (pCtx->pSpill) {
+      if (!SpillRecords(pCtx))
+        return 0;
+    }
+    else
+    if (!GrowRecords(pCtx, cbNeed))
+      return 0;
+  }
+
+  return (REMAP*)pCtx->pCur;
+}
+
+/*****************************************************************************/
+/* Return the room for the name in a record from NextRecord().  Room is
+   kept for a second name as long as an input line;  a name that won't
+   fit is stored mangled rather than overrunning the record.  Records
+   sorted in pieces get the same room, so the listing is the same.
+*/
+
+ULONG   RecordSpace(REMAPCTX * pCtx, REMAP * r)
+{
+  return CB_MAXNAME;
+}
+
+/*****************************************************************************/
+/* The buffer starts out the size of the map, which is usually more than
+   its records need;  demangled names can outgrow it, though.  The records
+   are chained by address, so the chain is moved along with them.
+*/
+
+int     GrowRecords(REMAPCTX * pCtx, ULONG cbNeed)
+{
+  ULONG   cbOld = pCtx->cbBuffer;
+  ULONG   cbNew;
+  char *  pOld = pCtx->buffer;
+  char *  pNew;
+  REMAP * pRec;
+
+  cbNew = cbOld + cbOld / 4 + cbNeed;
+  if (cbNew > CB_BUFMAX)
+    cbNew = CB_BUFMAX;
+  if (pCtx->pCur + cbNeed > pOld + cbNew) {
+    fprintf(stderr, "'%s' is too large to read into memory\n", pCtx->fIn);
+    return 0;
+  }
+
+  pNew = (char*)realloc(pOld, cbNew);
+  if (!pNew) {
+    fprintf(stderr, "realloc for main buffer failed - size= %ld\n", cbNew);
+    return 0;
+  }
+  memset(pNew + cbOld, 0, cbNew - cbOld);
+  MEMADD(MEM_RECORDS, cbNew - cbOld);
+
+  if (pNew != pOld) {
+    for (pRec = (REMAP*)pNew; pRec->next; pRec = pRec->next)
+      pRec->next = (REMAP*)(pNew + ((char*)pRec->next - pOld));
+    pCtx->pCur = pNew + (pCtx->pCur - pOld);
+  }
+  pCtx->buffer = pNew;
+  pCtx->cbBuffer = cbNew;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Sort the records in the buffer, add them to the runs, then empty it. */
+
+int     SpillRecords(REMAPCTX * pCtx)
+{
+  int     rtn;
+  SPILL * pSpill = pCtx->pSpill;
+
+  if (!pCtx->recCnt)
+    return 1;
+
+  if (pCtx->pStats)
+    StatsRecords(pCtx);
+
+  STATSBEGIN(pCtx, PH_SPILL);
+  rtn = WriteRun(&pSpill->addr, (REMAP*)pCtx->buffer,
+                 pCtx->recCnt, RunSorter);
+  STATSEND(pCtx, PH_SPILL);
+  if (!rtn)
+    return 0;
+
+  pSpill->cRecs += pCtx->recCnt;
+  pCtx->recCnt = 0;
+
+  memset(pCtx->buffer, 0, pCtx->pCur - pCtx->buffer + sizeof(REMAP));
+  pCtx->pCur = pCtx->buffer;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Print the listing by address from the merged runs.  A record that's
+   identical to the one before it is a duplicate & is skipped.  An object
+   module's public that's also exported is hidden just as AddressSorter()
+   hides it;  the exports sort ahead of the publics at the same address.
+*/
+
+int     MergeByAddress(REMAPCTX * pCtx)
+{
+  int       rtn = 0;
+  int       fExp = 0;
+  ULONG     cb;
+  ULONG     expSeg = 0;
+  ULONG     expOffs = 0;
+  REMAP *   r;
+  REMAP *   pPend = 0;
+  REMAP *   pSpare;
+  char *    pSlots;
+  MERGE     merge;
+  LISTSTATE state;
+  SPILL *   pSpill = pCtx->pSpill;
+
+  if (!pSpill->cRecs) {
+    fprintf(stderr, "no records to sort\n");
+    return 0;
+  }
+
+  /* one slot holds the record waiting to be printed, the other the next */
+  pSlots = (char*)malloc(2 * CB_MAXREC);
+  if (!pSlots) {
+    fprintf(stderr, "malloc failed for MergeByAddress\n");
+    return 0;
+  }
+  MEMADD(MEM_RECORDS, 2 * CB_MAXREC);
+  pSpare = (REMAP*)pSlots;
+
+  if (!MergeInit(&merge, &pSpill->addr, RunSorter, pSpill->cbLimit / 6)) {
+    free(pSlots);
+    MEMADD(MEM_RECORDS, -(long)(2 * CB_MAXREC));
+    return 0;
+  }
+
+  memset(&state, 0, sizeof(state));
+  fputs(pszAddressHdr, pCtx->fo);
+  fputs(pszColumnHdr, pCtx->fo);
+
+  for (r = MergeFirst(&merge, &cb); r; r = MergeFirst(&merge, &cb)) {
+
+    if (pPend && !RunSorter(&r, &pPend)) {
+      if (!MergeNext(&merge))
+        break;
+      continue;
+    }
+
+    if (r->type & REMAP_EXP) {
+      fExp = 1;
+      expSeg = r->seg;
+      expOffs = r->offs;
+    }
+    else
+    if ((r->type & REMAP_OBJ) && fExp &&
+        r->seg == expSeg && r->offs == expOffs)
+      r->type |= REMAP_DUP;
+
+    if (pPend)
+      PrintAddressEntry(pCtx, pPend, r, &state);
+
+    memcpy(pSpare, r, cb);
+    r = pSpare;
+    pSpare = (pPend ? pPend : (REMAP*)(pSlots + CB_MAXREC));
+    pPend = r;
+
+    if ((r->type & (REMAP_IMP | REMAP_EXP | REMAP_EPT)) ||
+        (r->type & (REMAP_OBJ | REMAP_DUP)) == REMAP_OBJ) {
+      if (!AddNameRecord(pCtx, r, cb))
+        break;
+    }
+
+    if (!MergeNext(&merge))
+      break;
+  }
+
+  if (MergeDone(&merge) && !r) {
+    if (pPend)
+      PrintAddressEntry(pCtx, pPend, 0, &state);
+    PrintLegend(pCtx);
+    rtn = 1;
+  }
+
+  free(pSlots);
+  MEMADD(MEM_RECORDS, -(long)(2 * CB_MAXREC));
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Print the listing by name.  If its records all fit in the buffer,
+   they're sorted there;  otherwise, the runs are merged.
+*/
+
+int     MergeByName(REMAPCTX * pCtx)
+{
+  ULONG   cb;
+  REMAP * r;
+  REMAP** pr;
+  REMAP** pArr;
+  REMAP * pRec;
+  MERGE   merge;
+  SPILL * pSpill = pCtx->pSpill;
+
+  if (!pSpill->name.cRun) {
+    pr = (REMAP**)malloc((pCtx->recCnt + 1) * sizeof(REMAP*));
+    if (!pr) {
+      fprintf(stderr, "malloc failed for MergeByName - bytes= %d\n",
+              pCtx->recCnt * sizeof(REMAP*));
+      return 0;
+    }
+    MEMADD(MEM_SORT, (pCtx->recCnt + 1) * sizeof(REMAP*));
+
+    pArr = pr;
+    for (pRec = (REMAP*)pCtx->buffer; pRec->next; pRec = pRec->next)
+      *pArr++ = pRec;
+    *pArr = 0;
+
+    qsort(pr, pCtx->recCnt, sizeof(REMAP*), NameSorter);
+    PrintByName(pCtx, pr);
+    free(pr);
+    MEMADD(MEM_SORT, -(long)((pCtx->recCnt + 1) * sizeof(REMAP*)));
+
+    return 1;
+  }
+
+  if (pCtx->recCnt &&
+      !WriteRun(&pSpill->name, (REMAP*)pCtx->buffer,
+                pCtx->recCnt, NameSorter))
+    return 0;
+
+  /* the buffer isn't needed any more */
+  free(pCtx->buffer);
+  MEMADD(MEM_RECORDS, -(long)pCtx->cbBuffer);
+  pCtx->buffer = 0;
+  pCtx->pCur = 0;
+  pCtx->recCnt = 0;
+
+  if (!MergeInit(&merge, &pSpill->name, NameSorter, pSpill->cbLimit))
+    return 0;
+
+  fputs(pszNameHdr, pCtx->fo);
+  fputs(pszColumnHdr, pCtx->fo);
+
+  for (r = MergeFirst(&merge, &cb); r; r = MergeFirst(&merge, &cb)) {
+    PrintNameEntry(pCtx, r);
+    if (!MergeNext(&merge))
+      break;
+  }
+
+  if (!MergeDone(&merge) || r)
+    return 0;
+
+  PrintLegend(pCtx);
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void    SpillFree(REMAPCTX * pCtx)
+{
+  SPILL * pSpill = pCtx->pSpill;
+
+  CloseRunFile(&pSpill->addr);
+  CloseRunFile(&pSpill->name);
+
+  free(pSpill);
+  pCtx->pSpill = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+/* A file's runs are consecutive;  only the last file may have none. */
+
+void    CloseRunFile(RUNFILE * pFile)
+{
+  int     ctr;
+  RUN *   pRun = pFile->pRun;
+
+  for (ctr = 0; ctr < pFile->cRun; ctr++) {
+    if (pRun[ctr].fp != pFile->fp &&
+        (ctr + 1 == pFile->cRun || pRun[ctr + 1].fp != pRun[ctr].fp)) {
+      fclose(pRun[ctr].fp);
+      MEMADD(MEM_IO, -BUFSIZ);
+    }
+  }
+
+  if (pFile->fp) {
+    fclose(pFile->fp);
+    MEMADD(MEM_IO, -BUFSIZ);
+  }
+  if (pRun)
+    free(pRun);
+
+  memset(pFile, 0, sizeof(RUNFILE));
+
+  return;
+}
+
+/*****************************************************************************/
+/* Records for the listing by name reuse the buffer the map was read into.
+   Each record is copied as-is, so the buffer can't overflow before the
+   one it was read into would have.
+*/
+
+int     AddNameRecord(REMAPCTX * pCtx, REMAP * r, ULONG cb)
+{
+  REMAP * pNew;
+
+  if (pCtx->pCur + CB_MAXREC > pCtx->buffer + pCtx->cbBuffer) {
+    if (!WriteRun(&pCtx->pSpill->name, (REMAP*)pCtx->buffer,
+                  pCtx->recCnt, NameSorter))
+      return 0;
+
+    memset(pCtx->buffer, 0, pCtx->pCur - pCtx->buffer + sizeof(REMAP));
+    pCtx->pCur = pCtx->buffer;
+    pCtx->recCnt = 0;
+  }
+
+  pNew = (REMAP*)pCtx->pCur;
+  memcpy(pNew, r, cb);
+  pCtx->pCur += cb;
+  pNew->next = (REMAP*)pCtx->pCur;
+  pCtx->recCnt++;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Sort a list of records & append them to a file as a new run.  Each is
+   written as its length followed by the record itself.
+*/
+
+int     WriteRun(RUNFILE * pFile, REMAP * pFirst, int cnt, SORTFN * pfnSort)
+{
+  int     ctr;
+  ULONG   cb;
+  ULONG   cbRun = 0;
+  ULONG   cbMaxRec = 0;
+  REMAP** pr;
+  REMAP** pArr;
+  REMAP * pRec;
+  RUN *   pNew;
+
+  if (pFile->cRun == pFile->cAlloc) {
+    pNew = (RUN*)realloc(pFile->pRun, (pFile->cAlloc + 16) * sizeof(RUN));
+    if (!pNew) {
+      fprintf(stderr, "malloc failed for WriteRun\n");
+      return 0;
+    }
+    pFile->pRun = pNew;
+    pFile->cAlloc += 16;
+  }
+
+  pr = (REMAP**)malloc((cnt + 1) * sizeof(REMAP*));
+  if (!pr) {
+    fprintf(stderr, "malloc failed for WriteRun - bytes= %d\n",
+            cnt * sizeof(REMAP*));
+    return 0;
+  }
+  MEMADD(MEM_SORT, (cnt + 1) * sizeof(REMAP*));
+
+  pArr = pr;
+  for (pRec = pFirst, ctr = 0; pRec->next && ctr < cnt;
+       pRec = pRec->next, ctr++) {
+    *pArr++ = pRec;
+    cb = (char*)pRec->next - (char*)pRec;
+    cbRun += sizeof(ULONG) + cb;
+    if (cbMaxRec < cb)
+      cbMaxRec = cb;
+  }
+  *pArr = 0;
+
+  qsort(pr, ctr, sizeof(REMAP*), pfnSort);
+
+  if (pFile->fp &&
+      (ULONG)ftell(pFile->fp) > SPILL_FILEMAX - cbRun)
+    pFile->fp = 0;
+
+  if (!pFile->fp) {
+    pFile->fp = tmpfile();
+    if (!pFile->fp) {
+      fprintf(stderr, "unable to create a temporary file\n");
+      free(pr);
+      MEMADD(MEM_SORT, -(long)((cnt + 1) * sizeof(REMAP*)));
+      return 0;
+    }
+    MEMADD(MEM_IO, BUFSIZ);
+  }
+
+  fseek(pFile->fp, 0, SEEK_END);
+  pFile->pRun[pFile->cRun].fp = pFile->fp;
+  pFile->pRun[pFile->cRun].offStart = ftell(pFile->fp);
+  pFile->pRun[pFile->cRun].cbMaxRec = cbMaxRec;
+
+  for (pArr = pr; *pArr; pArr++) {
+    cb = (char*)(*pArr)->next - (char*)*pArr;
+    if (fwrite(&cb, sizeof(cb), 1, pFile->fp) != 1 ||
+        fwrite(*pArr, cb, 1, pFile->fp) != 1)
+      break;
+  }
+
+  MEMADD(MEM_SORT, -(long)((cnt + 1) * sizeof(REMAP*)));
+  cnt = (*pArr != 0);
+  free(pr);
+
+  pFile->pRun[pFile->cRun].offEnd = ftell(pFile->fp);
+  if (cnt || ferror(pFile->fp)) {
+    fprintf(stderr, "error writing temporary file\n");
+    return 0;
+  }
+
+  pFile->cRun++;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Set up a cursor for each run & put the ones that have a record in the
+   heap.  The runs share the memory allowed for their blocks;  each one's
+   share also holds its largest record, which is usually far smaller
+   than the largest possible one.
+*/
+
+int     MergeInit(MERGE * pm, RUNFILE * pFile, SORTFN * pfnSort, ULONG cbMem)
+{
+  int       ctr;
+  ULONG     cbBlk;
+  ULONG     cbShare;
+  CURSOR *  pc;
+
+  memset(pm, 0, sizeof(MERGE));
+  pm->pfnSort = pfnSort;
+
+  cbShare = cbMem / (pFile->cRun + 1);
+
+  pm->pCur = (CURSOR*)calloc(pFile->cRun, sizeof(CURSOR));
+  pm->pHeap = (int*)malloc(pFile->cRun * sizeof(int));
+  if (!pm->pCur || !pm->pHeap) {
+    fprintf(stderr, "malloc failed for MergeInit\n");
+    MergeDone(pm);
+    return 0;
+  }
+
+  for (ctr = 0; ctr < pFile->cRun; ctr++) {
+    pc = &pm->pCur[ctr];
+    pc->fp     = pFile->pRun[ctr].fp;
+    pc->off    = pFile->pRun[ctr].offStart;
+    pc->offEnd = pFile->pRun[ctr].offEnd;
+    pc->cbSlot = pFile->pRun[ctr].cbMaxRec;
+
+    cbBlk = cbShare - pc->cbSlot;
+    if ((long)cbBlk < CB_RUNBLKMIN)
+      cbBlk = CB_RUNBLKMIN;
+    if (cbBlk > CB_RUNBLKMAX)
+      cbBlk = CB_RUNBLKMAX;
+
+    pc->cbBuf  = cbBlk;
+    pc->pBuf   = (char*)malloc(cbBlk + pc->cbSlot);
+    if (!pc->pBuf) {
+      fprintf(stderr, "malloc failed for MergeInit\n");
+      MergeDone(pm);
+      return 0;
+    }
+    MEMADD(MEM_IO, cbBlk + pc->cbSlot);
+    pc->pRec = (REMAP*)(pc->pBuf + cbBlk);
+    pm->cCur++;
+
+    if (CursorNext(pc))
+      pm->pHeap[pm->cHeap++] = ctr;
+    else
+    if (pc->fErr) {
+      MergeDone(pm);
+      return 0;
+    }
+  }
+
+  for (ctr = pm->cHeap / 2 - 1; ctr >= 0; ctr--)
+    HeapDown(pm, ctr);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Return the lowest record of all the runs, or null when they're empty. */
+
+REMAP * MergeFirst(MERGE * pm, ULONG * pcb)
+{
+  CURSOR *  pc;
+
+  if (!pm->cHeap)
+    return 0;
+
+  pc = &pm->pCur[pm->pHeap[0]];
+  *pcb = pc->cbRec;
+
+  return pc->pRec;
+}
+
+/*****************************************************************************/
+/* Advance the run that supplied the lowest record. */
+
+int     MergeNext(MERGE * pm)
+{
+  CURSOR *  pc = &pm->pCur[pm->pHeap[0]];
+
+  if (!CursorNext(pc)) {
+    if (pc->fErr)
+      return 0;
+    pm->pHeap[0] = pm->pHeap[--pm->cHeap];
+  }
+
+  if (pm->cHeap)
+    HeapDown(pm, 0);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Release the cursors & report whether the runs were read without error. */
+
+int     MergeDone(MERGE * pm)
+{
+  int     ctr;
+  int     rtn = 1;
+
+  for (ctr = 0; ctr < pm->cCur; ctr++) {
+    if (pm->pCur[ctr].fErr)
+      rtn = 0;
+    free(pm->pCur[ctr].pBuf);
+    MEMADD(MEM_IO, -(long)(pm->pCur[ctr].cbBuf + pm->pCur[ctr].cbSlot));
+  }
+
+  if (pm->pCur)
+    free(pm->pCur);
+  if (pm->pHeap)
+    free(pm->pHeap);
+  memset(pm, 0, sizeof(MERGE));
+
+  if (!rtn)
+    fprintf(stderr, "error reading temporary file\n");
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* Restore the heap's order below an entry whose record has changed. */
+
+void    HeapDown(MERGE * pm, int ndx)
+{
+  int     child;
+  int     tmp;
+
+  for (;;) {
+    child = 2 * ndx + 1;
+    if (child >= pm->cHeap)
+      break;
+
+    if (child + 1 < pm->cHeap &&
+        pm->pfnSort(&pm->pCur[pm->pHeap[child + 1]].pRec,
+                    &pm->pCur[pm->pHeap[child]].pRec) < 0)
+      child++;
+
+    if (pm->pfnSort(&pm->pCur[pm->pHeap[child]].pRec,
+                    &pm->pCur[pm->pHeap[ndx]].pRec) >= 0)
+      break;
+
+    tmp = pm->pHeap[ndx];
+    pm->pHeap[ndx] = pm->pHeap[child];
+    pm->pHeap[child] = tmp;
+    ndx = child;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* Read a run's next record.  Returns 0 at the end of the run or if the
+   file can't be read, in which case fErr is set.
+*/
+
+int     CursorNext(CURSOR * pc)
+{
+  ULONG   cb;
+
+  if (pc->iData >= pc->cbData && pc->off >= pc->offEnd)
+    return 0;
+
+  if (!CursorRead(pc, &cb, sizeof(cb)) ||
+      cb <= offsetof(REMAP, text) || cb > pc->cbSlot ||
+      !CursorRead(pc, pc->pRec, cb)) {
+    pc->fErr = 1;
+    return 0;
+  }
+
+  pc->pRec->next = 0;
+  pc->cbRec = cb;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+int     CursorRead(CURSOR * pc, void * pv, ULONG cb)
+{
+  ULONG   cnt;
+  FILE *  fp = pc->fp;
+
+  while (cb) {
+    if (pc->iData >= pc->cbData) {
+      cnt = pc->offEnd - pc->off;
+      if (!cnt)
+        return 0;
+      if (cnt > pc->cbBuf)
+        cnt = pc->cbBuf;
+
+      if (fseek(fp, pc->off, SEEK_SET) ||
+          fread(pc->pBuf, 1, cnt, fp) != cnt)
+        return 0;
+
+      pc->off += cnt;
+      pc->cbData = cnt;
+      pc->iData = 0;
+    }
+
+    cnt = pc->cbData - pc->iData;
+    if (cnt > cb)
+      cnt = cb;
+    memcpy(pv, pc->pBuf + pc->iData, cnt);
+    pc->iData += cnt;
+    pv = (char*)pv + cnt;
+    cb -= cnt;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* qsort callback:  the listing by address's order (see AddressSorter),
+   then whatever else distinguishes two records, so that identical ones
+   end up next to each other.
+*/
+
+int     RunSorter(const void *key, const void *element)
+{
+  int     res;
+  REMAP * pk = *(REMAP**)key;
+  REMAP * pe = *(REMAP**)element;
+
+  res = CompareAddress(pk, pe);
+  if (res)
+    return res;
+
+  res = (pk->type & REMAP_TYPE) - (pe->type & REMAP_TYPE);
+  if (res)
+    return res;
+
+  if (pk->type & REMAP_IMP) {
+    res = ImportSorter(pk->text, pe->text);
+    if (res)
+      return res;
+  }
+
+  res = stricmp(pk->text, pe->text);
+  if (res)
+    return res;
+
+  res = strcmp(pk->text, pe->text);
+  if (res)
+    return res;
+
+  return (pk->type & REMAP_MASK) - (pe->type & REMAP_MASK);
+}
+
+/*****************************************************************************/
+
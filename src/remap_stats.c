@@ -0,0 +1,523 @@
+/*****************************************************************************/
+/*  remap_stats.c
+ *
+ *  Phase timings & counters (--stats, --stats-json).  Each map's context
+ *  gets a STATS structure only when one of the options (or --trace) is
+ *  used;  the hooks in remap.c test the pointer & do nothing else
+ *  otherwise.
+ *
+ *  Wall time comes from the high-resolution timer.  Cpu time is whatever
+ *  the C runtime's clock() reports;  in batch mode, it includes the time
+ *  used by the threads listing other maps.  Nested phases are timed on
+ *  their own, so demangling is also part of StoreExports & StorePublics.
+ *
+ *  Memory is counted for the whole process, by what it's used for, where
+ *  the large blocks are allocated & freed.  The C runtime's own overhead
+ *  isn't included, & each open file is assumed to have a BUFSIZ buffer.
+ *  In batch mode, each map's report shows the totals as of its end.
+ *
+ *  --dry-run-estimate predicts the same totals for a listing from the
+ *  map's size & the length of the lines at the start of its publics.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define CB_STATSTEXT    4096
+#define EST_SAMPLE      1000    /* lines of publics used for the estimate */
+
+char *  StatsDemangler(void);
+char *  PrintMemory(char * ptr, int fJson);
+
+ULONG   ulTmrFreq = 0;      /* 0 if the high-resolution timer isn't usable */
+
+int     fMemStats = 0;
+HMTX    hmtxMem = 0;
+long long   allMemLive[MEM_COUNT + 1];  /* the last is the total */
+long long   allMemPeak[MEM_COUNT + 1];
+
+char *  apszPhase[PH_COUNT] = {
+    "header scan",
+    "StoreSegments",
+    "StoreGroups",
+    "StoreExports",
+    "StorePublics",
+    "demangling",
+    "MarkDuplicates",
+    "sort & write runs",
+    "sort by address",
+    "print by address",
+    "sort by name",
+    "print by name",
+    "trailing messages"
+};
+
+char *  apszMem[MEM_COUNT + 1] = {
+    "records", "sort_index", "io_buffers", "strings", "hash_tables", "total"
+};
+
+/* one name per bit of REMAP_TYPE */
+char *  apszRecType[8] = {
+    "groups", "imports", "segments", "modules",
+    "entry points", "exports", "publics", "errors"
+};
+
+/*****************************************************************************/
+/* Called by Init() */
+
+void    StatsSetup(void)
+{
+  if (DosTmrQueryFreq(&ulTmrFreq))
+    ulTmrFreq = 0;
+
+  /* the threads in batch mode share the counts */
+  if ((opts & OPT_STATS) && !DosCreateMutexSem(0, &hmtxMem, 0, FALSE)) {
+    fMemStats = 1;
+    if (pszDemangler)
+      MEMADD(MEM_STRINGS, strlen(pszDemangler) + 1);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+
+void    MemAdd(int mem, long cb)
+{
+  DosRequestMutexSem(hmtxMem, SEM_INDEFINITE_WAIT);
+
+  allMemLive[mem] += cb;
+  if (allMemLive[mem] > allMemPeak[mem])
+    allMemPeak[mem] = allMemLive[mem];
+
+  allMemLive[MEM_COUNT] += cb;
+  if (allMemLive[MEM_COUNT] > allMemPeak[MEM_COUNT])
+    allMemPeak[MEM_COUNT] = allMemLive[MEM_COUNT];
+
+  DosReleaseMutexSem(hmtxMem);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Called by OpenContext().  --trace uses the same hooks, so it gets a
+   STATS structure too.
+*/
+
+int     StatsInit(REMAPCTX * pCtx)
+{
+  pCtx->pStats = (STATS*)calloc(1, sizeof(STATS));
+  if (!pCtx->pStats) {
+    fprintf(stderr, "malloc failed for statistics\n");
+    return 0;
+  }
+
+  pCtx->pStats->dOpen = StatsNow();
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Called by CloseContext();  the map's span lasts until now. */
+
+void    StatsFree(REMAPCTX * pCtx)
+{
+  if (!pCtx->pStats)
+    return;
+
+  if (pszTraceFile)
+    TraceSpan(pCtx->fIn, pCtx->pStats->dOpen, TRACE_COPY);
+
+  free(pCtx->pStats);
+  pCtx->pStats = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Elapsed time in milliseconds */
+
+double  StatsNow(void)
+{
+  QWORD   qw;
+  ULONG   ms;
+
+  if (ulTmrFreq && !DosTmrQueryTime(&qw))
+    return ((qw.ulHi * 4294967296.0) + qw.ulLo) * 1000.0 / ulTmrFreq;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+/*****************************************************************************/
+
+void    StatsBegin(STATS * pStats, int ph)
+{
+  pStats->aPhase[ph].dWallStart = StatsNow();
+  if (opts & OPT_STATS)
+    pStats->aPhase[ph].dCpuStart = clock() * 1000.0 / CLOCKS_PER_SEC;
+
+  return;
+}
+
+/*****************************************************************************/
+
+void    StatsEnd(STATS * pStats, int ph)
+{
+  PHASE * pPh = &pStats->aPhase[ph];
+
+  pPh->dWall += StatsNow() - pPh->dWallStart;
+  if (opts & OPT_STATS)
+    pPh->dCpu += (clock() * 1000.0 / CLOCKS_PER_SEC) - pPh->dCpuStart;
+  pPh->cCalls++;
+
+  if (pszTraceFile)
+    TraceSpan(apszPhase[ph], pPh->dWallStart,
+              (ph == PH_DEMANGLE ? TRACE_DETAIL : 0));
+
+  return;
+}
+
+/*****************************************************************************/
+/* Count the records in the buffer by type & note how much of it they use.
+   With --max-memory, this is called for each batch of records before
+   they're written out;  otherwise, once when the map has been stored.
+*/
+
+void    StatsRecords(REMAPCTX * pCtx)
+{
+  int     ndx;
+  ULONG   cb;
+  REMAP * r;
+  STATS * pStats = pCtx->pStats;
+
+  for (r = (REMAP*)pCtx->buffer; r->next; r = r->next) {
+    for (ndx = 0; ndx < 8; ndx++) {
+      if (r->type & (1 << ndx)) {
+        pStats->aRecs[ndx]++;
+        break;
+      }
+    }
+  }
+
+  cb = pCtx->pCur - pCtx->buffer;
+  if (cb > pStats->cbPeak)
+    pStats->cbPeak = cb;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Report on a map that was processed successfully.  The report is
+   written with a single call so batch mode's reports aren't mixed up.
+*/
+
+void    StatsPrint(REMAPCTX * pCtx)
+{
+  int     ndx;
+  int     fJson;
+  int     fFirst;
+  long    cbIn;
+  long    cbOut;
+  ULONG   cDemangle;
+  char *  pText;
+  char *  ptr;
+  PHASE * pPh;
+  STATS * pStats = pCtx->pStats;
+  char    szName[2 * CCHMAXPATH];
+
+  if (!pStats || !(opts & OPT_STATS))
+    return;
+
+  pText = (char*)malloc(CB_STATSTEXT);
+  if (!pText) {
+    fprintf(stderr, "malloc failed for statistics\n");
+    return;
+  }
+
+  fJson = (opts & OPT_STATSJSON) != 0;
+  cbIn = (pCtx->fi ? ftell(pCtx->fi) : -1);
+  cbOut = ((pCtx->fo && pCtx->fo != stdout) ? ftell(pCtx->fo) : -1);
+  ptr = pText;
+
+  /* names demangled lazily are counted by the memo table's misses */
+  cDemangle = pStats->cDemangle;
+  if (pCtx->fLazy)
+    cDemangle += cDmglLookups - cDmglHits;
+
+  if (fJson) {
+    ptr += sprintf(ptr, "{\"map\": \"%s\", \"phases\": [",
+                   JsonString(pCtx->fIn, szName, sizeof(szName)));
+    fFirst = 1;
+    for (ndx = 0, pPh = pStats->aPhase; ndx < PH_COUNT; ndx++, pPh++) {
+      if (!pPh->cCalls)
+        continue;
+      ptr += sprintf(ptr, "%s{\"name\": \"%s\", \"calls\": %lu,"
+                     " \"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+                     (fFirst ? "" : ", "), apszPhase[ndx],
+                     pPh->cCalls, pPh->dWall, pPh->dCpu);
+      fFirst = 0;
+    }
+    ptr += sprintf(ptr, "], \"records\": {");
+    for (ndx = 0; ndx < 8; ndx++)
+      ptr += sprintf(ptr, "%s\"%s\": %lu", (ndx ? ", " : ""),
+                     apszRecType[ndx], pStats->aRecs[ndx]);
+    ptr += sprintf(ptr, "}, \"demangler\": \"%s\", \"demangle_calls\": %lu,"
+                   " \"bytes_read\": %ld, \"bytes_written\": %ld,"
+                   " \"buffer_peak\": %lu, \"buffer_size\": %lu",
+                   StatsDemangler(), cDemangle, cbIn, cbOut,
+                   pStats->cbPeak, pCtx->cbBuffer);
+    ptr = PrintMemory(ptr, 1);
+    ptr += sprintf(ptr, "}\n");
+  }
+  else {
+    ptr += sprintf(ptr, "\n statistics for '%s'\n"
+                   "   phase                  calls     wall ms      cpu ms\n",
+                   pCtx->fIn);
+    for (ndx = 0, pPh = pStats->aPhase; ndx < PH_COUNT; ndx++, pPh++) {
+      if (pPh->cCalls)
+        ptr += sprintf(ptr, "   %-20s %7lu %11.3f %11.3f\n", apszPhase[ndx],
+                       pPh->cCalls, pPh->dWall, pPh->dCpu);
+    }
+    ptr += sprintf(ptr, "   records:  ");
+    for (ndx = 0; ndx < 8; ndx++)
+      ptr += sprintf(ptr, "%s%lu %s", (ndx ? (ndx == 4 ? ",\n             " :
+                     ", ") : ""), pStats->aRecs[ndx], apszRecType[ndx]);
+    ptr += sprintf(ptr, "\n   demangler:  %s - %lu calls\n",
+                   StatsDemangler(), cDemangle);
+    if (cbIn >= 0)
+      ptr += sprintf(ptr, "   bytes read:  %ld\n", cbIn);
+    if (cbOut >= 0)
+      ptr += sprintf(ptr, "   bytes written:  %ld\n", cbOut);
+    ptr += sprintf(ptr, "   record buffer:  %lu of %lu bytes used at most\n",
+                   pStats->cbPeak, pCtx->cbBuffer);
+    ptr = PrintMemory(ptr, 0);
+    ptr += sprintf(ptr, "\n");
+  }
+
+  fputs(pText, stderr);
+  free(pText);
+
+  return;
+}
+
+/*****************************************************************************/
+/* Append the memory counts to the report & return its new end. */
+
+char *  PrintMemory(char * ptr, int fJson)
+{
+  int     ndx;
+
+  if (!fMemStats)
+    return ptr;
+
+  DosRequestMutexSem(hmtxMem, SEM_INDEFINITE_WAIT);
+
+  if (fJson) {
+    ptr += sprintf(ptr, ", \"memory\": {");
+    for (ndx = 0; ndx <= MEM_COUNT; ndx++)
+      ptr += sprintf(ptr, "%s\"%s\": {\"live\": %lld, \"peak\": %lld}",
+                     (ndx ? ", " : ""), apszMem[ndx],
+                     allMemLive[ndx], allMemPeak[ndx]);
+    ptr += sprintf(ptr, "}");
+  }
+  else {
+    ptr += sprintf(ptr, "   memory (whole process)        live        peak\n");
+    for (ndx = 0; ndx <= MEM_COUNT; ndx++)
+      ptr += sprintf(ptr, "   %-20s %12lld %11lld\n", apszMem[ndx],
+                     allMemLive[ndx], allMemPeak[ndx]);
+  }
+
+  DosReleaseMutexSem(hmtxMem);
+
+  return ptr;
+}
+
+/*****************************************************************************/
+
+char *  StatsDemangler(void)
+{
+  if (opts & OPT_NO_DEMANGLE)
+    return "none";
+  if (opts & OPT_XXC)
+    return "external";
+  if (opts & OPT_VAC)
+    return "demangl.dll";
+
+  return "builtin GCC";
+}
+
+/*****************************************************************************/
+/* Map names are the only strings that may need escaping. */
+
+char *  JsonString(char * pIn, char * pOut, int cbOut)
+{
+  char *  ptr = pOut;
+
+  for ( ; *pIn && ptr < pOut + cbOut - 2; pIn++) {
+    if (*pIn == '\\' || *pIn == '"')
+      *ptr++ = '\\';
+    *ptr++ = *pIn;
+  }
+  *ptr = 0;
+
+  return pOut;
+}
+
+/*****************************************************************************/
+/* --dry-run-estimate:  predict the peak memory used by a listing.  The
+   records are assumed to be as long, on average, as the lines at the
+   start of the publics, & every other line before them is counted as a
+   record.  The demangled names are assumed to be as long as the mangled
+   ones.
+*/
+
+int     EstimateMemory(REMAPCTX * pCtx)
+{
+  int       rtn = 0;
+  int       ndx;
+  ULONG     ulSize;
+  ULONG     cLines = 0;
+  ULONG     cSample = 0;
+  ULONG     cbSample = 0;
+  ULONG     cNames = 0;
+  ULONG     cbNames = 0;
+  ULONG     cSlot;
+  long      offPublics = -1;
+  double    dRecs;
+  double    dNames;
+  double    dCbName;
+  char *    ptr;
+  FILE *    fp;
+  FILESTATUS3 fs;
+  long long allEst[MEM_COUNT + 1];
+
+  if (!SetupNames(pCtx))
+    return 0;
+
+  fp = fopen(pCtx->fIn, "r");
+  if (!fp) {
+    fprintf(stderr, "unable to open input file '%s'\n", pCtx->fIn);
+    return 0;
+  }
+
+do {
+  /* count the lines up to the publics, then sample them */
+  while (fgets(pCtx->bufIn, sizeof(pCtx->bufIn), fp)) {
+    ptr = pCtx->bufIn + strspn(pCtx->bufIn, pszWS);
+
+    if (offPublics < 0) {
+      if (*ptr)
+        cLines++;
+      if (MatchArray(apszPubByName, ptr))
+        offPublics = ftell(fp);
+      continue;
+    }
+
+    cbSample += strlen(pCtx->bufIn);
+    if (++cSample >= EST_SAMPLE)
+      break;
+
+    if (strlen(ptr) < 5 || ptr[4] != ':' ||
+        (ptr = strpbrk(ptr, pszWS)) == 0)
+      continue;
+    ptr += strspn(ptr, pszWS);
+    if (!strncmp(ptr, szImp, cbImp) || !strncmp(ptr, szAbs, cbAbs)) {
+      ptr += 4;
+      ptr += strspn(ptr, pszWS);
+    }
+    cbNames += strcspn(ptr, pszWS);
+    cNames++;
+  }
+
+  if (offPublics < 0) {
+    fprintf(stderr, "publics by name header not found in '%s'\n",
+            pCtx->fIn);
+    break;
+  }
+
+  /* each public is listed twice, by name & by value */
+  dRecs = (cbSample ? (double)(pCtx->cbMap - offPublics) * cSample /
+                      cbSample : 0);
+  dNames = dRecs / 2;
+  dCbName = (cNames ? (double)cbNames / cNames : 0);
+  dRecs += cLines;
+
+  /* decide the record buffer's size the way OpenMap() does */
+  ulSize = (pCtx->cbMap > CB_BUFMAX ? CB_BUFMAX : (ULONG)pCtx->cbMap);
+  if (!SpillInit(pCtx, &ulSize))
+    break;
+  if (!pCtx->pSpill && pCtx->cbMap > CB_BUFMAX) {
+    fprintf(stderr, "'%s' is too large to read into memory%s\n", pCtx->fIn,
+            ((opts & OPT_DEMANGLE_ONLY) ? "" : " - use --max-memory"));
+    break;
+  }
+
+  memset(allEst, 0, sizeof(allEst));
+  allEst[MEM_RECORDS] = ulSize;
+  allEst[MEM_IO] = 2 * BUFSIZ;
+
+  /* when the records are sorted in pieces, each piece is as many as
+     the buffer holds;  the runs are read back using up to a sixth of
+     the limit (the buffer got two thirds) */
+  if (pCtx->pSpill) {
+    allEst[MEM_SORT] = (long long)(ulSize / (sizeof(REMAP) + dCbName)) *
+                       sizeof(REMAP*);
+    allEst[MEM_IO] += 2 * BUFSIZ + ulSize / 4;
+    SpillFree(pCtx);
+  }
+  else
+    allEst[MEM_SORT] = (long long)(dRecs + 1) * sizeof(REMAP*);
+
+  if (pszDemangler)
+    allEst[MEM_STRINGS] += strlen(pszDemangler) + 1;
+
+  /* the memo table is used with --dmglcache, & by --diff & the reports
+     that demangle names as they're needed (RunReport());  the latter
+     may not need every name, so this is their most */
+  if (pszDmglCache ||
+      (!(opts & OPT_NO_DEMANGLE) &&
+       (opts & (OPT_DIFF | OPT_BUCKETS | OPT_PROFILE | OPT_SIZES |
+                OPT_MODSIZES)))) {
+    if (pszDmglCache &&
+        !DosQueryPathInfo(pszDmglCache, FIL_STANDARD, &fs, sizeof(fs)))
+      allEst[MEM_STRINGS] += fs.cbFile + 1;
+    allEst[MEM_STRINGS] += (long long)(dNames * (dCbName + 1));
+
+    for (cSlot = 0x10000; cSlot * 2 < dNames; cSlot <<= 1)
+      ;
+    allEst[MEM_HASH] = cSlot * sizeof(HASHENT*) +
+                       (long long)(dNames * (sizeof(HASHENT) +
+                                   sizeof(DMGLMEMO) + dCbName + 1));
+  }
+
+  for (ndx = 0; ndx < MEM_COUNT; ndx++)
+    allEst[MEM_COUNT] += allEst[ndx];
+
+  fprintf(stdout, "# remap memory estimate 1\n# map\t%s\t%llu\n"
+          "# records\t%.0f\n# name\tpeak_bytes\n",
+          pCtx->fIn, pCtx->cbMap, dRecs);
+  for (ndx = 0; ndx <= MEM_COUNT; ndx++)
+    fprintf(stdout, "%s\t%lld\n", apszMem[ndx], allEst[ndx]);
+
+  rtn = 1;
+
+} while (0);
+
+  fclose(fp);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+
@@ -0,0 +1,121 @@
+/*****************************************************************************/
+/*  remap_thrd.c
+ *
+ *  Runs a function on several threads at once & waits for all of them to
+ *  finish.  The caller's function is responsible for dividing the work.
+ *  Threads are started with _beginthread() rather than DosCreateThread()
+ *  so the C runtime is initialized for each of them.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+#include "exceptq.h"
+
+/*****************************************************************************/
+
+#define MAX_THREADS     64
+#define THREAD_STACK    0x40000
+
+void    ThreadMain(void * pv);
+
+/*****************************************************************************/
+/* Use the number of threads specified on the commandline if there is one,
+   otherwise one per processor.
+*/
+
+int     QueryThreadCount(void)
+{
+  ULONG   cCpu = 1;
+
+  if (cThreads)
+    return (cThreads > MAX_THREADS ? MAX_THREADS : (int)cThreads);
+
+  if (DosQuerySysInfo(QSV_NUMPROCESSORS, QSV_NUMPROCESSORS,
+                      &cCpu, sizeof(cCpu)) || !cCpu)
+    cCpu = 1;
+
+  return (cCpu > MAX_THREADS ? MAX_THREADS : (int)cCpu);
+}
+
+/*****************************************************************************/
+/* The current thread does its share of the work, then waits for the
+   others.  If a thread can't be started, the remaining threads (including
+   this one) simply do more of the work.
+*/
+
+int     RunThreads(THREADPROC * pfn, void * pv, int cThrd)
+{
+  int     ctr;
+  int     cStarted = 0;
+  TID     atid[MAX_THREADS];
+  THRDARG arg;
+
+  arg.pfn = pfn;
+  arg.pv  = pv;
+
+  if (cThrd > MAX_THREADS)
+    cThrd = MAX_THREADS;
+
+  for (ctr = 1; ctr < cThrd; ctr++) {
+    if (!StartThread(&arg, &atid[cStarted])) {
+      fprintf(stderr, "_beginthread failed - threads started= %d\n",
+              cStarted);
+      break;
+    }
+    cStarted++;
+  }
+
+  pfn(pv);
+
+  for (ctr = 0; ctr < cStarted; ctr++)
+    DosWaitThread(&atid[ctr], DCWW_WAIT);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Start one thread that runs pArg->pfn;  pArg has to remain valid until
+   it ends.  The caller waits for it with DosWaitThread().
+*/
+
+int     StartThread(THRDARG * pArg, TID * pTid)
+{
+  int     tid;
+
+  tid = _beginthread(ThreadMain, 0, THREAD_STACK, pArg);
+  if (tid == -1)
+    return 0;
+
+  *pTid = (TID)tid;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Every thread needs its own exception handler. */
+
+void    ThreadMain(void * pv)
+{
+  EXCEPTIONREGISTRATIONRECORD ExRegRec;
+  int       xq;
+  THRDARG * pArg = (THRDARG*)pv;
+
+  xq = LoadExceptq(&ExRegRec, 0);
+
+  pArg->pfn(pArg->pv);
+
+  if (xq)
+    UninstallExceptq(&ExRegRec);
+
+  return;
+}
+
+/*****************************************************************************/
+
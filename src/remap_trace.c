@@ -0,0 +1,266 @@
+/*****************************************************************************/
+/*  remap_trace.c
+ *
+ *  Timeline of each thread's work (--trace).  The spans are written as a
+ *  Chrome trace-event file that can be viewed in Perfetto or chrome://
+ *  tracing.  There's a span for each map that's listed, for each of its
+ *  phases (the same ones --stats times), for each name demangled, and
+ *  for each wait for the shared or external demangler.
+ *
+ *  Every thread adds its spans to its own buffers, so recording one
+ *  doesn't involve a lock;  nothing is written until remap exits.  The
+ *  buffers are rings:  when one fills, the oldest spans are dropped.
+ *  Demangler calls are kept apart from the rest so they can't push the
+ *  phases out.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+#define TRACE_MAXTID    4096    /* OS/2 thread ids are smaller than this */
+#define TRACE_PHASES    4096    /* spans of maps & their phases */
+#define TRACE_DETAILS   32768   /* demangler calls & waits */
+
+typedef struct _traceevt {
+    double  dStart;     /* milliseconds */
+    double  dDur;
+    char *  pszName;
+    ULONG   fFree;      /* pszName was allocated */
+} TRACEEVT;
+
+typedef struct _tracering {
+    ULONG     cEvt;     /* spans added, including those dropped */
+    ULONG     cMax;
+    TRACEEVT* pEvt;
+} TRACERING;
+
+typedef struct _tracebuf {
+    TRACERING phases;
+    TRACERING details;
+} TRACEBUF;
+
+TRACEBUF *  TraceBuffer(ULONG tid);
+int     TraceRing(TRACERING * pRing, ULONG cMax);
+void    WriteRing(FILE * fp, TRACERING * pRing, ULONG tid, int * pFirst);
+void    FreeRing(TRACERING * pRing);
+
+char *      pszTraceFile = 0;
+TRACEBUF ** ppTraceBuf = 0;
+double      dTraceStart = 0;
+
+/*****************************************************************************/
+/* Called by Init() */
+
+int     TraceInit(void)
+{
+  ppTraceBuf = (TRACEBUF**)calloc(TRACE_MAXTID, sizeof(TRACEBUF*));
+  if (!ppTraceBuf) {
+    fprintf(stderr, "malloc failed for trace\n");
+    return 0;
+  }
+
+  dTraceStart = StatsNow();
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Add a span that started at dStart & ends now.  A thread's buffers are
+   set up the first time it adds a span;  if that fails, its spans are
+   dropped.
+*/
+
+void    TraceSpan(char * pszName, double dStart, int flags)
+{
+  PPIB        ppib;
+  PTIB        ptib;
+  TRACEBUF *  pBuf;
+  TRACERING * pRing;
+  TRACEEVT *  pEvt;
+  double      dEnd = StatsNow();
+
+  DosGetInfoBlocks(&ptib, &ppib);
+  pBuf = TraceBuffer(ptib->tib_ptib2->tib2_ultid);
+  if (!pBuf)
+    return;
+
+  pRing = ((flags & TRACE_DETAIL) ? &pBuf->details : &pBuf->phases);
+  pEvt = &pRing->pEvt[pRing->cEvt % pRing->cMax];
+  if (pEvt->fFree)
+    free(pEvt->pszName);
+
+  pEvt->dStart = dStart;
+  pEvt->dDur = dEnd - dStart;
+  pEvt->pszName = pszName;
+  pEvt->fFree = 0;
+  if (flags & TRACE_COPY) {
+    pEvt->pszName = strdup(pszName);
+    pEvt->fFree = (pEvt->pszName != 0);
+    if (!pEvt->pszName)
+      pEvt->pszName = "map";
+  }
+  pRing->cEvt++;
+
+  return;
+}
+
+/*****************************************************************************/
+/* Only the thread itself uses its entry, so no lock is needed. */
+
+TRACEBUF *  TraceBuffer(ULONG tid)
+{
+  TRACEBUF *  pBuf;
+
+  if (!ppTraceBuf || tid >= TRACE_MAXTID)
+    return 0;
+
+  pBuf = ppTraceBuf[tid];
+  if (pBuf)
+    return (pBuf->phases.cMax ? pBuf : 0);
+
+  pBuf = (TRACEBUF*)calloc(1, sizeof(TRACEBUF));
+  if (!pBuf)
+    return 0;
+  ppTraceBuf[tid] = pBuf;
+
+  if (!TraceRing(&pBuf->phases, TRACE_PHASES) ||
+      !TraceRing(&pBuf->details, TRACE_DETAILS)) {
+    fprintf(stderr, "malloc failed for trace - thread %lu won't be traced\n",
+            tid);
+    FreeRing(&pBuf->phases);
+    FreeRing(&pBuf->details);
+    return 0;
+  }
+
+  return pBuf;
+}
+
+/*****************************************************************************/
+
+int     TraceRing(TRACERING * pRing, ULONG cMax)
+{
+  pRing->pEvt = (TRACEEVT*)calloc(cMax, sizeof(TRACEEVT));
+  if (!pRing->pEvt)
+    return 0;
+
+  pRing->cMax = cMax;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Called once every thread is done:  write the file, then free the
+   buffers.  Times in the file are microseconds since Init().
+*/
+
+void    TraceWrite(void)
+{
+  int       fFirst = 1;
+  ULONG     tid;
+  ULONG     cDropped;
+  FILE *    fp;
+  TRACEBUF* pBuf;
+
+  if (!ppTraceBuf)
+    return;
+
+  fp = fopen(pszTraceFile, "w");
+  if (!fp)
+    fprintf(stderr, "unable to open trace file '%s'\n", pszTraceFile);
+  else
+    fputs("{\"traceEvents\": [\n", fp);
+
+  for (tid = 0; tid < TRACE_MAXTID; tid++) {
+    pBuf = ppTraceBuf[tid];
+    if (!pBuf)
+      continue;
+
+    if (fp && pBuf->phases.cMax) {
+      cDropped = 0;
+      if (pBuf->phases.cEvt > pBuf->phases.cMax)
+        cDropped += pBuf->phases.cEvt - pBuf->phases.cMax;
+      if (pBuf->details.cEvt > pBuf->details.cMax)
+        cDropped += pBuf->details.cEvt - pBuf->details.cMax;
+
+      fprintf(fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1,"
+              " \"tid\": %lu, \"args\": {\"name\": \"thread %lu\","
+              " \"dropped\": %lu}}", (fFirst ? "" : ",\n"),
+              tid, tid, cDropped);
+      fFirst = 0;
+
+      WriteRing(fp, &pBuf->phases, tid, &fFirst);
+      WriteRing(fp, &pBuf->details, tid, &fFirst);
+    }
+
+    FreeRing(&pBuf->phases);
+    FreeRing(&pBuf->details);
+    free(pBuf);
+  }
+
+  free(ppTraceBuf);
+  ppTraceBuf = 0;
+
+  if (fp) {
+    fputs("\n]}\n", fp);
+    if (fclose(fp))
+      fprintf(stderr, "error writing trace file '%s'\n", pszTraceFile);
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* The spans that are still in the ring, oldest first */
+
+void    WriteRing(FILE * fp, TRACERING * pRing, ULONG tid, int * pFirst)
+{
+  ULONG     ctr;
+  TRACEEVT* pEvt;
+  char      szName[2 * CCHMAXPATH];
+
+  ctr = (pRing->cEvt > pRing->cMax ? pRing->cEvt - pRing->cMax : 0);
+  for ( ; ctr < pRing->cEvt; ctr++) {
+    pEvt = &pRing->pEvt[ctr % pRing->cMax];
+    fprintf(fp, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1,"
+            " \"tid\": %lu, \"ts\": %.1f, \"dur\": %.1f}",
+            (*pFirst ? "" : ",\n"),
+            JsonString(pEvt->pszName, szName, sizeof(szName)), tid,
+            (pEvt->dStart - dTraceStart) * 1000.0, pEvt->dDur * 1000.0);
+    *pFirst = 0;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+
+void    FreeRing(TRACERING * pRing)
+{
+  ULONG   ctr;
+
+  if (!pRing->pEvt)
+    return;
+
+  for (ctr = 0; ctr < pRing->cMax; ctr++) {
+    if (pRing->pEvt[ctr].fFree)
+      free(pRing->pEvt[ctr].pszName);
+  }
+
+  free(pRing->pEvt);
+  pRing->pEvt = 0;
+  pRing->cMax = 0;
+
+  return;
+}
+
+/*****************************************************************************/
+
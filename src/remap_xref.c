@@ -0,0 +1,683 @@
+/*****************************************************************************/
+/*  remap_xref.c
+ *
+ *  Cross-reference (--xref).  Reads the maps for a set of modules, e.g.
+ *  all the DLLs in a product, & resolves each module's imports against
+ *  the exports of the others.  It lists imports that can't be resolved
+ *  & exports that no other module in the set imports.
+ *
+ *  The maps are scanned on several threads.  Only the exports & the
+ *  imported publics are needed, so this uses a lightweight scanner
+ *  that doesn't store or demangle anything else.  Maps don't list
+ *  export ordinals, so if a module's .def file is next to its map,
+ *  the ordinals are read from it.
+ */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#define INCL_DOS
+#include <os2.h>
+
+#include "remap.h"
+
+/*****************************************************************************/
+
+/* an export, an import, or an ordinal from a .def file */
+typedef struct _xref {
+    char *  pMod;       /* the module imported from (imports only) */
+    char *  pName;      /* the external name, if any */
+    char *  pSym;       /* the internal name */
+    ULONG   ord;
+    ULONG   cUsed;      /* the number of imports that resolve to it */
+} XREF;
+
+typedef struct _xreflist {
+    XREF *  pArr;
+    int     cnt;
+    int     cAlloc;
+} XREFLIST;
+
+typedef struct _xrefmap {
+    char *  pszFile;
+    int     fOK;
+    char    szModule[CCHMAXPATH];
+    XREFLIST exp;
+    XREFLIST imp;
+    XREFLIST ord;
+} XREFMAP;
+
+typedef struct _xrefjob {
+    FILE *  fo;
+    XREFMAP* pMap;
+    int     cMap;
+    int     cAlloc;
+    int     next;           /* index of the next map to scan */
+    HASHTBL hashMod;        /* module name -> XREFMAP* */
+    HASHTBL hashExp;        /* "MODULE\tname" or "MODULE\t#ord" -> XREF* */
+    HASHTBL hashExt;        /* imports from modules without a map */
+} XREFJOB;
+
+int     AddMapPath(XREFJOB * pJob, char * pszPath);
+int     AddMapFile(XREFJOB * pJob, char * pszFile);
+void    XrefWorker(void * pv);
+int     ScanMapXrefs(XREFMAP * pMap, char * pLine, int cbLine);
+int     ScanDefOrdinals(XREFMAP * pMap, char * pLine, int cbLine);
+int     AddXref(XREFLIST * pList, char * pMod, char * pName,
+                char * pSym, ULONG ord);
+int     ParseImportName(char * pImp, char ** ppMod, char ** ppName,
+                        ULONG * pOrd);
+int     BuildExportTable(XREFJOB * pJob);
+void    ResolveImports(XREFJOB * pJob, ULONG * pcResolved, ULONG * pcExt);
+char *  XrefKey(char * pMod, char * pName, ULONG ord, char * pKey);
+void    FreeXrefList(XREFLIST * pList);
+int     XrefExtSorter(const void *key, const void *element);
+
+char    szDefExports[] = "EXPORTS";
+char *  apszDefKeywords[] = {"BASE", "CODE", "DATA", "DESCRIPTION",
+                             "EXETYPE", szDefExports, "HEAPSIZE", "IMPORTS",
+                             "LIBRARY", "NAME", "OLD", "PROTMODE",
+                             "SEGMENTS", "STACKSIZE", "STUB", 0};
+
+/*****************************************************************************/
+
+int     CrossReference(REMAPCTX * pCtx)
+{
+  int       ctr;
+  int       rtn = 0;
+  ULONG     cImp = 0;
+  ULONG     cExp = 0;
+  ULONG     cDead = 0;
+  ULONG     cResolved = 0;
+  ULONG     cExt = 0;
+  XREFMAP * pMap;
+  XREF *    px;
+  HASHENT** ppArr;
+  XREFJOB   job;
+
+  memset(&job, 0, sizeof(job));
+  job.fo = pCtx->fo;
+
+do {
+  if (!AddMapPath(&job, pCtx->fIn))
+    break;
+  for (ctr = 0; ctr < cFiles; ctr++) {
+    if (!AddMapPath(&job, apszFiles[ctr]))
+      break;
+  }
+  if (ctr < cFiles)
+    break;
+
+  if (!job.cMap) {
+    fprintf(stderr, "no map files found\n");
+    break;
+  }
+
+  RunThreads(XrefWorker, &job, QueryThreadCount());
+
+  if (!BuildExportTable(&job))
+    break;
+
+  fprintf(pCtx->fo, "\n Cross-reference of %d modules\n",
+          (int)job.hashMod.cEnt);
+
+  /* imports that name a module in the set but not one of its exports */
+  fprintf(pCtx->fo, "\n Unresolved imports\n\n"
+                    "   Importer          Import                      Symbol\n"
+                    "   ----------------  --------------------------  ------------------------\n");
+  ResolveImports(&job, &cResolved, &cExt);
+
+  fprintf(pCtx->fo, "\n Exports that aren't imported by any of these modules\n\n"
+                    "   Module            Export                      Symbol\n"
+                    "   ----------------  --------------------------  ------------------------\n");
+  for (pMap = job.pMap; pMap < &job.pMap[job.cMap]; pMap++) {
+    if (!pMap->fOK)
+      continue;
+
+    for (px = pMap->exp.pArr; px < &pMap->exp.pArr[pMap->exp.cnt]; px++) {
+      cExp++;
+      if (px->cUsed)
+        continue;
+
+      cDead++;
+      fprintf(pCtx->fo, "   %-16s  %-26s  %s\n",
+              pMap->szModule, px->pName, px->pSym);
+    }
+    cImp += pMap->imp.cnt;
+  }
+
+  fprintf(pCtx->fo, "\n Imports from modules without a map\n\n"
+                    "   Module               Imports\n"
+                    "   ----------------  ----------\n");
+  ppArr = HashToArray(&job.hashExt);
+  if (ppArr) {
+    qsort(ppArr, job.hashExt.cEnt, sizeof(HASHENT*), XrefExtSorter);
+    for (ctr = 0; ppArr[ctr]; ctr++)
+      fprintf(pCtx->fo, "   %-16s  %10lu\n",
+              ppArr[ctr]->key, *(ULONG*)ppArr[ctr]->pv);
+    free(ppArr);
+  }
+
+  fprintf(pCtx->fo, "\n Summary\n\n"
+                    "   imports:  %lu total,  %lu resolved,  %lu from other modules,"
+                    "  %lu unresolved\n"
+                    "   exports:  %lu total,  %lu not imported\n\n",
+          cImp, cResolved, cExt, cImp - cResolved - cExt, cExp, cDead);
+
+  rtn = 1;
+
+} while (0);
+
+  HashFree(&job.hashMod);
+  HashFree(&job.hashExp);
+  HashFree(&job.hashExt);
+
+  for (ctr = 0; ctr < job.cMap; ctr++) {
+    FreeXrefList(&job.pMap[ctr].exp);
+    FreeXrefList(&job.pMap[ctr].imp);
+    FreeXrefList(&job.pMap[ctr].ord);
+    free(job.pMap[ctr].pszFile);
+  }
+  if (job.pMap)
+    free(job.pMap);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+/* A path may be a map or a directory;  for a directory, every .map file
+   in it is used.
+*/
+
+int     AddMapPath(XREFJOB * pJob, char * pszPath)
+{
+  int         cb;
+  int         rtn = 1;
+  HDIR        hdir = HDIR_CREATE;
+  ULONG       cnt = 1;
+  FILESTATUS3 fs;
+  FILEFINDBUF3 ffb;
+  char        szSpec[CCHMAXPATH];
+  char        szFile[CCHMAXPATH];
+
+  if (DosQueryPathInfo(pszPath, FIL_STANDARD, &fs, sizeof(fs))) {
+    fprintf(stderr, "unable to find '%s'\n", pszPath);
+    return 0;
+  }
+
+  if (!(fs.attrFile & FILE_DIRECTORY))
+    return AddMapFile(pJob, pszPath);
+
+  /* use the directory name as-is if it already ends with a separator */
+  strcpy(szSpec, pszPath);
+  cb = strlen(szSpec);
+  if (cb && szSpec[cb - 1] != '\\' && szSpec[cb - 1] != '/' &&
+      szSpec[cb - 1] != ':')
+    szSpec[cb++] = '\\';
+  strcpy(&szSpec[cb], "*.map");
+
+  if (DosFindFirst(szSpec, &hdir, FILE_NORMAL | FILE_READONLY | FILE_ARCHIVED,
+                   &ffb, sizeof(ffb), &cnt, FIL_STANDARD))
+    return 1;
+
+  do {
+    sprintf(szFile, "%.*s%s", cb, szSpec, ffb.achName);
+    if (!AddMapFile(pJob, szFile)) {
+      rtn = 0;
+      break;
+    }
+    cnt = 1;
+  } while (!DosFindNext(hdir, &ffb, sizeof(ffb), &cnt));
+
+  DosFindClose(hdir);
+
+  return rtn;
+}
+
+/*****************************************************************************/
+
+int     AddMapFile(XREFJOB * pJob, char * pszFile)
+{
+  XREFMAP * pNew;
+
+  if (pJob->cMap >= pJob->cAlloc) {
+    pNew = (XREFMAP*)realloc(pJob->pMap,
+                             (pJob->cAlloc + 64) * sizeof(XREFMAP));
+    if (!pNew) {
+      fprintf(stderr, "realloc failed for AddMapFile - maps= %d\n",
+              pJob->cAlloc + 64);
+      return 0;
+    }
+    pJob->pMap = pNew;
+    pJob->cAlloc += 64;
+  }
+
+  pNew = &pJob->pMap[pJob->cMap];
+  memset(pNew, 0, sizeof(XREFMAP));
+  pNew->pszFile = strdup(pszFile);
+  if (!pNew->pszFile)
+    return 0;
+  pJob->cMap++;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Each worker claims the next unscanned map until none are left.  The
+   maps are independent of each other, so no locking is needed.
+*/
+
+void    XrefWorker(void * pv)
+{
+  int       ndx;
+  XREFJOB * pJob = (XREFJOB*)pv;
+  char      szLine[1024];
+
+  while ((ndx = __sync_fetch_and_add(&pJob->next, 1)) < pJob->cMap) {
+    if (ScanMapXrefs(&pJob->pMap[ndx], szLine, sizeof(szLine)) &&
+        ScanDefOrdinals(&pJob->pMap[ndx], szLine, sizeof(szLine)))
+      pJob->pMap[ndx].fOK = 1;
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+/* The first non-blank line is the module name.  Exports come from the
+   exports section & imports from the publics by name;  reading stops
+   at the publics by value since they repeat the same imports.
+*/
+
+int     ScanMapXrefs(XREFMAP * pMap, char * pLine, int cbLine)
+{
+  int     inExp = 0;
+  int     inPub = 0;
+  ULONG   ord;
+  FILE *  fp;
+  char *  ptr;
+  char *  pWord;
+  char *  pName;
+  char *  pSym;
+  char *  pMod;
+
+  fp = fopen(pMap->pszFile, "r");
+  if (!fp) {
+    fprintf(stderr, "unable to open map '%s'\n", pMap->pszFile);
+    return 0;
+  }
+
+  while (fgets(pLine, cbLine, fp)) {
+
+    ptr = TrimLine(pLine);
+    if (!ptr)
+      continue;
+
+    if (!*pMap->szModule) {
+      pWord = Trim(ptr, 0);
+      for (ptr = pWord; *ptr; ptr++)
+        *ptr = toupper(*ptr);
+      sprintf(pMap->szModule, "%.*s", CCHMAXPATH - 1, pWord);
+      continue;
+    }
+
+    if (MatchArray(apszExports, ptr)) {
+      inExp = 1;
+      continue;
+    }
+
+    if (MatchArray(apszPubByName, ptr)) {
+      inExp = 0;
+      inPub = 1;
+      continue;
+    }
+
+    if (MatchArray(apszPubByValue, ptr))
+      break;
+
+    /* "seg:offs  export  alias" */
+    if (inExp) {
+      pWord = Trim(ptr, &ptr);
+      pName = Trim(ptr, &ptr);
+      pSym = Trim(ptr, 0);
+      if (!pSym || !strchr(pWord, ':')) {
+        inExp = 0;
+        continue;
+      }
+
+      if (!AddXref(&pMap->exp, 0, pName, pSym, 0))
+        break;
+      continue;
+    }
+
+    /* "seg:offs  Imp  symbol  (MODULE.name_or_ordinal)" */
+    if (inPub) {
+      pWord = Trim(ptr, &ptr);
+      pWord = Trim(ptr, &ptr);
+      if (!pWord || strcmp(pWord, "Imp"))
+        continue;
+
+      pSym = Trim(ptr, &ptr);
+      pWord = Trim(ptr, 0);
+      if (!pSym || !pWord || !ParseImportName(pWord, &pMod, &pName, &ord))
+        continue;
+
+      if (!AddXref(&pMap->imp, pMod, pName, pSym, ord))
+        break;
+    }
+  }
+
+  fclose(fp);
+
+  if (!*pMap->szModule) {
+    fprintf(stderr, "no module name found in '%s'\n", pMap->pszFile);
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Read the "name [=internal] @ordinal" lines from the EXPORTS section of
+   the .def file with the same name as the map, if there is one.
+*/
+
+int     ScanDefOrdinals(XREFMAP * pMap, char * pLine, int cbLine)
+{
+  int     inExp = 0;
+  int     cb;
+  FILE *  fp;
+  char *  ptr;
+  char *  pName;
+  char *  pOrd;
+  char ** ppKey;
+  char    szDef[CCHMAXPATH];
+
+  strcpy(szDef, pMap->pszFile);
+  ptr = strrchr(szDef, '.');
+  if (!ptr)
+    ptr = strchr(szDef, 0);
+  strcpy(ptr, ".def");
+
+  fp = fopen(szDef, "r");
+  if (!fp)
+    return 1;
+
+  while (fgets(pLine, cbLine, fp)) {
+
+    ptr = strchr(pLine, ';');
+    if (ptr)
+      *ptr = 0;
+
+    ptr = TrimLine(pLine);
+    if (!ptr)
+      continue;
+
+    /* any keyword ends the section;  EXPORTS may be followed by an entry */
+    for (ppKey = apszDefKeywords; *ppKey; ppKey++) {
+      cb = strlen(*ppKey);
+      if (!strncmp(ptr, *ppKey, cb) && (!ptr[cb] || isspace(ptr[cb])))
+        break;
+    }
+
+    if (*ppKey) {
+      inExp = (*ppKey == szDefExports);
+      ptr = TrimLine(ptr + cb);
+      if (!inExp || !ptr)
+        continue;
+    }
+
+    if (!inExp)
+      continue;
+
+    pOrd = strchr(ptr, '@');
+    if (!pOrd || !isdigit(pOrd[1]))
+      continue;
+
+    pName = ptr + strspn(ptr, "\"'");
+    pName[strcspn(pName, "\"'= \t@")] = 0;
+
+    if (!AddXref(&pMap->ord, 0, pName, pName, strtoul(&pOrd[1], 0, 10)))
+      break;
+  }
+
+  fclose(fp);
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* The three strings are copied into a single allocation. */
+
+int     AddXref(XREFLIST * pList, char * pMod, char * pName,
+                char * pSym, ULONG ord)
+{
+  int     cbMod;
+  int     cbName;
+  XREF *  px;
+  char *  ptr;
+
+  if (pList->cnt >= pList->cAlloc) {
+    px = (XREF*)realloc(pList->pArr, (pList->cAlloc * 2 + 256) * sizeof(XREF));
+    if (!px) {
+      fprintf(stderr, "realloc failed for AddXref - entries= %d\n",
+              pList->cAlloc * 2 + 256);
+      return 0;
+    }
+    pList->pArr = px;
+    pList->cAlloc = pList->cAlloc * 2 + 256;
+  }
+
+  if (!pMod)
+    pMod = "";
+  cbMod = strlen(pMod) + 1;
+  cbName = strlen(pName) + 1;
+
+  ptr = (char*)malloc(cbMod + cbName + strlen(pSym) + 1);
+  if (!ptr) {
+    fprintf(stderr, "malloc failed for AddXref\n");
+    return 0;
+  }
+
+  px = &pList->pArr[pList->cnt++];
+  px->pMod  = strcpy(ptr, pMod);
+  px->pName = strcpy(ptr + cbMod, pName);
+  px->pSym  = strcpy(ptr + cbMod + cbName, pSym);
+  px->ord   = ord;
+  px->cUsed = 0;
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Split "(MODULE.name)" or "(MODULE.ordinal)" into its parts.  Module
+   names are compared without regard to case so they're uppercased.
+*/
+
+int     ParseImportName(char * pImp, char ** ppMod, char ** ppName,
+                        ULONG * pOrd)
+{
+  char *  ptr;
+
+  if (*pImp == '(')
+    pImp++;
+  ptr = strchr(pImp, 0) - 1;
+  if (ptr >= pImp && *ptr == ')')
+    *ptr = 0;
+
+  ptr = strchr(pImp, '.');
+  if (!ptr || ptr == pImp || !ptr[1])
+    return 0;
+  *ptr++ = 0;
+
+  *ppMod = pImp;
+  for (; *pImp; pImp++)
+    *pImp = toupper(*pImp);
+
+  *pOrd = 0;
+  *ppName = ptr;
+  if (isdigit(*ptr)) {
+    *pOrd = strtoul(ptr, &ptr, 10);
+    if (!*ptr)
+      *ppName = "";
+    else
+      *pOrd = 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Add every module's exports to one table, by name & by ordinal. */
+
+int     BuildExportTable(XREFJOB * pJob)
+{
+  int       ctr;
+  ULONG     cExp = 0;
+  XREFMAP * pMap;
+  XREF *    px;
+  HASHENT * pEnt;
+  char      szKey[CCHMAXPATH + 1024];
+
+  for (ctr = 0; ctr < pJob->cMap; ctr++)
+    cExp += pJob->pMap[ctr].exp.cnt;
+
+  if (!HashInit(&pJob->hashMod, pJob->cMap, sizeof(XREFMAP*)) ||
+      !HashInit(&pJob->hashExp, cExp, sizeof(XREF*)) ||
+      !HashInit(&pJob->hashExt, 64, sizeof(ULONG)))
+    return 0;
+
+  for (pMap = pJob->pMap; pMap < &pJob->pMap[pJob->cMap]; pMap++) {
+    if (!pMap->fOK)
+      continue;
+
+    pEnt = HashFind(&pJob->hashMod, pMap->szModule, 1);
+    if (!pEnt)
+      return 0;
+    if (*(XREFMAP**)pEnt->pv) {
+      fprintf(stderr, "'%s' & '%s' both describe %s - ignoring the latter\n",
+              (*(XREFMAP**)pEnt->pv)->pszFile, pMap->pszFile, pMap->szModule);
+      pMap->fOK = 0;
+      continue;
+    }
+    *(XREFMAP**)pEnt->pv = pMap;
+
+    for (px = pMap->exp.pArr; px < &pMap->exp.pArr[pMap->exp.cnt]; px++) {
+      pEnt = HashFind(&pJob->hashExp,
+                      XrefKey(pMap->szModule, px->pName, 0, szKey), 1);
+      if (!pEnt)
+        return 0;
+      *(XREF**)pEnt->pv = px;
+    }
+
+    /* an ordinal refers to the export with the same name if there is
+       one, otherwise to the .def entry itself */
+    for (px = pMap->ord.pArr; px < &pMap->ord.pArr[pMap->ord.cnt]; px++) {
+      XREF *  pExp = px;
+
+      pEnt = HashFind(&pJob->hashExp,
+                      XrefKey(pMap->szModule, px->pName, 0, szKey), 0);
+      if (pEnt) {
+        pExp = *(XREF**)pEnt->pv;
+        pExp->ord = px->ord;
+      }
+
+      pEnt = HashFind(&pJob->hashExp,
+                      XrefKey(pMap->szModule, 0, px->ord, szKey), 1);
+      if (!pEnt)
+        return 0;
+      *(XREF**)pEnt->pv = pExp;
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+/* Resolve each import, printing the ones that name a module in the set
+   but not one of its exports.
+*/
+
+void    ResolveImports(XREFJOB * pJob, ULONG * pcResolved, ULONG * pcExt)
+{
+  XREFMAP * pMap;
+  XREF *    px;
+  HASHENT * pEnt;
+  char      szKey[CCHMAXPATH + 1024];
+  char      szImp[CCHMAXPATH + 1024];
+
+  for (pMap = pJob->pMap; pMap < &pJob->pMap[pJob->cMap]; pMap++) {
+    if (!pMap->fOK)
+      continue;
+
+    for (px = pMap->imp.pArr; px < &pMap->imp.pArr[pMap->imp.cnt]; px++) {
+
+      if (!HashFind(&pJob->hashMod, px->pMod, 0)) {
+        pEnt = HashFind(&pJob->hashExt, px->pMod, 1);
+        if (pEnt)
+          (*(ULONG*)pEnt->pv)++;
+        (*pcExt)++;
+        continue;
+      }
+
+      pEnt = HashFind(&pJob->hashExp,
+                      XrefKey(px->pMod, px->pName, px->ord, szKey), 0);
+      if (pEnt) {
+        (*(XREF**)pEnt->pv)->cUsed++;
+        (*pcResolved)++;
+        continue;
+      }
+
+      if (px->ord)
+        sprintf(szImp, "%s.%lu", px->pMod, px->ord);
+      else
+        sprintf(szImp, "%s.%.1000s", px->pMod, px->pName);
+      fprintf(pJob->fo, "   %-16s  %-26s  %s\n",
+              pMap->szModule, szImp, px->pSym);
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************/
+
+char *  XrefKey(char * pMod, char * pName, ULONG ord, char * pKey)
+{
+  if (ord)
+    sprintf(pKey, "%.*s\t#%lu", CCHMAXPATH - 1, pMod, ord);
+  else
+    sprintf(pKey, "%.*s\t%.1000s", CCHMAXPATH - 1, pMod, pName);
+
+  return pKey;
+}
+
+/*****************************************************************************/
+
+void    FreeXrefList(XREFLIST * pList)
+{
+  int     ctr;
+
+  for (ctr = 0; ctr < pList->cnt; ctr++)
+    free(pList->pArr[ctr].pMod);
+
+  if (pList->pArr)
+    free(pList->pArr);
+
+  memset(pList, 0, sizeof(XREFLIST));
+
+  return;
+}
+
+/*****************************************************************************/
+/* qsort callback for the modules without a map - by name */
+
+int     XrefExtSorter(const void *key, const void *element)
+{
+  return strcmp((*(HASHENT**)key)->key, (*(HASHENT**)element)->key);
+}
+
+/*****************************************************************************/
+